@@ -0,0 +1,96 @@
+/**
+ * @brief Barnes-Hut octree for the gravity between asteroids
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include "vector3D.h"
+#include "bodyArrays.h"
+
+/**
+ * @brief Cube of space holding a range of bodies.
+ */
+typedef struct
+{
+	vector3D_t centerOfMass;	// [m]
+	double mass_GC;			// [m^3 / s^2]
+	vector3D_t center;		// Center of the cube [m]
+	double halfSize;		// Half the side of the cube [m]
+	unsigned int firstChild;	// Index of the first of 8 consecutive children (0 if leaf)
+	unsigned int firstBody;		// Index of the first body in the octree arrays
+	unsigned int bodyNum;
+} OctreeNode_t;
+
+/**
+ * @brief Octree over a set of bodies. Nodes and bodies are kept in arenas
+ *		that are reused (and only grown) from one build to the next.
+ */
+typedef struct
+{
+	OctreeNode_t* nodes;
+	unsigned int nodesNum;
+	unsigned int nodesCapacity;
+
+	// Bodies sorted so that every node owns a contiguous range
+	double* x;			// [m]
+	double* y;			// [m]
+	double* z;			// [m]
+	double* mass_GC;		// [m^3 / s^2]
+	unsigned int* index;		// Index of each body in the source arrays
+	unsigned int bodyNum;
+	unsigned int bodiesCapacity;
+	void* bodiesMemory;		// Sorted arrays followed by the scratch copy used to sort them
+
+	double openingAngle;		// A node is opened if size / distance >= openingAngle
+	double softening;		// [m]
+	unsigned int leafSize;		// Nodes with at most this many bodies are not split
+} Octree_t;
+
+/**
+ * @brief Constructs an empty octree.
+ *
+ * @param openingAngle Opening angle (theta). 0 sums every pair directly.
+ * @param softening Softening length, avoids the singularity of close encounters [m].
+ * @param leafSize Nodes with at most this many bodies are not split.
+ *
+ * @return The octree.
+ */
+Octree_t* constructOctree(double openingAngle, double softening, unsigned int leafSize);
+
+/**
+ * @brief Destroys an octree.
+ *
+ * @param tree Pointer to the octree.
+ */
+void destroyOctree(Octree_t* tree);
+
+/**
+ * @brief Rebuilds the octree over a set of bodies, copying their positions and masses.
+ *
+ * @param tree Pointer to the octree.
+ * @param bodies Pointer to the body arrays.
+ * @param bodyNum The amount of bodies.
+ *
+ * @return 0 if the octree was built, -1 if the memory could not be allocated
+ *		(the octree is left empty and pulls nothing).
+ */
+int buildOctree(Octree_t* tree, const BodyArrays_t* bodies, unsigned int bodyNum);
+
+/**
+ * @brief Calculates the acceleration the bodies in the octree produce on a point.
+ *		Only reads the octree, so it may be called from several threads.
+ *
+ * @param tree Pointer to the octree.
+ * @param position The point [m].
+ * @param index Index of the body at that point, which is skipped (any out of range value if none).
+ *
+ * @return The acceleration [m/s^2].
+ */
+vector3D_t getOctreeAcceleration(const Octree_t* tree, vector3D_t position, unsigned int index);
+
+#endif
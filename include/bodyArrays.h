@@ -0,0 +1,100 @@
+/**
+ * @brief Structure of arrays storage for orbital bodies
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef BODY_ARRAYS_H
+#define BODY_ARRAYS_H
+
+#include "ephemerides.h"
+#include <stddef.h>
+
+// Every array starts on a cache line, so vector loads never split one
+#define BODY_ARRAYS_ALIGNMENT 64
+
+/**
+ * @brief Bodies stored as one contiguous array per component.
+ *		Keeps the physics loops from loading the fields they do not use.
+ */
+typedef struct
+{
+	double* x;			// [m]
+	double* y;			// [m]
+	double* z;			// [m]
+	double* vx;			// [m/s]
+	double* vy;			// [m/s]
+	double* vz;			// [m/s]
+	double* ax;			// [m/s^2]
+	double* ay;			// [m/s^2]
+	double* az;			// [m/s^2]
+	double* mass_GC;		// [m^3 / s^2]
+	unsigned int capacity;		// Bodies per array (rounded up to fill the alignment)
+	void* memory;			// Single block backing every array
+	void* mapping;			// File mapping holding the block (NULL if it was allocated)
+	size_t mappingSize;		// [bytes]
+} BodyArrays_t;
+
+/**
+ * @brief Constructs the arrays for a given amount of bodies.
+ *
+ * @param bodyNum The amount of bodies to store.
+ *
+ * @return The body arrays (NULL if the memory could not be allocated).
+ */
+BodyArrays_t* constructBodyArrays(unsigned int bodyNum);
+
+/**
+ * @brief Maps body arrays stored in a file, in the layout constructBodyArrays
+ *		uses, so they are used in place instead of read. The mapping is
+ *		private: changes to the arrays never reach the file.
+ *
+ * @param path Path of the file.
+ * @param offset Position of the arrays in the file (a multiple of BODY_ARRAYS_ALIGNMENT).
+ * @param capacity Bodies per array (a multiple of BODY_ARRAYS_ALIGNMENT / sizeof(double)).
+ *
+ * @return The body arrays (NULL if the file could not be mapped or is too short).
+ */
+BodyArrays_t* mapBodyArrays(const char* path, size_t offset, unsigned int capacity);
+
+/**
+ * @brief Destroys the body arrays.
+ *
+ * @param arrays Pointer to the body arrays.
+ */
+void destroyBodyArrays(BodyArrays_t* arrays);
+
+/**
+ * @brief Gathers a body from the arrays.
+ *
+ * @param arrays Pointer to the body arrays.
+ * @param index Index of the body.
+ *
+ * @return A copy of the body.
+ */
+Body_t getBody(const BodyArrays_t* arrays, unsigned int index);
+
+/**
+ * @brief Scatters a body into the arrays.
+ *
+ * @param arrays Pointer to the body arrays.
+ * @param index Index where the body is stored.
+ * @param body Pointer to the body.
+ */
+void setBody(BodyArrays_t* arrays, unsigned int index, const Body_t* body);
+
+/**
+ * @brief Removes the flagged bodies in a single pass, keeping the order of the rest.
+ *
+ * @param arrays Pointer to the body arrays.
+ * @param removed Flag of each body, set to remove it.
+ * @param begin Index of the first flagged body (every body before it is kept).
+ * @param bodyNum The amount of bodies currently stored.
+ *
+ * @return The amount of bodies left.
+ */
+unsigned int compactBodyArrays(BodyArrays_t* arrays, const unsigned char* removed, unsigned int begin, unsigned int bodyNum);
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @brief Checkpoint files of the orbital simulation
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "orbitalSim.h"
+
+// Bumped whenever the layout of the file changes, older files are rejected
+#define CHECKPOINT_VERSION 3
+
+// File used by the -save_checkpoint and -load_checkpoint launch options
+#define CHECKPOINT_PATH "orbitalSim.checkpoint"
+
+/**
+ * @brief Saves the state of a simulation: the bodies, the asteroids, the spaceship,
+ *		the black hole, dt and the time elapsed. The file is written next to
+ *		the old one and then replaces it, so a failed save never loses a checkpoint.
+ *
+ * @param sim Pointer to the simulation.
+ * @param path Path of the checkpoint.
+ *
+ * @return 1 if the checkpoint was saved, 0 if not.
+ */
+int saveCheckpoint(const OrbitalSim_t* sim, const char* path);
+
+/**
+ * @brief Restores a simulation from a checkpoint. The asteroids are mapped from
+ *		the file and used in place, so even large belts start instantly. The
+ *		solvers are chosen again, they are not part of the state. If the
+ *		integrator, the gravity between asteroids or the massless asteroids
+ *		differ from the saved ones, the stored accelerations (which hold a
+ *		different part of the pull for each) are evaluated again.
+ *
+ * @param path Path of the checkpoint.
+ * @param settings Pointer to how the restored simulation is solved.
+ *
+ * @return The orbital simulation (NULL if the file is missing, of another version
+ *		or build, or the simulation could not be constructed).
+ */
+OrbitalSim_t* loadCheckpoint(const char* path, const OrbitalSimSettings_t* settings);
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @brief Fast multipole method for the gravity between asteroids
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef FAST_MULTIPOLE_H
+#define FAST_MULTIPOLE_H
+
+#include "barnesHut.h"
+#include "bodyArrays.h"
+#include "threadPool.h"
+
+// Highest supported expansion order
+#define FMM_ORDER_MAX 8
+
+/**
+ * @brief Fast multipole solver. Cartesian multipole and local expansions,
+ *		up to the same order, about the center of mass of every octree node.
+ */
+typedef struct
+{
+	Octree_t* tree;
+	unsigned int order;
+	unsigned int coefficientsNum;	// Expansion terms per node
+	unsigned short* translationIndex;	// Derivative used by each term of the multipole to local translation
+
+	// Per node arrays (coefficientsNum terms per node for the expansions)
+	double* multipoles;
+	double* locals;
+	double* radius;			// Distance from the center of mass to the farthest body [m]
+	unsigned int nodesCapacity;
+
+	// Per body accelerations, in octree order [m/s^2]
+	double* ax;
+	double* ay;
+	double* az;
+	unsigned int bodiesCapacity;
+
+	// Subtrees evaluated as independent thread pool tasks
+	unsigned int* tasks;
+	unsigned int tasksNum;
+
+	// Where evaluateFastMultipole stores the accelerations, in source order
+	double* outputX;
+	double* outputY;
+	double* outputZ;
+} FastMultipole_t;
+
+/**
+ * @brief Constructs a fast multipole solver.
+ *
+ * @param order Expansion order, from 1 (monopole) to FMM_ORDER_MAX.
+ * @param openingAngle Two nodes interact through their expansions if the sum of
+ *		their radii is below openingAngle times their distance. 0 sums every pair directly.
+ * @param softening Softening length of the direct sums [m].
+ *
+ * @return The solver.
+ */
+FastMultipole_t* constructFastMultipole(unsigned int order, double openingAngle, double softening);
+
+/**
+ * @brief Destroys a fast multipole solver.
+ *
+ * @param fmm Pointer to the solver.
+ */
+void destroyFastMultipole(FastMultipole_t* fmm);
+
+/**
+ * @brief Calculates the acceleration every body produces on the others.
+ *
+ * @param fmm Pointer to the solver.
+ * @param bodies Pointer to the body arrays.
+ * @param bodyNum The amount of bodies.
+ * @param pool The thread pool that evaluates the subtrees. The results do not depend on its size.
+ * @param ax, ay, az Where the accelerations are stored (bodyNum elements each, overwritten) [m/s^2].
+ *
+ * @return 0 on success, -1 if the memory could not be allocated (accelerations set to 0).
+ */
+int evaluateFastMultipole(FastMultipole_t* fmm, const BodyArrays_t* bodies, unsigned int bodyNum, ThreadPool_t* pool,
+			double* ax, double* ay, double* az);
+
+/**
+ * @brief Compares the solver against a direct sum over every body, for a sample of bodies.
+ *
+ * @param fmm Pointer to the solver.
+ * @param bodies Pointer to the body arrays.
+ * @param bodyNum The amount of bodies.
+ * @param pool The thread pool.
+ * @param sampleNum The amount of bodies compared (evenly spread).
+ *
+ * @return The largest acceleration error in the sample, relative to the RMS acceleration
+ *		of the sample. -1 if the memory could not be allocated.
+ */
+double getFastMultipoleError(FastMultipole_t* fmm, const BodyArrays_t* bodies, unsigned int bodyNum, ThreadPool_t* pool,
+			unsigned int sampleNum);
+
+#endif
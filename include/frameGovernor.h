@@ -0,0 +1,74 @@
+/**
+ * @brief Frame budget governor of the physics
+ *
+ * Keeps measuring how long an update takes, and picks the smallest dt whose
+ * updates still fit in a share (the budget) of the real time at the requested
+ * simulation speed. The budget shrinks while the view misses its frame time,
+ * since then the physics is taking CPU time the rendering needs.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include "orbitalSim.h"
+
+/**
+ * @brief State of the governor.
+ */
+typedef struct
+{
+	double simulationSpeed;		// Simulated seconds per real second
+	double targetFrametime;		// [s]
+	double budget;			// Share of the real time the updates may take
+	double updateTime;		// Average real time an update takes (0 until measured) [s]
+	double dt;			// Timestep the governor wants [s]
+} FrameGovernor_t;
+
+/**
+ * @brief Initializes a governor.
+ *
+ * @param governor Pointer to the governor.
+ * @param simulationSpeed Simulated seconds per real second.
+ * @param targetFrametime Real time of a frame [s].
+ * @param dt First timestep, used until an update is measured [s].
+ */
+void initFrameGovernor(FrameGovernor_t* governor, double simulationSpeed, double targetFrametime, double dt);
+
+/**
+ * @brief Runs a first update of a simulation with the timestep of the governor
+ *		and fits the timestep to it, so the governor starts from a measure
+ *		instead of a guess. The simulation ends up with the new timestep.
+ *
+ * @param governor Pointer to the governor.
+ * @param sim Pointer to the simulation.
+ * @param spawnBH Lets the black hole absorb bodies.
+ */
+void primeFrameGovernor(FrameGovernor_t* governor, OrbitalSim_t* sim, int spawnBH);
+
+/**
+ * @brief Adds the measure of a run of updates, and fits the timestep again.
+ *		The timestep only changes once it is off by more than the hysteresis.
+ *
+ * @param governor Pointer to the governor.
+ * @param updatesTime Real time the updates took [s].
+ * @param updatesNum The amount of updates.
+ * @param frametime Real time of the last frame of the view [s] (0 if unknown).
+ *
+ * @return The timestep the governor wants [s].
+ */
+double updateFrameGovernor(FrameGovernor_t* governor, double updatesTime, unsigned int updatesNum, double frametime);
+
+/**
+ * @brief Gets the updates per frame at the timestep of the governor.
+ *
+ * @param governor Pointer to the governor.
+ *
+ * @return The updates per frame.
+ */
+double getFrameGovernorUpdatesPerFrame(const FrameGovernor_t* governor);
+
+#endif
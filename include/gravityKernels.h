@@ -0,0 +1,80 @@
+/**
+ * @brief Vectorized gravity kernels for the asteroid arrays
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef GRAVITY_KERNELS_H
+#define GRAVITY_KERNELS_H
+
+#include "ephemerides.h"
+#include "bodyArrays.h"
+
+// Maximum amount of massive bodies pulling the asteroids
+#define GRAVITY_SOURCES_MAX 16
+
+/**
+ * @brief Precision of the pull of the sources on the asteroids.
+ */
+typedef enum
+{
+	GRAVITY_PRECISION_DOUBLE,	// Every operation in double
+	GRAVITY_PRECISION_MIXED		// Offsets and pulls in float (twice the asteroids per instruction), kick and drift in double
+} GravityPrecision_t;
+
+/**
+ * @brief Massive body, packed for the kernels.
+ */
+typedef struct
+{
+	vector3D_t position;		// [m]
+	double mass_GC;			// [m^3 / s^2]
+} GravitySource_t;
+
+/**
+ * @brief Accelerates and moves the asteroids in [begin, end) in a single sweep.
+ *		Each asteroid is loaded once, pulled by every source, kicked
+ *		(v += a * kick), drifted (x += v * drift) and stored once.
+ *
+ * @param sources The massive bodies. The first reactingNum of them feel the
+ *		asteroids back, the rest (the black hole) only pull.
+ * @param sourcesNum The amount of sources (at most GRAVITY_SOURCES_MAX).
+ * @param reactingNum The amount of sources that feel the asteroids.
+ * @param asteroids Pointer to the asteroid arrays.
+ * @param begin Index of the first asteroid.
+ * @param end Index past the last asteroid.
+ * @param kick Time the new acceleration is applied for (semi-implicit Euler: dt).
+ * @param drift Time the new velocity is applied for (semi-implicit Euler: dt, 0 only kicks).
+ * @param accumulate If set, the sources pull on top of the accelerations
+ *		already stored in the arrays instead of starting from 0.
+ * @param reactions Where the pull of the asteroids on each reacting source is
+ *		stored (reactingNum elements, overwritten).
+ */
+typedef void (*gravityKernel_t)(const GravitySource_t* sources, unsigned int sourcesNum, unsigned int reactingNum,
+				BodyArrays_t* asteroids, unsigned int begin, unsigned int end, double kick, double drift,
+				int accumulate, vector3D_t* reactions);
+
+/**
+ * @brief Gets the widest kernel supported by the running CPU.
+ *
+ * @param precision Precision of the pulls. The mixed precision kernels take
+ *		the offset of each asteroid to the first source (the star) in double,
+ *		and only that offset is rounded to float, so the error grows with the
+ *		distance to the star instead of the distance to the origin.
+ * @param testParticles If set, the asteroids are test particles: the kernel
+ *		leaves out their pull on the sources (reactingNum must be 0).
+ *
+ * @return The gravity kernel.
+ */
+gravityKernel_t getGravityKernel(GravityPrecision_t precision, int testParticles);
+
+/**
+ * @brief Gets the instruction set used by getGravityKernel (whatever the precision).
+ *
+ * @return The name of the instruction set ("AVX-512", "AVX2", "SSE2" or "Scalar").
+ */
+const char* getGravityKernelName(void);
+
+#endif
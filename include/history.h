@@ -0,0 +1,78 @@
+/**
+ * @brief Rewind history of the orbital simulation
+ *
+ * Every interval updates the whole state of the simulation is kept as a
+ * keyframe, along with the engines of the SpaceShip for each update that
+ * follows it (the only input the simulation does not produce itself). Since
+ * updates are deterministic, any earlier step is rebuilt exactly by restoring
+ * the keyframe before it and replaying at most interval - 1 updates. The
+ * timestep is kept with each keyframe, so it may change between keyframes.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "orbitalSim.h"
+#include <stddef.h>
+
+typedef struct History History_t;
+
+/**
+ * @brief Constructs the history of a simulation, starting at its current state.
+ *
+ * @param sim Pointer to the simulation. Its body and asteroid counts are the
+ *		largest a keyframe can hold (they only go down).
+ * @param interval Updates between keyframes, also the most a rewind replays.
+ * @param budget Memory the keyframes may take [bytes]. Once it is used up the
+ *		oldest keyframe is dropped, so it sets how far back the simulation goes.
+ *
+ * @return The history (NULL if the budget does not hold a single keyframe or
+ *		the memory could not be allocated).
+ */
+History_t* constructHistory(const OrbitalSim_t* sim, unsigned int interval, size_t budget);
+
+/**
+ * @brief Destroys a history.
+ *
+ * @param history Pointer to the history.
+ */
+void destroyHistory(History_t* history);
+
+/**
+ * @brief Simulates a timestep and keeps it in the history. The engines of the
+ *		SpaceShip must already be set (readSpaceShipInputs).
+ *
+ * @param history Pointer to the history.
+ * @param sim Pointer to the simulation.
+ * @param spawnBH Lets the black hole absorb bodies.
+ */
+void updateOrbitalSimHistory(History_t* history, OrbitalSim_t* sim, int spawnBH);
+
+/**
+ * @brief Tells if the next update starts a keyframe. Replays use the timestep
+ *		of their keyframe, so sim->dt may only change there.
+ *
+ * @param history Pointer to the history.
+ *
+ * @return 1 if the next update starts a keyframe, 0 otherwise.
+ */
+int isHistoryAtKeyframe(const History_t* history);
+
+/**
+ * @brief Takes the simulation back to an earlier step, exactly as it was. The
+ *		steps after it are forgotten, updating again records new ones.
+ *
+ * @param history Pointer to the history.
+ * @param sim Pointer to the simulation.
+ * @param spawnBH Lets the black hole absorb bodies (as when the steps were recorded).
+ * @param steps Updates to undo. Stops at the oldest step kept.
+ *
+ * @return The updates undone (0 at the oldest step kept).
+ */
+unsigned long long rewindOrbitalSimHistory(History_t* history, OrbitalSim_t* sim, int spawnBH, unsigned long long steps);
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * @brief Two body (Kepler) propagation
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include "vector3D.h"
+
+/**
+ * @brief Moves a body along its exact orbit around a central mass, using
+ *		universal variables (elliptic, parabolic and hyperbolic orbits).
+ *
+ * @param mu Mass of the central body [m^3 / s^2].
+ * @param position Position relative to the central body, updated [m].
+ * @param velocity Velocity relative to the central body, updated [m/s].
+ * @param dt Time to move the body for (may be negative) [s].
+ */
+void driftKepler(double mu, vector3D_t* position, vector3D_t* velocity, double dt);
+
+#endif
@@ -10,6 +10,7 @@
 #define KEYBINDS_H
 
 #include <raylib.h>
+#include <atomic>
 
 #define SWITCH_BODY_CAMERA_KEY KEY_T
 #define TOGGLE_FULLSCREEN_KEY KEY_F11
@@ -24,7 +25,7 @@ extern const keybind_t keybinds[];
 extern unsigned int keybindsValues[];
 
 extern const int movementKeys[];
-extern int movementKeyIsDown[];
+extern std::atomic<int> movementKeyIsDown[];	// Read by the physics thread
 extern const unsigned int movementKeysAmount;
 
 enum
@@ -39,6 +40,8 @@ enum
 	TOGGLE_REWIND,
 	SWITCH_BODY,
 	TOGGLE_FULLSCREEN,
+	TOGGLE_SHOW_TRAILS,
+	TOGGLE_PROFILER,
 	KEYBINDS_AMOUNT // Keep it in the end of this enum (amount of keybinds)
 };
 
@@ -33,7 +33,24 @@ enum
 	MASSIVE_JUPITER,
 	SPAWN_BLACKHOLE,
 	EASTER_EGG,
-	SYSTEM
+	SYSTEM,
+	THREADS,
+	ASTEROID_SELF_GRAVITY,
+	OPENING_ANGLE,
+	FMM_ORDER,
+	INTEGRATOR,
+	HEADLESS,
+	SHOW_TRAILS,
+	SAVE_CHECKPOINT,
+	LOAD_CHECKPOINT,
+	RECORD,
+	RECORD_DELTA,
+	REWIND_MEMORY,
+	SEED,
+	STATE_HASH,
+	TRACE,
+	MIXED_PRECISION,
+	MASSLESS_ASTEROIDS
 };
 
 /**
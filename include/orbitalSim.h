@@ -12,6 +12,54 @@
 #ifndef ORBITALSIM_H
 #define ORBITALSIM_H
 #include "ephemerides.h"
+#include "bodyArrays.h"
+#include "threadPool.h"
+#include "gravityKernels.h"
+#include "barnesHut.h"
+#include "fastMultipole.h"
+
+// Asteroids updated per thread pool task. Fixed (instead of derived from the
+// amount of threads) so the reduction order never depends on the thread count.
+#define ASTEROIDS_CHUNK_SIZE 1024
+
+/**
+ * @brief Solver for the gravity between asteroids.
+ */
+typedef enum
+{
+	ASTEROIDS_GRAVITY_NONE,		// Asteroids only feel the massive bodies
+	ASTEROIDS_GRAVITY_BARNES_HUT,
+	ASTEROIDS_GRAVITY_FMM
+} AsteroidsGravity_t;
+
+/**
+ * @brief Scheme that advances the simulation one timestep.
+ */
+typedef enum
+{
+	INTEGRATOR_EULER,		// Semi-implicit Euler (1st order, 1 force evaluation per step)
+	INTEGRATOR_LEAPFROG,		// Drift-kick-drift leapfrog (2nd order, 1 force evaluation per step)
+	INTEGRATOR_YOSHIDA,		// Yoshida composition of leapfrogs (4th order, 3 force evaluations per step)
+	INTEGRATOR_WISDOM_HOLMAN,	// Kepler drifts around the central star (1 force evaluation per step)
+	INTEGRATOR_BLOCK_LEAPFROG,	// Leapfrog with power of two steps per body (fewer evaluations for slow bodies)
+	INTEGRATOR_WISDOM_HOLMAN_JACOBI,	// Kepler drifts of each body around the ones inside its orbit (Jacobi coordinates)
+	INTEGRATORS_AMOUNT
+} Integrator_t;
+
+/**
+ * @brief How a simulation is solved. None of it is part of the state, so it
+ *		can be chosen again when a checkpoint is restored.
+ */
+typedef struct
+{
+	unsigned int threadsNum;		// Threads updating the asteroids (0 uses every hardware thread), the results do not depend on it
+	AsteroidsGravity_t asteroidsGravity;	// Solver for the gravity between asteroids
+	double openingAngle;			// Opening angle of the solver, 0 sums every pair directly
+	unsigned int expansionOrder;		// Expansion order of the FMM solver (1 to FMM_ORDER_MAX)
+	Integrator_t integrator;		// Scheme that advances each timestep
+	GravityPrecision_t asteroidsPrecision;	// Precision of the pull of the massive bodies on the asteroids
+	int masslessAsteroids;			// The bodies do not feel the asteroids (meant for ASTEROIDS_GRAVITY_NONE)
+} OrbitalSimSettings_t;
 
 /**
  * @brief Orbital simulation definition.
@@ -21,11 +69,37 @@ typedef struct
 	double dt;			// In seconds
 	double timeElapsed;		// In seconds
 	EphemeridesBody_t* PlanetarySystem;
-	Body_t* Asteroids;
+	BodyArrays_t* Asteroids;
 	EphemeridesBody_t SpaceShip;
 	BlackHole_t BlackHole;
 	unsigned int bodyNum;
 	unsigned int asteroidsNum;
+	ThreadPool_t* threadPool;		// Updates the asteroids
+	vector3D_t* asteroidsReactions;		// Pull of each asteroid chunk on each body
+	GravitySource_t gravitySources[GRAVITY_SOURCES_MAX];	// Bodies pulling the asteroids
+	GravityPrecision_t asteroidsPrecision;	// Precision of their pull
+	int masslessAsteroids;			// Set if the asteroids do not pull the bodies back
+	gravityKernel_t gravityKernel;		// Widest kernel the CPU supports at that precision
+	Octree_t* octree;			// Barnes-Hut gravity between asteroids (NULL if not selected)
+	FastMultipole_t* fastMultipole;		// FMM gravity between asteroids (NULL if not selected)
+	Integrator_t integrator;
+	double kick;			// Time the current force evaluation kicks the bodies for [s]
+	double drift;			// Time the bodies drift for after that kick [s]
+	int accelerationsValid;		// Set while the accelerations match the positions
+	double asteroidsKick;		// Kick and drift of the level 0 asteroid chunks [s]
+	double asteroidsDrift;
+	unsigned int activeChunks;	// Asteroid chunks updated by the current force evaluation
+	unsigned char* asteroidsLevels;	// Block level of each asteroid, steps of dt / 2^level (NULL if not selected)
+	unsigned char* chunksLevels;	// Block level of each asteroid chunk, the finest of its asteroids
+	BodyArrays_t* sortedAsteroids;	// Scratch arrays to sort the asteroids by level
+	unsigned int* asteroidsIds;	// Index each asteroid had when it was generated, follows it when it moves
+	unsigned int* sortedAsteroidsIds;	// Scratch ids to sort the asteroids by level
+	unsigned long long interactionsNum;	// Body-body pulls calculated so far (for benchmarks)
+	unsigned char* absorbedAsteroids;	// Set for the asteroids inside the black hole (NULL without black hole)
+	unsigned int* chunksAbsorbed;	// Asteroids flagged in each chunk since the last removal
+	vector3D_t absorbCenter;	// Black hole position at the end of the current force evaluation
+	unsigned int asteroidsOrder;	// Bumped whenever asteroids change index (absorbed or sorted)
+	unsigned int spaceShipEngines;	// Engines firing during the next updates, bit i for movementKeyIsDown[i]
 } OrbitalSim_t;
 
 /**
@@ -34,10 +108,32 @@ typedef struct
  * @param asteroidsNum The amount of asteroids in the simulation.
  * @param easter_egg Activates or deactivates the easter egg.
  * @param System Selects the system to simulate (solar system or alpha centauri sistem).
+ * @param spawnBlackHole Adds the black hole to the simulation.
+ * @param seed Seed of the asteroids and the SpaceShip. A seed always gives
+ *		the same simulation, whatever the machine or the amount of threads.
+ * @param settings Pointer to how the simulation is solved.
  *
  * @return The orbital simulation.
  */
-OrbitalSim_t* constructOrbitalSim(unsigned int asteroidsNum, int easter_egg, int System, int spawnBlackHole);
+OrbitalSim_t* constructOrbitalSim(unsigned int asteroidsNum, int easter_egg, int System, int spawnBlackHole, unsigned int seed,
+				const OrbitalSimSettings_t* settings);
+
+/**
+ * @brief Constructs an orbital simulation around asteroids that already exist,
+ *		instead of generating them. Everything else starts as in constructOrbitalSim.
+ *
+ * @param asteroids The asteroid arrays. The simulation owns them from then on,
+ *		they are destroyed along with it (or right away if it cannot be constructed).
+ * @param asteroidsNum The amount of asteroids stored in the arrays.
+ * @param System Selects the system to simulate (solar system or alpha centauri sistem).
+ * @param spawnBlackHole Adds the black hole to the simulation.
+ * @param seed Seed of the SpaceShip.
+ * @param settings Pointer to how the simulation is solved.
+ *
+ * @return The orbital simulation.
+ */
+OrbitalSim_t* constructOrbitalSimWithAsteroids(BodyArrays_t* asteroids, unsigned int asteroidsNum, int System, int spawnBlackHole,
+						unsigned int seed, const OrbitalSimSettings_t* settings);
 
 /**
  * @brief Destroys an orbital simulation.
@@ -53,4 +149,45 @@ void destroyOrbitalSim(OrbitalSim_t* sim);
  */
 void updateOrbitalSim(OrbitalSim_t* sim, int spawnBH);
 
+/**
+ * @brief Hashes the state of a simulation: the time elapsed, and the position
+ *		and velocity of every body, the SpaceShip, the black hole and each
+ *		asteroid (along with its id). The hash of a state is the same on
+ *		every machine, so two runs that print the same hashes matched bit for bit.
+ *
+ * @param sim Pointer to the simulation.
+ *
+ * @return The hash.
+ */
+unsigned long long getOrbitalSimHash(const OrbitalSim_t* sim);
+
+/**
+ * @brief Reads the movement keys into the engines of the SpaceShip. They keep
+ *		firing that way, for whole updates, until they are read again.
+ *
+ * @param sim Pointer to the simulation.
+ */
+void readSpaceShipInputs(OrbitalSim_t* sim);
+
+/**
+ * @brief Gets the name of an integrator.
+ *
+ * @param integrator The integrator.
+ *
+ * @return The name ("Euler", "Leapfrog", "Yoshida", "Wisdom-Holman", "Block leapfrog"
+ *		or "Wisdom-Holman (Jacobi)").
+ */
+const char* getIntegratorName(Integrator_t integrator);
+
+/**
+ * @brief Compares the FMM solver against a direct sum, for a sample of asteroids.
+ *
+ * @param sim Pointer to the simulation.
+ * @param sampleNum The amount of asteroids compared.
+ *
+ * @return The largest acceleration error relative to the RMS acceleration of the sample
+ *		(-1 if the FMM solver is not selected or the memory could not be allocated).
+ */
+double getAsteroidsGravityError(OrbitalSim_t* sim, unsigned int sampleNum);
+
 #endif
\ No newline at end of file
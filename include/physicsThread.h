@@ -0,0 +1,116 @@
+/**
+ * @brief Physics thread, decoupled from the render loop
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include "orbitalSim.h"
+#include "trails.h"
+#include "recorder.h"
+#include "history.h"
+#include "frameGovernor.h"
+
+/**
+ * @brief Copy of everything the view draws, published by the physics thread.
+ */
+typedef struct
+{
+	double timeElapsed;		// In seconds
+	unsigned int bodyNum;
+	unsigned int asteroidsNum;
+	unsigned long long interactionsNum;	// Body-body pulls calculated so far
+	EphemeridesBody_t* PlanetarySystem;
+	BodyArrays_t* Asteroids;	// Only positions, velocities and accelerations are copied
+	EphemeridesBody_t SpaceShip;
+	BlackHole_t BlackHole;
+	Trails_t* trails;		// Orbit trails (NULL if the snapshot does not carry them)
+} SimSnapshot_t;
+
+typedef struct PhysicsThread PhysicsThread_t;
+
+/**
+ * @brief Constructs a snapshot big enough for a simulation, without trails.
+ *
+ * @param sim Pointer to the simulation. Its body and asteroid counts are the
+ *		largest the snapshot can hold (they only go down).
+ *
+ * @return The snapshot (NULL if the memory could not be allocated).
+ */
+SimSnapshot_t* constructSimSnapshot(const OrbitalSim_t* sim);
+
+/**
+ * @brief Destroys a snapshot.
+ *
+ * @param snapshot Pointer to the snapshot.
+ */
+void destroySimSnapshot(SimSnapshot_t* snapshot);
+
+/**
+ * @brief Copies the current state of a simulation into a snapshot.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param sim Pointer to the simulation.
+ */
+void copySimSnapshot(SimSnapshot_t* snapshot, const OrbitalSim_t* sim);
+
+/**
+ * @brief Starts updating a simulation on its own thread. From then on only
+ *		that thread touches the simulation, until destroyPhysicsThread.
+ *
+ * @param sim Pointer to the simulation.
+ * @param spawnBH Lets the black hole absorb bodies.
+ * @param governor Governor of the timestep, copied and owned by the thread
+ *		from then on. The thread steps by sim->dt as often as needed to keep
+ *		up with its simulation speed, refits sim->dt after every run of
+ *		updates, and falls behind (slow motion) instead of catching up in
+ *		bursts when it cannot.
+ * @param recorder Records every update (NULL if nothing is recorded).
+ * @param history Keeps every update to rewind them (NULL if the simulation cannot rewind).
+ *
+ * @return The physics thread (NULL if it could not be started).
+ */
+PhysicsThread_t* constructPhysicsThread(OrbitalSim_t* sim, int spawnBH, const FrameGovernor_t* governor,
+					Recorder_t* recorder, History_t* history);
+
+/**
+ * @brief Stops and joins the physics thread.
+ *
+ * @param physics Pointer to the physics thread.
+ */
+void destroyPhysicsThread(PhysicsThread_t* physics);
+
+/**
+ * @brief Gets the latest snapshot published by the physics thread, without
+ *		locking. It stays valid until the next call, so it must only be
+ *		called from one thread.
+ *
+ * @param physics Pointer to the physics thread.
+ *
+ * @return The snapshot.
+ */
+const SimSnapshot_t* getPhysicsSnapshot(PhysicsThread_t* physics);
+
+/**
+ * @brief Sets the direction of the simulated time.
+ *
+ * @param physics Pointer to the physics thread.
+ * @param rewind If set the simulation goes back through its history, at the
+ *		same speed, and waits at the oldest step kept.
+ */
+void setPhysicsTimeDirection(PhysicsThread_t* physics, int rewind);
+
+/**
+ * @brief Tells the physics thread how long the view takes to draw a frame, so
+ *		it leaves the view enough time.
+ *
+ * @param physics Pointer to the physics thread.
+ * @param frametime Real time of the last frame [s].
+ */
+void setPhysicsFrametime(PhysicsThread_t* physics, double frametime);
+
+#endif
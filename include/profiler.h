@@ -0,0 +1,113 @@
+/**
+ * @brief Instrumentation of the hot paths
+ *
+ * Each stage is timed between beginProfilerStage and endProfilerStage. The
+ * totals of every stage feed the overlay of the view, and each thread also
+ * keeps its last events in a ring, written at the end as a Chrome trace
+ * (chrome://tracing or https://ui.perfetto.dev). While the profiler is
+ * disabled a stage costs a single relaxed load.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// File used by the -trace launch option
+#define PROFILER_TRACE_PATH "orbitalSim.trace.json"
+
+// Events each thread keeps for the trace, the oldest ones are overwritten
+#define PROFILER_RING_SIZE 65536
+
+// Threads that may record events, the stages of any other one only count in the totals
+#define PROFILER_THREADS_MAX 16
+
+typedef enum
+{
+	PROFILER_UPDATE,			// updateOrbitalSim
+	PROFILER_INITIALIZE_ACCELERATIONS,
+	PROFILER_UPDATE_ACCELERATIONS,
+	PROFILER_UPDATE_ASTEROIDS,
+	PROFILER_UPDATE_SPEEDS_AND_POSITIONS,
+	PROFILER_REMOVE_BODY,
+	PROFILER_DRAW_ENTITIES,			// drawOrbitalSimuationEntities
+	PROFILER_END_DRAWING,			// EndDrawing, waits for the GPU and the frame limiter
+	PROFILER_STAGES_AMOUNT
+} ProfilerStage_t;
+
+/**
+ * @brief A stage being timed.
+ */
+typedef struct
+{
+	ProfilerStage_t stage;
+	long long start;		// [ns] (-1 if the profiler was disabled)
+} ProfilerMark_t;
+
+/**
+ * @brief Totals of every stage since the program started.
+ */
+typedef struct
+{
+	unsigned long long time[PROFILER_STAGES_AMOUNT];	// [ns]
+	unsigned long long calls[PROFILER_STAGES_AMOUNT];
+} ProfilerTotals_t;
+
+/**
+ * @brief Enables or disables the profiler, for every thread.
+ *
+ * @param enabled Times the stages if set.
+ */
+void setProfilerEnabled(int enabled);
+
+/**
+ * @brief Starts timing a stage.
+ *
+ * @param stage The stage.
+ *
+ * @return The mark to end the stage with.
+ */
+ProfilerMark_t beginProfilerStage(ProfilerStage_t stage);
+
+/**
+ * @brief Ends timing a stage, on the thread that began it.
+ *
+ * @param mark The mark returned by beginProfilerStage.
+ */
+void endProfilerStage(ProfilerMark_t mark);
+
+/**
+ * @brief Gets the totals of every stage. Any thread may call it.
+ *
+ * @param totals Where the totals are stored.
+ */
+void getProfilerTotals(ProfilerTotals_t* totals);
+
+/**
+ * @brief Gets the name of a stage.
+ *
+ * @param stage The stage.
+ *
+ * @return The name.
+ */
+const char* getProfilerStageName(ProfilerStage_t stage);
+
+/**
+ * @brief Writes the events kept by every thread as a Chrome trace. No other
+ *		thread may be recording meanwhile.
+ *
+ * @param path Path of the trace, replaced if it exists.
+ * @param eventsNum Where the amount of events written is stored (NULL if not needed).
+ *
+ * @return 1 if the trace was written, 0 if not.
+ */
+int writeProfilerTrace(const char* path, unsigned long long* eventsNum);
+
+/**
+ * @brief Frees the rings of every thread. No thread may record afterwards.
+ */
+void destroyProfiler(void);
+
+#endif
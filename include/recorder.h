@@ -0,0 +1,111 @@
+/**
+ * @brief Trajectory recording for offline analysis
+ *
+ * A record is a RecordHeader_t followed by frames, each one a
+ * RecordFrameHeader_t and its payload. The uncompressed payload is a run of
+ * 32 bit words, every value a float:
+ *	- x, y, z, vx, vy, vz of each massive body [m, m/s]
+ *	- the same six values for the spaceship, then for the black hole
+ *	- the id of each asteroid (an unsigned int, its index when it was generated)
+ *	- the x array of the asteroids, then y, z, vx, vy and vz
+ *
+ * Delta frames are XORed, word by word, with the payload of the previous
+ * frame. Packed payloads are shuffled into four byte planes (byte 0 of every
+ * word, then byte 1...) and then run length encoded: a control byte c < 128
+ * is followed by c + 1 literal bytes, c >= 128 stands for c - 126 zeros.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "orbitalSim.h"
+
+#define RECORD_VERSION 1
+#define RECORD_MAGIC "ORBITREC"
+#define RECORD_FRAME_MAGIC "FRAM"
+
+// File used by the -record launch option
+#define RECORD_PATH "orbitalSim.record"
+
+// Frames the simulation may be ahead of the disk, the next ones are dropped
+#define RECORD_QUEUE_SIZE 4
+
+// Delta frames between two frames that decode on their own
+#define RECORD_KEYFRAME_INTERVAL 64
+
+// RecordFrameHeader_t flags
+#define RECORD_FRAME_DELTA 0x1U		// XORed with the previous frame
+#define RECORD_FRAME_PACKED 0x2U	// Shuffled and run length encoded
+
+/**
+ * @brief First bytes of a record.
+ */
+typedef struct
+{
+	char magic[8];			// RECORD_MAGIC
+	unsigned int version;		// RECORD_VERSION
+	unsigned int byteOrder;		// 0x01020304 as the recording machine stored it
+	unsigned int interval;		// Steps between frames
+	unsigned int delta;		// Frames are delta encoded and packed
+	unsigned int system;		// 0 solar system, 1 alpha centauri
+	unsigned int reserved;
+	double dt;			// When the recording started [s]
+} RecordHeader_t;
+
+/**
+ * @brief Header of each frame.
+ */
+typedef struct
+{
+	char magic[4];			// RECORD_FRAME_MAGIC
+	unsigned int flags;
+	unsigned int bodyNum;
+	unsigned int asteroidsNum;
+	unsigned int wordsNum;		// Size of the payload once unpacked [words]
+	unsigned int size;		// Size of the stored payload [bytes]
+	unsigned long long step;	// Updates since the recording started
+	double timeElapsed;		// [s]
+} RecordFrameHeader_t;
+
+typedef struct Recorder Recorder_t;
+
+/**
+ * @brief Creates a record and starts the thread that writes it.
+ *
+ * @param path Path of the record, replaced if it exists.
+ * @param sim Pointer to the simulation. Its body and asteroid counts are the
+ *		largest a frame can hold (they only go down).
+ * @param interval Updates between frames.
+ * @param delta Delta encodes and packs the frames.
+ *
+ * @return The recorder (NULL if the file could not be created or the memory allocated).
+ */
+Recorder_t* constructRecorder(const char* path, const OrbitalSim_t* sim, unsigned int interval, int delta);
+
+/**
+ * @brief Writes the frames still queued, then closes the record.
+ *
+ * @param recorder Pointer to the recorder.
+ * @param framesNum Where the amount of frames written is stored (NULL if not needed).
+ * @param droppedNum Where the amount of frames dropped because the queue was full
+ *		is stored (NULL if not needed).
+ *
+ * @return 1 if every write succeeded, 0 if the disk failed and the recording stopped.
+ */
+int destroyRecorder(Recorder_t* recorder, unsigned long long* framesNum, unsigned long long* droppedNum);
+
+/**
+ * @brief Counts an update, and queues a frame every interval updates. Never
+ *		waits for the disk: if the queue is full the frame is dropped.
+ *		Must always be called from the same thread.
+ *
+ * @param recorder Pointer to the recorder.
+ * @param sim Pointer to the simulation.
+ */
+void recordOrbitalSim(Recorder_t* recorder, const OrbitalSim_t* sim);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @brief Fixed size pool of worker threads
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/**
+ * @brief Work executed by the pool, once per task index.
+ *
+ * @param data Pointer shared by every task.
+ * @param taskIndex Index of the task, from 0 to tasksNum - 1.
+ */
+typedef void (*threadPoolTask_t)(void* data, unsigned int taskIndex);
+
+typedef struct ThreadPool ThreadPool_t;
+
+/**
+ * @brief Constructs a thread pool.
+ *
+ * @param threadsNum The amount of threads that run tasks, including the caller
+ *		of runThreadPool (0 uses every hardware thread).
+ *
+ * @return The thread pool.
+ */
+ThreadPool_t* constructThreadPool(unsigned int threadsNum);
+
+/**
+ * @brief Destroys a thread pool, joining its threads.
+ *
+ * @param pool Pointer to the thread pool.
+ */
+void destroyThreadPool(ThreadPool_t* pool);
+
+/**
+ * @brief Runs a task for every index in [0, tasksNum) and waits for all of them.
+ *		Tasks are handed out dynamically, so they must not depend on which
+ *		thread runs them.
+ *
+ * @param pool Pointer to the thread pool.
+ * @param task The task.
+ * @param data Pointer passed to every task.
+ * @param tasksNum The amount of tasks.
+ */
+void runThreadPool(ThreadPool_t* pool, threadPoolTask_t task, void* data, unsigned int tasksNum);
+
+/**
+ * @brief Gets the amount of threads that run tasks.
+ *
+ * @param pool Pointer to the thread pool.
+ *
+ * @return The amount of threads, including the caller of runThreadPool.
+ */
+unsigned int getThreadPoolSize(const ThreadPool_t* pool);
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @brief Orbit trails, recorded by the physics side
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#ifndef TRAILS_H
+#define TRAILS_H
+
+#include "orbitalSim.h"
+
+// Samples kept per trail
+#define TRAILS_LENGTH 256
+
+// Simulated time between samples, whatever the amount of updates per frame [s]
+#define TRAILS_SAMPLE_INTERVAL (2 * 24 * 60 * 60)
+
+// Most asteroids leaving a trail, evenly spread over the belt
+#define TRAILS_ASTEROIDS_MAX 256
+
+// Index of the asteroid of a trail once it is gone (absorbed)
+#define TRAILS_ASTEROID_GONE 0xFFFFFFFFU
+
+/**
+ * @brief Recent positions of the massive bodies, the spaceship and a subset of
+ *		the asteroids, in a ring buffer shared by every trail.
+ */
+typedef struct
+{
+	unsigned int trailsNum;		// Massive bodies, then the spaceship, then the sampled asteroids
+	unsigned int bodiesTrailsNum;	// Trails of the massive bodies (their amount at construction)
+	unsigned int asteroidsStride;	// Asteroids generated with an id multiple of asteroidsStride leave a trail
+	unsigned int length;		// Samples kept per trail
+	unsigned long long samplesNum;	// Samples taken so far, the next one goes to slot samplesNum % length
+	unsigned long long resetsNum;	// Times some trails were collapsed, readers must copy every slot again
+	vector3D_t* positions;		// Slot major: positions[slot * trailsNum + trail] [m]
+
+	// Only used by the physics side
+	double lastSampleTime;		// [s]
+	unsigned int bodyNum;		// Massive bodies at the last sample
+	unsigned int asteroidsOrder;	// sim->asteroidsOrder at the last sample
+	unsigned int* asteroidsIndices;	// Index of the asteroid each asteroid trail follows, found by its id
+} Trails_t;
+
+/**
+ * @brief Constructs the trails of a simulation, every one collapsed on its body.
+ *
+ * @param sim Pointer to the simulation.
+ *
+ * @return The trails (NULL if the memory could not be allocated).
+ */
+Trails_t* constructTrails(const OrbitalSim_t* sim);
+
+/**
+ * @brief Destroys the trails.
+ *
+ * @param trails Pointer to the trails.
+ */
+void destroyTrails(Trails_t* trails);
+
+/**
+ * @brief Takes a sample if TRAILS_SAMPLE_INTERVAL of simulated time went by
+ *		since the last one, otherwise returns right away. The trails of the
+ *		massive bodies are collapsed when one is absorbed (the rest change
+ *		index). Asteroid trails follow the id of their asteroid wherever it
+ *		is sorted, and are only collapsed when it is absorbed (or comes back
+ *		on a rewind).
+ *
+ * @param trails Pointer to the trails.
+ * @param sim Pointer to the simulation.
+ */
+void updateTrails(Trails_t* trails, const OrbitalSim_t* sim);
+
+/**
+ * @brief Copies the samples taken since the last copy, or every slot if the
+ *		destination fell a whole ring behind or some trails were collapsed.
+ *
+ * @param destination Pointer to the trails copied to, constructed from the same simulation.
+ * @param source Pointer to the trails copied from.
+ */
+void copyTrails(Trails_t* destination, const Trails_t* source);
+
+#endif
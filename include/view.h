@@ -12,9 +12,42 @@
 #ifndef ORBITALSIMVIEW_H
 #define ORBITALSIMVIEW_H
 
-#include "orbitalSim.h"
+#include "physicsThread.h"
+#include "profiler.h"
 #include <raylib.h>
 
+/**
+ * The orbit trails, kept on the GPU
+ */
+typedef struct
+{
+	int state;				// 0 until the first trails arrive, 1 on the GPU, -1 drawn from the snapshot
+	unsigned int vao;
+	unsigned int positionsVbo;		// One segment per trail and slot, as a degenerate triangle
+	unsigned int colorsVbo;
+	Shader shader;
+	unsigned long long samplesNum;		// Samples uploaded so far
+	unsigned long long resetsNum;
+	unsigned int bodyNum;			// Massive bodies the colors were set for
+	Vector3* segments;			// Segments of one slot, staged for the upload
+	Color* colors;				// Colors of every slot, staged for the upload
+} trailsView_t;
+
+/**
+ * The profiler overlay, averaged over the frames between two samples
+ */
+typedef struct
+{
+	int shown;				// Set if the overlay was drawn on the last frame
+	double time;				// When the last sample was taken [s]
+	unsigned long long framesNum;		// Frames drawn since the last sample
+	unsigned long long interactionsNum;	// Of the snapshot at the last sample
+	ProfilerTotals_t totals;		// At the last sample
+	double stagesTime[PROFILER_STAGES_AMOUNT];	// Per frame [ms]
+	double stagesCalls[PROFILER_STAGES_AMOUNT];	// Per frame
+	double interactionsPerSecond;
+} profilerView_t;
+
 /**
  * The view data
  */
@@ -22,6 +55,16 @@ typedef struct
 {
 	Camera3D camera;
 	int width, height;
+	Mesh asteroidsMesh;			// Sphere drawn for every asteroid by one instanced call
+	Material asteroidsMaterial;		// Holds the instancing shader
+	Matrix* asteroidsTransforms;		// Position of each asteroid drawn as a sphere, uploaded every frame
+	Vector3* asteroidsPoints;		// Line ends of each asteroid drawn as a point
+	unsigned int asteroidsCapacity;		// Amount of asteroids both buffers can hold
+	int asteroidsInstancing;		// Set if the instancing shader could be compiled
+	Vector3* vectorsLines;			// Velocity and acceleration vectors of every body, rebuilt every frame
+	unsigned int vectorsCapacity;		// Amount of line ends allocated
+	trailsView_t trails;
+	profilerView_t profiler;
 } view_t;
 
 /**
@@ -33,10 +76,12 @@ typedef struct
  * @param height Sets a value to the window's height.
  * @param show_velocity_vectors Activates the velocity vectors.
  * @param show_acceleration_vectors Activates the acceleration vectors.
+ * @param show_trails Activates the orbit trails.
  *
  * @return The view.
  */
-view_t* constructView(int fps, int fullscreen, int width, int height, int show_velocity_vectors, int show_acceleration_vectors);
+view_t* constructView(int fps, int fullscreen, int width, int height, int show_velocity_vectors, int show_acceleration_vectors,
+			int show_trails);
 
 /**
  * @brief Destroys an orbital simulation view.
@@ -58,8 +103,8 @@ bool isViewRendering(view_t* view);
  * @brief Renders an orbital simulation.
  *
  * @param view The view.
- * @param sim The orbital sim.
+ * @param sim Snapshot of the orbital sim.
  */
-void renderView(view_t* view, OrbitalSim_t* sim);
+void renderView(view_t* view, const SimSnapshot_t* sim);
 
 #endif
\ No newline at end of file
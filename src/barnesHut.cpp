@@ -0,0 +1,380 @@
+/**
+ * @brief Barnes-Hut octree for the gravity between asteroids
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "barnesHut.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define OCTREE_MAX_DEPTH 32		// Keeps coincident bodies from splitting forever
+#define OCTREE_STACK_SIZE (7 * OCTREE_MAX_DEPTH + 8)
+
+#define OCTREE_SORTED_ARRAYS 4		// x, y, z, mass_GC
+
+/**
+ * @brief Makes room for the bodies and the scratch arrays used to sort them.
+ *
+ * @param tree Pointer to the octree.
+ * @param bodyNum The amount of bodies.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+static int reserveBodies(Octree_t* tree, unsigned int bodyNum);
+
+/**
+ * @brief Makes room for more nodes in the arena.
+ *
+ * @param tree Pointer to the octree.
+ * @param nodesNum The amount of nodes to add.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+static int reserveNodes(Octree_t* tree, unsigned int nodesNum);
+
+/**
+ * @brief Gets the octant of a node a point lies in.
+ *
+ * @param node Pointer to the node.
+ * @param x, y, z The point [m].
+ *
+ * @return The octant (bit 0: +x, bit 1: +y, bit 2: +z).
+ */
+static inline unsigned int getOctant(const OctreeNode_t* node, double x, double y, double z);
+
+/**
+ * @brief Splits a node into 8 children (recursively) and sets its mass and center of mass.
+ *
+ * @param tree Pointer to the octree.
+ * @param nodeIndex Index of the node.
+ * @param depth Depth of the node.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+static int splitNode(Octree_t* tree, unsigned int nodeIndex, unsigned int depth);
+
+/**
+ * @brief Adds the pull of a point mass to an acceleration.
+ *
+ * @param tree Pointer to the octree.
+ * @param acceleration The acceleration.
+ * @param position Where the acceleration is calculated [m].
+ * @param x, y, z The point mass position [m].
+ * @param mass_GC The point mass [m^3 / s^2].
+ */
+static inline void addPull(const Octree_t* tree, vector3D_t* acceleration, vector3D_t position,
+			double x, double y, double z, double mass_GC);
+
+Octree_t* constructOctree(double openingAngle, double softening, unsigned int leafSize)
+{
+	Octree_t* tree = new Octree_t;
+	if (!tree)
+		return NULL;
+
+	tree->nodes = NULL;
+	tree->nodesNum = 0;
+	tree->nodesCapacity = 0;
+	tree->x = tree->y = tree->z = tree->mass_GC = NULL;
+	tree->index = NULL;
+	tree->bodyNum = 0;
+	tree->bodiesCapacity = 0;
+	tree->bodiesMemory = NULL;
+	tree->openingAngle = openingAngle;
+	tree->softening = softening;
+	tree->leafSize = (leafSize) ? leafSize : 1;
+
+	return tree;
+}
+
+void destroyOctree(Octree_t* tree)
+{
+	if (!tree)
+		return;
+	free(tree->nodes);
+	free(tree->bodiesMemory);
+	delete tree;
+}
+
+int buildOctree(Octree_t* tree, const BodyArrays_t* bodies, unsigned int bodyNum)
+{
+	// The arena is rewound, not freed
+	tree->nodesNum = 0;
+	tree->bodyNum = 0;
+	if (reserveBodies(tree, bodyNum))
+		return -1;
+
+	vector3D_t min = {0.0, 0.0, 0.0};
+	vector3D_t max = {0.0, 0.0, 0.0};
+
+	for (unsigned int i = 0; i < bodyNum; i++)
+	{
+		tree->x[i] = bodies->x[i];
+		tree->y[i] = bodies->y[i];
+		tree->z[i] = bodies->z[i];
+		tree->mass_GC[i] = bodies->mass_GC[i];
+		tree->index[i] = i;
+
+		if (!i)
+		{
+			min.x = max.x = bodies->x[i];
+			min.y = max.y = bodies->y[i];
+			min.z = max.z = bodies->z[i];
+			continue;
+		}
+		min.x = fmin(min.x, bodies->x[i]);
+		min.y = fmin(min.y, bodies->y[i]);
+		min.z = fmin(min.z, bodies->z[i]);
+		max.x = fmax(max.x, bodies->x[i]);
+		max.y = fmax(max.y, bodies->y[i]);
+		max.z = fmax(max.z, bodies->z[i]);
+	}
+	tree->bodyNum = bodyNum;
+
+	if (reserveNodes(tree, 1))
+		return -1;
+	tree->nodesNum = 1;
+
+	OctreeNode_t* root = tree->nodes;
+	root->center.x = (min.x + max.x) / 2;
+	root->center.y = (min.y + max.y) / 2;
+	root->center.z = (min.z + max.z) / 2;
+	root->halfSize = fmax(fmax(max.x - min.x, max.y - min.y), max.z - min.z) / 2;
+	root->halfSize = (root->halfSize > 0.0) ? root->halfSize * (1.0 + 1E-9) : 1.0;
+	root->firstChild = 0;
+	root->firstBody = 0;
+	root->bodyNum = bodyNum;
+
+	if (splitNode(tree, 0, 0))
+	{
+		tree->nodesNum = 0;
+		return -1;
+	}
+	return 0;
+}
+
+vector3D_t getOctreeAcceleration(const Octree_t* tree, vector3D_t position, unsigned int index)
+{
+	vector3D_t acceleration = {0.0, 0.0, 0.0};
+	unsigned int stack[OCTREE_STACK_SIZE];
+	unsigned int stackSize = 0;
+	double openingAngle_squared = tree->openingAngle * tree->openingAngle;
+
+	if (tree->nodesNum && tree->nodes[0].bodyNum)
+		stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const OctreeNode_t* node = tree->nodes + stack[--stackSize];
+
+		if (!node->firstChild)
+		{
+			for (unsigned int k = node->firstBody; k < node->firstBody + node->bodyNum; k++)
+			{
+				if (tree->index[k] == index)
+					continue;
+				addPull(tree, &acceleration, position, tree->x[k], tree->y[k], tree->z[k], tree->mass_GC[k]);
+			}
+			continue;
+		}
+
+		vector3D_t diff;
+		diff.x = node->centerOfMass.x - position.x;
+		diff.y = node->centerOfMass.y - position.y;
+		diff.z = node->centerOfMass.z - position.z;
+
+		double size = 2 * node->halfSize;
+		int isInside =	fabs(position.x - node->center.x) <= node->halfSize &&
+				fabs(position.y - node->center.y) <= node->halfSize &&
+				fabs(position.z - node->center.z) <= node->halfSize;
+
+		if (!isInside && size * size < openingAngle_squared * DOT_PRODUCT(diff, diff))
+		{
+			addPull(tree, &acceleration, position, node->centerOfMass.x, node->centerOfMass.y,
+				node->centerOfMass.z, node->mass_GC);
+			continue;
+		}
+
+		for (unsigned int octant = 0; octant < 8; octant++)
+		{
+			if (tree->nodes[node->firstChild + octant].bodyNum)
+				stack[stackSize++] = node->firstChild + octant;
+		}
+	}
+
+	return acceleration;
+}
+
+static int reserveBodies(Octree_t* tree, unsigned int bodyNum)
+{
+	if (bodyNum <= tree->bodiesCapacity && tree->bodiesMemory)
+		return 0;
+
+	unsigned int capacity = (bodyNum > 2 * tree->bodiesCapacity) ? bodyNum : 2 * tree->bodiesCapacity;
+	capacity = (capacity) ? capacity : 1;
+
+	// Sorted arrays and their scratch copies, then both index arrays
+	void* memory = malloc(capacity * 2 * (OCTREE_SORTED_ARRAYS * sizeof(double) + sizeof(unsigned int)));
+	if (!memory)
+		return -1;
+
+	free(tree->bodiesMemory);
+	tree->bodiesMemory = memory;
+	tree->bodiesCapacity = capacity;
+	tree->x = (double*)memory;
+	tree->y = tree->x + capacity;
+	tree->z = tree->y + capacity;
+	tree->mass_GC = tree->z + capacity;
+	tree->index = (unsigned int*)(tree->x + 2 * OCTREE_SORTED_ARRAYS * capacity);
+
+	return 0;
+}
+
+static int reserveNodes(Octree_t* tree, unsigned int nodesNum)
+{
+	if (tree->nodesNum + nodesNum <= tree->nodesCapacity)
+		return 0;
+
+	unsigned int capacity = 2 * tree->nodesCapacity;
+	capacity = (capacity < tree->nodesNum + nodesNum) ? tree->nodesNum + nodesNum : capacity;
+
+	OctreeNode_t* nodes = (OctreeNode_t*)realloc(tree->nodes, sizeof(OctreeNode_t) * capacity);
+	if (!nodes)
+		return -1;
+
+	tree->nodes = nodes;
+	tree->nodesCapacity = capacity;
+	return 0;
+}
+
+static inline unsigned int getOctant(const OctreeNode_t* node, double x, double y, double z)
+{
+	return (x >= node->center.x) | ((y >= node->center.y) << 1) | ((z >= node->center.z) << 2);
+}
+
+static int splitNode(Octree_t* tree, unsigned int nodeIndex, unsigned int depth)
+{
+	// Copied, as growing the arena may move the nodes
+	OctreeNode_t node = tree->nodes[nodeIndex];
+	unsigned int last = node.firstBody + node.bodyNum;
+	unsigned int k, octant;
+
+	if (node.bodyNum <= tree->leafSize || depth >= OCTREE_MAX_DEPTH)
+	{
+		vector3D_t weighted = {0.0, 0.0, 0.0};
+		double mass_GC = 0.0;
+
+		for (k = node.firstBody; k < last; k++)
+		{
+			weighted.x += tree->mass_GC[k] * tree->x[k];
+			weighted.y += tree->mass_GC[k] * tree->y[k];
+			weighted.z += tree->mass_GC[k] * tree->z[k];
+			mass_GC += tree->mass_GC[k];
+		}
+
+		OctreeNode_t* leaf = tree->nodes + nodeIndex;
+		leaf->mass_GC = mass_GC;
+		leaf->centerOfMass.x = (mass_GC > 0.0) ? weighted.x / mass_GC : node.center.x;
+		leaf->centerOfMass.y = (mass_GC > 0.0) ? weighted.y / mass_GC : node.center.y;
+		leaf->centerOfMass.z = (mass_GC > 0.0) ? weighted.z / mass_GC : node.center.z;
+		return 0;
+	}
+
+	// Counting sort of the node's bodies by octant, through the scratch arrays
+	unsigned int count[8] = {0};
+	unsigned int first[8];
+	unsigned int next[8];
+	unsigned int capacity = tree->bodiesCapacity;
+	double* sorted[OCTREE_SORTED_ARRAYS] = {tree->x, tree->y, tree->z, tree->mass_GC};
+	unsigned int* scratchIndex = tree->index + capacity;
+
+	for (k = node.firstBody; k < last; k++)
+	{
+		count[getOctant(&node, tree->x[k], tree->y[k], tree->z[k])]++;
+	}
+	for (octant = 0; octant < 8; octant++)
+	{
+		first[octant] = (octant) ? first[octant - 1] + count[octant - 1] : node.firstBody;
+		next[octant] = first[octant];
+	}
+	for (k = node.firstBody; k < last; k++)
+	{
+		unsigned int destination = next[getOctant(&node, tree->x[k], tree->y[k], tree->z[k])]++;
+
+		for (int array = 0; array < OCTREE_SORTED_ARRAYS; array++)
+			sorted[array][destination + OCTREE_SORTED_ARRAYS * capacity] = sorted[array][k];
+		scratchIndex[destination] = tree->index[k];
+	}
+	for (int array = 0; array < OCTREE_SORTED_ARRAYS; array++)
+	{
+		memcpy(sorted[array] + node.firstBody, sorted[array] + node.firstBody + OCTREE_SORTED_ARRAYS * capacity,
+			sizeof(double) * node.bodyNum);
+	}
+	memcpy(tree->index + node.firstBody, scratchIndex + node.firstBody, sizeof(unsigned int) * node.bodyNum);
+
+	if (reserveNodes(tree, 8))
+		return -1;
+
+	unsigned int firstChild = tree->nodesNum;
+	double halfSize = node.halfSize / 2;
+
+	tree->nodesNum += 8;
+	tree->nodes[nodeIndex].firstChild = firstChild;
+
+	for (octant = 0; octant < 8; octant++)
+	{
+		OctreeNode_t* child = tree->nodes + firstChild + octant;
+
+		child->center.x = node.center.x + ((octant & 1) ? halfSize : -halfSize);
+		child->center.y = node.center.y + ((octant & 2) ? halfSize : -halfSize);
+		child->center.z = node.center.z + ((octant & 4) ? halfSize : -halfSize);
+		child->halfSize = halfSize;
+		child->firstChild = 0;
+		child->firstBody = first[octant];
+		child->bodyNum = count[octant];
+	}
+
+	vector3D_t weighted = {0.0, 0.0, 0.0};
+	double mass_GC = 0.0;
+
+	for (octant = 0; octant < 8; octant++)
+	{
+		if (splitNode(tree, firstChild + octant, depth + 1))
+			return -1;
+
+		const OctreeNode_t* child = tree->nodes + firstChild + octant;
+		weighted.x += child->mass_GC * child->centerOfMass.x;
+		weighted.y += child->mass_GC * child->centerOfMass.y;
+		weighted.z += child->mass_GC * child->centerOfMass.z;
+		mass_GC += child->mass_GC;
+	}
+
+	OctreeNode_t* parent = tree->nodes + nodeIndex;
+	parent->mass_GC = mass_GC;
+	parent->centerOfMass.x = (mass_GC > 0.0) ? weighted.x / mass_GC : node.center.x;
+	parent->centerOfMass.y = (mass_GC > 0.0) ? weighted.y / mass_GC : node.center.y;
+	parent->centerOfMass.z = (mass_GC > 0.0) ? weighted.z / mass_GC : node.center.z;
+
+	return 0;
+}
+
+static inline void addPull(const Octree_t* tree, vector3D_t* acceleration, vector3D_t position,
+			double x, double y, double z, double mass_GC)
+{
+	vector3D_t pull;
+	double inverse_distance_cubed;
+
+	pull.x = x - position.x;
+	pull.y = y - position.y;
+	pull.z = z - position.z;
+
+	inverse_distance_cubed = 1 / sqrt(DOT_PRODUCT(pull, pull) + tree->softening * tree->softening);
+	inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+
+	acceleration->x += mass_GC * pull.x * inverse_distance_cubed;
+	acceleration->y += mass_GC * pull.y * inverse_distance_cubed;
+	acceleration->z += mass_GC * pull.z * inverse_distance_cubed;
+}
@@ -0,0 +1,424 @@
+/**
+ * @brief Orbital simulation benchmark
+ *
+ * Sweeps asteroid counts, systems and integrators, timing every update with a
+ * monotonic clock, and prints one CSV (or JSON) record per configuration.
+ * With -drift it instead runs every system and integrator at both gravity
+ * precisions from the same start, and reports how far the mixed precision
+ * asteroids end up from the double precision ones. Close encounters amplify
+ * any difference, so the percentiles tell more than the maximum.
+ * With -massless the asteroids are test particles in every run.
+ *
+ * Usage: orbitalsim_bench [-steps <n>] [-threads <n>] [-json] [-drift] [-massless]
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "orbitalSim.h"
+#include "gravityKernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define BENCH_DEFAULT_STEPS 200
+#define BENCH_WARMUP_STEPS 10
+#define BENCH_SEED 1
+#define BENCH_DRIFT_DEFAULT_STEPS 3650
+#define BENCH_DRIFT_ASTEROIDS 10000
+#define SECONDS_PER_HOUR (60 * 60)
+#define SECONDS_PER_DAY (24 * SECONDS_PER_HOUR)
+#define METERS_PER_KILOMETER 1E3
+
+static const unsigned int asteroidsAmounts[] = {0, 1000, 10000, 100000};
+static const int systems[] = {0, 1};
+
+/**
+ * @brief Result of one configuration.
+ */
+typedef struct
+{
+	unsigned int asteroidsNum;
+	int system;
+	Integrator_t integrator;
+	unsigned int steps;
+	double stepsPerSecond;
+	double nsPerInteraction;
+	double latencyUs[4];		// p50, p90, p99 and max [us]
+} BenchResult_t;
+
+/**
+ * @brief Drift of the mixed precision asteroids in one configuration.
+ */
+typedef struct
+{
+	int system;
+	Integrator_t integrator;
+	unsigned int steps;
+	double stepsPerSecond[2];	// Double and mixed precision
+	double drift[3];		// p50, p99 and max [m]
+	double relativeDrift[3];	// p50, p99 and max, over the distance of each asteroid to the star
+} DriftResult_t;
+
+/**
+ * @brief Gets a percentile of sorted samples.
+ *
+ * @param samples The samples, sorted.
+ * @param percentile The percentile (0 to 100).
+ *
+ * @return The sample.
+ */
+static double getPercentile(const std::vector<double>& samples, double percentile);
+
+/**
+ * @brief Gets the settings of a benchmarked simulation, without gravity between asteroids.
+ *
+ * @param threadsNum The amount of threads (0 uses every hardware thread).
+ * @param integrator The integrator.
+ * @param precision Precision of the pull on the asteroids.
+ * @param massless Makes the asteroids test particles.
+ *
+ * @return The settings.
+ */
+static OrbitalSimSettings_t getBenchSettings(unsigned int threadsNum, Integrator_t integrator, GravityPrecision_t precision,
+						int massless);
+
+/**
+ * @brief Times one configuration.
+ *
+ * @param asteroidsNum The amount of asteroids.
+ * @param system The system (0: solar system, 1: alpha centauri).
+ * @param integrator The integrator.
+ * @param steps The amount of timed updates.
+ * @param threadsNum The amount of threads (0 uses every hardware thread).
+ * @param massless Makes the asteroids test particles.
+ * @param result Where the result is stored.
+ *
+ * @return 0 if the simulation could be constructed.
+ */
+static int runBench(unsigned int asteroidsNum, int system, Integrator_t integrator, unsigned int steps,
+			unsigned int threadsNum, int massless, BenchResult_t* result);
+
+/**
+ * @brief Prints one result.
+ *
+ * @param result The result.
+ * @param json Prints JSON instead of CSV.
+ * @param first Set for the first result.
+ */
+static void printResult(const BenchResult_t* result, int json, int first);
+
+/**
+ * @brief Runs one configuration from the start at one gravity precision, one day per update.
+ *
+ * @param system The system (0: solar system, 1: alpha centauri).
+ * @param integrator The integrator.
+ * @param precision Precision of the pull on the asteroids.
+ * @param steps The amount of updates.
+ * @param threadsNum The amount of threads (0 uses every hardware thread).
+ * @param massless Makes the asteroids test particles.
+ * @param positions Where the final position of each asteroid is stored, by id.
+ * @param star Where the final position of the star is stored.
+ * @param stepsPerSecond Where the updates per second are stored.
+ *
+ * @return 0 if the simulation could be constructed.
+ */
+static int runPrecision(int system, Integrator_t integrator, GravityPrecision_t precision, unsigned int steps,
+			unsigned int threadsNum, int massless, std::vector<vector3D_t>& positions, vector3D_t* star,
+			double* stepsPerSecond);
+
+/**
+ * @brief Measures the drift of the mixed precision asteroids in one configuration.
+ *
+ * @param system The system (0: solar system, 1: alpha centauri).
+ * @param integrator The integrator.
+ * @param steps The amount of updates.
+ * @param threadsNum The amount of threads (0 uses every hardware thread).
+ * @param massless Makes the asteroids test particles.
+ * @param result Where the result is stored.
+ *
+ * @return 0 if the simulations could be constructed.
+ */
+static int runDrift(int system, Integrator_t integrator, unsigned int steps, unsigned int threadsNum, int massless,
+			DriftResult_t* result);
+
+/**
+ * @brief Prints one drift result.
+ *
+ * @param result The result.
+ * @param json Prints JSON instead of CSV.
+ * @param first Set for the first result.
+ */
+static void printDrift(const DriftResult_t* result, int json, int first);
+
+int main(int argc, char* argv[])
+{
+	unsigned int steps = 0;
+	unsigned int threadsNum = 0;
+	int json = 0;
+	int drift = 0;
+	int massless = 0;
+	int first = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-json"))
+			json = 1;
+		else if (!strcmp(argv[i], "-drift"))
+			drift = 1;
+		else if (!strcmp(argv[i], "-massless"))
+			massless = 1;
+		else if (!strcmp(argv[i], "-steps") && i + 1 < argc)
+			steps = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+			threadsNum = (unsigned int)strtoul(argv[++i], NULL, 10);
+	}
+	steps = (steps) ? steps : (drift) ? BENCH_DRIFT_DEFAULT_STEPS : BENCH_DEFAULT_STEPS;
+
+	if (drift)
+	{
+		if (json)
+			printf("{\"gravity_kernel\": \"%s\", \"massless_asteroids\": %d, \"asteroids\": %u, \"drift\": [\n",
+				getGravityKernelName(), massless, BENCH_DRIFT_ASTEROIDS);
+		else
+			printf("system,integrator,steps,double_steps_per_s,mixed_steps_per_s,p50_drift_km,p99_drift_km,max_drift_km,"
+				"p50_relative_drift,p99_relative_drift,max_relative_drift\n");
+
+		for (unsigned int s = 0; s < sizeof(systems) / sizeof(systems[0]); s++)
+		{
+			for (int integrator = 0; integrator < INTEGRATORS_AMOUNT; integrator++)
+			{
+				DriftResult_t result;
+
+				if (runDrift(systems[s], (Integrator_t)integrator, steps, threadsNum, massless, &result))
+				{
+					fprintf(stderr, "Could not construct the simulation (%u asteroids)\n", BENCH_DRIFT_ASTEROIDS);
+					return 1;
+				}
+				printDrift(&result, json, first);
+				first = 0;
+				fflush(stdout);
+			}
+		}
+
+		if (json)
+			printf("\n]}\n");
+		return 0;
+	}
+
+	if (json)
+		printf("{\"gravity_kernel\": \"%s\", \"massless_asteroids\": %d, \"results\": [\n", getGravityKernelName(), massless);
+	else
+		printf("asteroids,system,integrator,steps,steps_per_s,ns_per_interaction,p50_us,p90_us,p99_us,max_us\n");
+
+	for (unsigned int a = 0; a < sizeof(asteroidsAmounts) / sizeof(asteroidsAmounts[0]); a++)
+	{
+		for (unsigned int s = 0; s < sizeof(systems) / sizeof(systems[0]); s++)
+		{
+			for (int integrator = 0; integrator < INTEGRATORS_AMOUNT; integrator++)
+			{
+				BenchResult_t result;
+
+				if (runBench(asteroidsAmounts[a], systems[s], (Integrator_t)integrator, steps, threadsNum, massless, &result))
+				{
+					fprintf(stderr, "Could not construct the simulation (%u asteroids)\n", asteroidsAmounts[a]);
+					return 1;
+				}
+				printResult(&result, json, first);
+				first = 0;
+				fflush(stdout);
+			}
+		}
+	}
+
+	if (json)
+		printf("\n]}\n");
+
+	return 0;
+}
+
+static double getPercentile(const std::vector<double>& samples, double percentile)
+{
+	size_t index = (size_t)(percentile / 100 * (samples.size() - 1) + 0.5);
+	return samples[index];
+}
+
+static OrbitalSimSettings_t getBenchSettings(unsigned int threadsNum, Integrator_t integrator, GravityPrecision_t precision,
+						int massless)
+{
+	OrbitalSimSettings_t settings;
+
+	settings.threadsNum = threadsNum;
+	settings.asteroidsGravity = ASTEROIDS_GRAVITY_NONE;
+	settings.openingAngle = 0.0;
+	settings.expansionOrder = 0;
+	settings.integrator = integrator;
+	settings.asteroidsPrecision = precision;
+	settings.masslessAsteroids = massless;
+	return settings;
+}
+
+static int runBench(unsigned int asteroidsNum, int system, Integrator_t integrator, unsigned int steps,
+			unsigned int threadsNum, int massless, BenchResult_t* result)
+{
+	// Ephemerides are global and updated in place, keep every run starting from the same state
+	EphemeridesBody_t* bodies = (system) ? alphaCentauriSystem : solarSystem;
+	unsigned int bodyNum = (system) ? ALPHACENTAURISYSTEM_BODYNUM : SOLARSYSTEM_BODYNUM;
+	std::vector<EphemeridesBody_t> initialBodies(bodies, bodies + bodyNum);
+
+	OrbitalSimSettings_t settings = getBenchSettings(threadsNum, integrator, GRAVITY_PRECISION_DOUBLE, massless);
+	OrbitalSim_t* sim = constructOrbitalSim(asteroidsNum, 0, system, 0, BENCH_SEED, &settings);
+	if (!sim)
+		return 1;
+	sim->dt = SECONDS_PER_HOUR;
+
+	for (unsigned int i = 0; i < BENCH_WARMUP_STEPS; i++)
+		updateOrbitalSim(sim, 0);
+
+	std::vector<double> latencies(steps);
+	unsigned long long interactionsNum = sim->interactionsNum;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		updateOrbitalSim(sim, 0);
+		latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	interactionsNum = sim->interactionsNum - interactionsNum;
+	std::sort(latencies.begin(), latencies.end());
+
+	result->asteroidsNum = asteroidsNum;
+	result->system = system;
+	result->integrator = integrator;
+	result->steps = steps;
+	result->stepsPerSecond = steps / seconds;
+	result->nsPerInteraction = (interactionsNum) ? seconds * 1E9 / interactionsNum : 0.0;
+	result->latencyUs[0] = getPercentile(latencies, 50);
+	result->latencyUs[1] = getPercentile(latencies, 90);
+	result->latencyUs[2] = getPercentile(latencies, 99);
+	result->latencyUs[3] = latencies.back();
+
+	destroyOrbitalSim(sim);
+	std::copy(initialBodies.begin(), initialBodies.end(), bodies);
+	return 0;
+}
+
+static void printResult(const BenchResult_t* result, int json, int first)
+{
+	if (!json)
+	{
+		printf("%u,%d,%s,%u,%.1f,%.3f,%.1f,%.1f,%.1f,%.1f\n", result->asteroidsNum, result->system,
+			getIntegratorName(result->integrator), result->steps, result->stepsPerSecond, result->nsPerInteraction,
+			result->latencyUs[0], result->latencyUs[1], result->latencyUs[2], result->latencyUs[3]);
+		return;
+	}
+
+	printf("%s  {\"asteroids\": %u, \"system\": %d, \"integrator\": \"%s\", \"steps\": %u, "
+		"\"steps_per_s\": %.1f, \"ns_per_interaction\": %.3f, "
+		"\"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}",
+		(first) ? "" : ",\n", result->asteroidsNum, result->system, getIntegratorName(result->integrator),
+		result->steps, result->stepsPerSecond, result->nsPerInteraction,
+		result->latencyUs[0], result->latencyUs[1], result->latencyUs[2], result->latencyUs[3]);
+}
+
+static int runPrecision(int system, Integrator_t integrator, GravityPrecision_t precision, unsigned int steps,
+			unsigned int threadsNum, int massless, std::vector<vector3D_t>& positions, vector3D_t* star,
+			double* stepsPerSecond)
+{
+	// Ephemerides are global and updated in place, keep every run starting from the same state
+	EphemeridesBody_t* bodies = (system) ? alphaCentauriSystem : solarSystem;
+	unsigned int bodyNum = (system) ? ALPHACENTAURISYSTEM_BODYNUM : SOLARSYSTEM_BODYNUM;
+	std::vector<EphemeridesBody_t> initialBodies(bodies, bodies + bodyNum);
+
+	OrbitalSimSettings_t settings = getBenchSettings(threadsNum, integrator, precision, massless);
+	OrbitalSim_t* sim = constructOrbitalSim(BENCH_DRIFT_ASTEROIDS, 0, system, 0, BENCH_SEED, &settings);
+	if (!sim)
+		return 1;
+	sim->dt = SECONDS_PER_DAY;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < steps; i++)
+		updateOrbitalSim(sim, 0);
+	*stepsPerSecond = steps / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// The block leapfrog sorts the asteroids, their ids match them across runs
+	positions.assign(BENCH_DRIFT_ASTEROIDS, vector3D_t{0.0, 0.0, 0.0});
+	for (unsigned int i = 0; i < sim->asteroidsNum; i++)
+	{
+		vector3D_t position = {sim->Asteroids->x[i], sim->Asteroids->y[i], sim->Asteroids->z[i]};
+		positions[sim->asteroidsIds[i]] = position;
+	}
+	*star = sim->PlanetarySystem[0].body.position;
+
+	destroyOrbitalSim(sim);
+	std::copy(initialBodies.begin(), initialBodies.end(), bodies);
+	return 0;
+}
+
+static int runDrift(int system, Integrator_t integrator, unsigned int steps, unsigned int threadsNum, int massless,
+			DriftResult_t* result)
+{
+	std::vector<vector3D_t> positions[2];
+	vector3D_t star[2];
+
+	if (runPrecision(system, integrator, GRAVITY_PRECISION_DOUBLE, steps, threadsNum, massless, positions[0], &star[0],
+				&result->stepsPerSecond[0]) ||
+		runPrecision(system, integrator, GRAVITY_PRECISION_MIXED, steps, threadsNum, massless, positions[1], &star[1],
+				&result->stepsPerSecond[1]))
+		return 1;
+
+	std::vector<double> drifts(BENCH_DRIFT_ASTEROIDS);
+	std::vector<double> relativeDrifts(BENCH_DRIFT_ASTEROIDS);
+	for (unsigned int i = 0; i < BENCH_DRIFT_ASTEROIDS; i++)
+	{
+		vector3D_t drift = {positions[1][i].x - positions[0][i].x,
+					positions[1][i].y - positions[0][i].y,
+					positions[1][i].z - positions[0][i].z};
+		vector3D_t radius = {positions[0][i].x - star[0].x, positions[0][i].y - star[0].y, positions[0][i].z - star[0].z};
+
+		drifts[i] = sqrt(DOT_PRODUCT(drift, drift));
+		relativeDrifts[i] = drifts[i] / sqrt(DOT_PRODUCT(radius, radius));
+	}
+	std::sort(drifts.begin(), drifts.end());
+	std::sort(relativeDrifts.begin(), relativeDrifts.end());
+
+	result->system = system;
+	result->integrator = integrator;
+	result->steps = steps;
+	result->drift[0] = getPercentile(drifts, 50);
+	result->drift[1] = getPercentile(drifts, 99);
+	result->drift[2] = drifts.back();
+	result->relativeDrift[0] = getPercentile(relativeDrifts, 50);
+	result->relativeDrift[1] = getPercentile(relativeDrifts, 99);
+	result->relativeDrift[2] = relativeDrifts.back();
+	return 0;
+}
+
+static void printDrift(const DriftResult_t* result, int json, int first)
+{
+	if (!json)
+	{
+		printf("%d,%s,%u,%.1f,%.1f,%.3g,%.3g,%.3g,%.3g,%.3g,%.3g\n", result->system, getIntegratorName(result->integrator),
+			result->steps, result->stepsPerSecond[0], result->stepsPerSecond[1],
+			result->drift[0] / METERS_PER_KILOMETER, result->drift[1] / METERS_PER_KILOMETER, result->drift[2] / METERS_PER_KILOMETER,
+			result->relativeDrift[0], result->relativeDrift[1], result->relativeDrift[2]);
+		return;
+	}
+
+	printf("%s  {\"system\": %d, \"integrator\": \"%s\", \"steps\": %u, "
+		"\"steps_per_s\": {\"double\": %.1f, \"mixed\": %.1f}, "
+		"\"drift_km\": {\"p50\": %.3g, \"p99\": %.3g, \"max\": %.3g}, "
+		"\"relative_drift\": {\"p50\": %.3g, \"p99\": %.3g, \"max\": %.3g}}",
+		(first) ? "" : ",\n", result->system, getIntegratorName(result->integrator), result->steps,
+		result->stepsPerSecond[0], result->stepsPerSecond[1],
+		result->drift[0] / METERS_PER_KILOMETER, result->drift[1] / METERS_PER_KILOMETER, result->drift[2] / METERS_PER_KILOMETER,
+		result->relativeDrift[0], result->relativeDrift[1], result->relativeDrift[2]);
+}
@@ -0,0 +1,276 @@
+/**
+ * @brief Structure of arrays storage for orbital bodies
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "bodyArrays.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#include <malloc.h>
+	// Keeps windows.h from declaring names raylib also uses
+	#define NOGDI
+	#define NOUSER
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#define BODY_ARRAYS_AMOUNT 10
+#define DOUBLES_PER_ALIGNMENT (BODY_ARRAYS_ALIGNMENT / sizeof(double))
+
+/**
+ * @brief Allocates memory aligned to BODY_ARRAYS_ALIGNMENT.
+ *
+ * @param size Size in bytes.
+ *
+ * @return Pointer to the memory (NULL if it could not be allocated).
+ */
+static void* alignedAlloc(size_t size);
+
+/**
+ * @brief Frees memory allocated with alignedAlloc.
+ *
+ * @param memory Pointer to the memory.
+ */
+static void alignedFree(void* memory);
+
+/**
+ * @brief Maps a whole file in private (copy on write) mode.
+ *
+ * @param path Path of the file.
+ * @param size Where the size of the file is stored [bytes].
+ *
+ * @return Pointer to the mapping (NULL if the file could not be mapped).
+ */
+static void* mapFile(const char* path, size_t* size);
+
+/**
+ * @brief Unmaps a file mapped with mapFile.
+ *
+ * @param mapping Pointer to the mapping.
+ * @param size Size of the mapping [bytes].
+ */
+static void unmapFile(void* mapping, size_t size);
+
+/**
+ * @brief Points each array to its part of the block.
+ *
+ * @param arrays Pointer to the body arrays, with memory and capacity set.
+ */
+static void assignBodyArrays(BodyArrays_t* arrays);
+
+BodyArrays_t* constructBodyArrays(unsigned int bodyNum)
+{
+	BodyArrays_t* arrays = new BodyArrays_t;
+	if (!arrays)
+		return NULL;
+
+	// Rounding up keeps every array (not just the first one) aligned
+	arrays->capacity = (unsigned int)((bodyNum + DOUBLES_PER_ALIGNMENT - 1) / DOUBLES_PER_ALIGNMENT * DOUBLES_PER_ALIGNMENT);
+	arrays->capacity = (arrays->capacity) ? arrays->capacity : DOUBLES_PER_ALIGNMENT;
+	arrays->memory = alignedAlloc(sizeof(double) * arrays->capacity * BODY_ARRAYS_AMOUNT);
+
+	if (!arrays->memory)
+	{
+		delete arrays;
+		return NULL;
+	}
+	memset(arrays->memory, 0, sizeof(double) * arrays->capacity * BODY_ARRAYS_AMOUNT);
+	arrays->mapping = NULL;
+	arrays->mappingSize = 0;
+
+	assignBodyArrays(arrays);
+	return arrays;
+}
+
+BodyArrays_t* mapBodyArrays(const char* path, size_t offset, unsigned int capacity)
+{
+	if (offset % BODY_ARRAYS_ALIGNMENT || !capacity || capacity % DOUBLES_PER_ALIGNMENT)
+		return NULL;
+
+	BodyArrays_t* arrays = new BodyArrays_t;
+	if (!arrays)
+		return NULL;
+
+	arrays->mapping = mapFile(path, &arrays->mappingSize);
+	if (!arrays->mapping)
+	{
+		delete arrays;
+		return NULL;
+	}
+	if (arrays->mappingSize < offset + sizeof(double) * capacity * BODY_ARRAYS_AMOUNT)
+	{
+		unmapFile(arrays->mapping, arrays->mappingSize);
+		delete arrays;
+		return NULL;
+	}
+
+	// Mappings start on a page, so the offset alone keeps the arrays aligned
+	arrays->capacity = capacity;
+	arrays->memory = (char*)arrays->mapping + offset;
+	assignBodyArrays(arrays);
+	return arrays;
+}
+
+void destroyBodyArrays(BodyArrays_t* arrays)
+{
+	if (!arrays)
+		return;
+	if (arrays->mapping)
+		unmapFile(arrays->mapping, arrays->mappingSize);
+	else
+		alignedFree(arrays->memory);
+	delete arrays;
+}
+
+Body_t getBody(const BodyArrays_t* arrays, unsigned int index)
+{
+	Body_t body;
+
+	body.mass_GC = arrays->mass_GC[index];
+	body.position.x = arrays->x[index];
+	body.position.y = arrays->y[index];
+	body.position.z = arrays->z[index];
+	body.velocity.x = arrays->vx[index];
+	body.velocity.y = arrays->vy[index];
+	body.velocity.z = arrays->vz[index];
+	body.acceleration.x = arrays->ax[index];
+	body.acceleration.y = arrays->ay[index];
+	body.acceleration.z = arrays->az[index];
+
+	return body;
+}
+
+void setBody(BodyArrays_t* arrays, unsigned int index, const Body_t* body)
+{
+	arrays->mass_GC[index] = body->mass_GC;
+	arrays->x[index] = body->position.x;
+	arrays->y[index] = body->position.y;
+	arrays->z[index] = body->position.z;
+	arrays->vx[index] = body->velocity.x;
+	arrays->vy[index] = body->velocity.y;
+	arrays->vz[index] = body->velocity.z;
+	arrays->ax[index] = body->acceleration.x;
+	arrays->ay[index] = body->acceleration.y;
+	arrays->az[index] = body->acceleration.z;
+}
+
+unsigned int compactBodyArrays(BodyArrays_t* arrays, const unsigned char* removed, unsigned int begin, unsigned int bodyNum)
+{
+	double* array[BODY_ARRAYS_AMOUNT] =
+	{
+		arrays->x, arrays->y, arrays->z,
+		arrays->vx, arrays->vy, arrays->vz,
+		arrays->ax, arrays->ay, arrays->az,
+		arrays->mass_GC
+	};
+	unsigned int kept = begin;
+
+	for (unsigned int i = begin; i < bodyNum; i++)
+	{
+		if (removed[i])
+			continue;
+
+		for (int j = 0; j < BODY_ARRAYS_AMOUNT; j++)
+		{
+			array[j][kept] = array[j][i];
+		}
+		kept++;
+	}
+
+	return kept;
+}
+
+static void* alignedAlloc(size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, BODY_ARRAYS_ALIGNMENT);
+#else
+	void* memory;
+	return (posix_memalign(&memory, BODY_ARRAYS_ALIGNMENT, size)) ? NULL : memory;
+#endif
+}
+
+static void alignedFree(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+static void* mapFile(const char* path, size_t* size)
+{
+#ifdef _WIN32
+	// Sharing the deletion lets the file be renamed while it is mapped
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	void* memory = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart)
+		mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping)
+		memory = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+	// The view keeps the file mapped after both handles are closed
+	if (mapping)
+		CloseHandle(mapping);
+	CloseHandle(file);
+
+	*size = (memory) ? (size_t)fileSize.QuadPart : 0;
+	return memory;
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return NULL;
+
+	struct stat status;
+	void* memory = MAP_FAILED;
+	if (!fstat(file, &status) && status.st_size > 0)
+		memory = mmap(NULL, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	close(file);
+
+	*size = (memory != MAP_FAILED) ? (size_t)status.st_size : 0;
+	return (memory != MAP_FAILED) ? memory : NULL;
+#endif
+}
+
+static void unmapFile(void* mapping, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(mapping);
+#else
+	munmap(mapping, size);
+#endif
+}
+
+static void assignBodyArrays(BodyArrays_t* arrays)
+{
+	double* memory = (double*)arrays->memory;
+	double** array[BODY_ARRAYS_AMOUNT] =
+	{
+		&arrays->x, &arrays->y, &arrays->z,
+		&arrays->vx, &arrays->vy, &arrays->vz,
+		&arrays->ax, &arrays->ay, &arrays->az,
+		&arrays->mass_GC
+	};
+
+	for (int i = 0; i < BODY_ARRAYS_AMOUNT; i++)
+	{
+		*array[i] = memory + i * arrays->capacity;
+	}
+}
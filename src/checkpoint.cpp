@@ -0,0 +1,270 @@
+/**
+ * @brief Checkpoint files of the orbital simulation
+ *
+ * A checkpoint is a header, the massive bodies, the last pull of each asteroid
+ * chunk on them (block steps reuse it for the chunks they skip), the id of
+ * each asteroid and then the asteroid arrays laid out exactly as constructBodyArrays allocates them,
+ * starting on an aligned offset. Restoring reads the header and the bodies, and maps the
+ * asteroids instead of reading them. Values are stored in the byte order
+ * and layout of the build that saved them, other builds reject the file.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CHECKPOINT_MAGIC "ORBITSIM"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_BYTE_ORDER 0x01020304U
+#define CHECKPOINT_ARRAYS_AMOUNT 10
+#define CHECKPOINT_PATH_SIZE 1024
+
+#define DOUBLES_PER_ALIGNMENT (BODY_ARRAYS_ALIGNMENT / sizeof(double))
+#define ALIGN_UP(x, alignment) ( ((x) + (alignment) - 1) / (alignment) * (alignment) )
+
+/**
+ * @brief First bytes of a checkpoint.
+ */
+typedef struct
+{
+	char magic[CHECKPOINT_MAGIC_SIZE];
+	unsigned int version;
+	unsigned int byteOrder;		// CHECKPOINT_BYTE_ORDER as the saving build stored it
+	unsigned int headerSize;	// Sizes of the stored structs, other layouts are rejected
+	unsigned int bodySize;
+	unsigned int system;		// 0 solar system, 1 alpha centauri
+	unsigned int bodyNum;
+	unsigned int asteroidsNum;
+	unsigned int asteroidsCapacity;	// Doubles per asteroid array
+	int spawnBlackHole;
+	int accelerationsValid;		// The stored accelerations match the positions
+	unsigned int integrator;	// Integrator_t the accelerations were evaluated for
+	unsigned int asteroidsGravity;	// AsteroidsGravity_t the accelerations were evaluated with
+	int masslessAsteroids;
+	double dt;			// In seconds
+	double timeElapsed;		// In seconds
+	EphemeridesBody_t SpaceShip;
+	BlackHole_t BlackHole;
+	unsigned long long bodiesOffset;	// [bytes]
+	unsigned long long reactionsOffset;	// [bytes], chunks * bodyNum vectors
+	unsigned long long idsOffset;		// [bytes]
+	unsigned long long asteroidsOffset;	// [bytes], a multiple of BODY_ARRAYS_ALIGNMENT
+} CheckpointHeader_t;
+
+/**
+ * @brief Checks that a header was saved by a build compatible with this one.
+ *
+ * @param header Pointer to the header.
+ *
+ * @return 1 if it is valid, 0 if not.
+ */
+static int isCheckpointHeaderValid(const CheckpointHeader_t* header);
+
+/**
+ * @brief Gets the solver a simulation uses for the gravity between asteroids.
+ *
+ * @param sim Pointer to the simulation.
+ *
+ * @return The solver.
+ */
+static AsteroidsGravity_t getAsteroidsGravity(const OrbitalSim_t* sim);
+
+/**
+ * @brief Writes zeros.
+ *
+ * @param file The file.
+ * @param size Amount of zeros [bytes].
+ *
+ * @return 1 if they were written, 0 if not.
+ */
+static int writeZeros(FILE* file, size_t size);
+
+/**
+ * @brief Replaces a file with another one.
+ *
+ * @param source Path of the new file, which is renamed.
+ * @param destination Path of the replaced file.
+ *
+ * @return 1 if it was replaced, 0 if not.
+ */
+static int replaceFile(const char* source, const char* destination);
+
+int saveCheckpoint(const OrbitalSim_t* sim, const char* path)
+{
+	CheckpointHeader_t header;
+	char temporaryPath[CHECKPOINT_PATH_SIZE];
+	unsigned int reactionsNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE * sim->bodyNum;
+
+	if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path) >= (int)sizeof(temporaryPath))
+		return 0;
+
+	// Zeroed so the padding of the header is saved the same every time
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+	header.version = CHECKPOINT_VERSION;
+	header.byteOrder = CHECKPOINT_BYTE_ORDER;
+	header.headerSize = sizeof(CheckpointHeader_t);
+	header.bodySize = sizeof(EphemeridesBody_t);
+	header.system = (sim->PlanetarySystem == alphaCentauriSystem);
+	header.bodyNum = sim->bodyNum;
+	header.asteroidsNum = sim->asteroidsNum;
+	header.asteroidsCapacity = ALIGN_UP(sim->asteroidsNum, DOUBLES_PER_ALIGNMENT);
+	header.asteroidsCapacity = (header.asteroidsCapacity) ? header.asteroidsCapacity : DOUBLES_PER_ALIGNMENT;
+	header.spawnBlackHole = (sim->BlackHole.absorbRadius != 0.0);
+	header.accelerationsValid = sim->accelerationsValid;
+	header.integrator = sim->integrator;
+	header.asteroidsGravity = getAsteroidsGravity(sim);
+	header.masslessAsteroids = sim->masslessAsteroids;
+	header.dt = sim->dt;
+	header.timeElapsed = sim->timeElapsed;
+	header.SpaceShip = sim->SpaceShip;
+	header.BlackHole = sim->BlackHole;
+	header.bodiesOffset = sizeof(CheckpointHeader_t);
+	header.reactionsOffset = header.bodiesOffset + sizeof(EphemeridesBody_t) * sim->bodyNum;
+	header.idsOffset = header.reactionsOffset + sizeof(vector3D_t) * reactionsNum;
+	header.asteroidsOffset = ALIGN_UP(header.idsOffset + sizeof(unsigned int) * sim->asteroidsNum, BODY_ARRAYS_ALIGNMENT);
+
+	FILE* file = fopen(temporaryPath, "wb");
+	if (!file)
+		return 0;
+
+	int saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(sim->PlanetarySystem, sizeof(EphemeridesBody_t), sim->bodyNum, file) == sim->bodyNum &&
+			fwrite(sim->asteroidsReactions, sizeof(vector3D_t), reactionsNum, file) == reactionsNum &&
+			fwrite(sim->asteroidsIds, sizeof(unsigned int), sim->asteroidsNum, file) == sim->asteroidsNum &&
+			writeZeros(file, header.asteroidsOffset - header.idsOffset - sizeof(unsigned int) * sim->asteroidsNum);
+
+	// Same order as constructBodyArrays, each array padded to the capacity
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	const double* arrays[CHECKPOINT_ARRAYS_AMOUNT] =
+	{
+		asteroids->x, asteroids->y, asteroids->z,
+		asteroids->vx, asteroids->vy, asteroids->vz,
+		asteroids->ax, asteroids->ay, asteroids->az,
+		asteroids->mass_GC
+	};
+	for (int i = 0; saved && i < CHECKPOINT_ARRAYS_AMOUNT; i++)
+	{
+		saved = fwrite(arrays[i], sizeof(double), sim->asteroidsNum, file) == sim->asteroidsNum &&
+			writeZeros(file, sizeof(double) * (header.asteroidsCapacity - sim->asteroidsNum));
+	}
+
+	saved = !fclose(file) && saved;
+	if (!saved || !replaceFile(temporaryPath, path))
+	{
+		remove(temporaryPath);
+		return 0;
+	}
+	return 1;
+}
+
+OrbitalSim_t* loadCheckpoint(const char* path, const OrbitalSimSettings_t* settings)
+{
+	CheckpointHeader_t header;
+
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	// The mapping checks the file is long enough, and everything else comes before the asteroids
+	BodyArrays_t* asteroids = NULL;
+	if (fread(&header, sizeof(header), 1, file) == 1 && isCheckpointHeaderValid(&header))
+		asteroids = mapBodyArrays(path, (size_t)header.asteroidsOffset, header.asteroidsCapacity);
+
+	// The seed only places the SpaceShip, which the checkpoint overwrites
+	OrbitalSim_t* sim = NULL;
+	if (asteroids)
+		sim = constructOrbitalSimWithAsteroids(asteroids, header.asteroidsNum, header.system, header.spawnBlackHole, 0,
+							settings);
+
+	unsigned int reactionsNum = (header.asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE * header.bodyNum;
+	if (!sim || fseek(file, (long)header.bodiesOffset, SEEK_SET) ||
+		fread(sim->PlanetarySystem, sizeof(EphemeridesBody_t), header.bodyNum, file) != header.bodyNum ||
+		fseek(file, (long)header.reactionsOffset, SEEK_SET) ||
+		fread(sim->asteroidsReactions, sizeof(vector3D_t), reactionsNum, file) != reactionsNum ||
+		fseek(file, (long)header.idsOffset, SEEK_SET) ||
+		fread(sim->asteroidsIds, sizeof(unsigned int), header.asteroidsNum, file) != header.asteroidsNum)
+	{
+		destroyOrbitalSim(sim);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+
+	sim->bodyNum = header.bodyNum;
+	sim->SpaceShip = header.SpaceShip;
+	sim->BlackHole = header.BlackHole;
+	sim->dt = header.dt;
+	sim->timeElapsed = header.timeElapsed;
+	sim->accelerationsValid = header.accelerationsValid && header.integrator == sim->integrator &&
+					header.asteroidsGravity == getAsteroidsGravity(sim) &&
+					header.masslessAsteroids == sim->masslessAsteroids;
+
+	return sim;
+}
+
+static int isCheckpointHeaderValid(const CheckpointHeader_t* header)
+{
+	if (memcmp(header->magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) || header->version != CHECKPOINT_VERSION ||
+		header->byteOrder != CHECKPOINT_BYTE_ORDER || header->headerSize != sizeof(CheckpointHeader_t) ||
+		header->bodySize != sizeof(EphemeridesBody_t) || header->system > 1)
+		return 0;
+
+	unsigned int systemBodyNum = (header->system) ? ALPHACENTAURISYSTEM_BODYNUM : SOLARSYSTEM_BODYNUM;
+	unsigned long long chunksNum = (header->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned long long bodiesEnd = header->bodiesOffset + sizeof(EphemeridesBody_t) * header->bodyNum;
+	unsigned long long reactionsEnd = header->reactionsOffset + sizeof(vector3D_t) * chunksNum * header->bodyNum;
+	unsigned long long idsEnd = header->idsOffset + sizeof(unsigned int) * header->asteroidsNum;
+
+	return header->bodyNum <= systemBodyNum && header->asteroidsNum <= header->asteroidsCapacity &&
+		header->bodiesOffset >= sizeof(CheckpointHeader_t) && header->reactionsOffset >= bodiesEnd &&
+		header->idsOffset >= reactionsEnd && header->asteroidsOffset >= idsEnd;
+}
+
+static AsteroidsGravity_t getAsteroidsGravity(const OrbitalSim_t* sim)
+{
+	if (sim->octree)
+		return ASTEROIDS_GRAVITY_BARNES_HUT;
+	return (sim->fastMultipole) ? ASTEROIDS_GRAVITY_FMM : ASTEROIDS_GRAVITY_NONE;
+}
+
+static int writeZeros(FILE* file, size_t size)
+{
+	static const char zeros[BODY_ARRAYS_ALIGNMENT] = {0};
+
+	for (; size >= sizeof(zeros); size -= sizeof(zeros))
+	{
+		if (fwrite(zeros, sizeof(zeros), 1, file) != 1)
+			return 0;
+	}
+	return !size || fwrite(zeros, size, 1, file) == 1;
+}
+
+static int replaceFile(const char* source, const char* destination)
+{
+#ifdef _WIN32
+	// rename does not overwrite on Windows, and the old checkpoint may still be
+	// mapped by the running simulation, which only allows moving it away
+	char oldPath[CHECKPOINT_PATH_SIZE];
+
+	if (snprintf(oldPath, sizeof(oldPath), "%s.old", destination) >= (int)sizeof(oldPath))
+		return 0;
+	remove(oldPath);
+	int moved = !rename(destination, oldPath);
+	if (rename(source, destination))
+	{
+		if (moved)
+			rename(oldPath, destination);
+		return 0;
+	}
+	remove(oldPath);	// Fails while mapped, the next save removes it
+	return 1;
+#else
+	// The old file lives on for whoever still maps it
+	return !rename(source, destination);
+#endif
+}
@@ -0,0 +1,695 @@
+/**
+ * @brief Fast multipole method for the gravity between asteroids
+ *
+ * Expansions are Cartesian Taylor series of 1/r truncated at a total order p:
+ * a node of multipole M (about its center of mass z_S) adds to a node of
+ * local expansion L (about z_T)
+ *
+ *	L_b += sum over |a| + |b| <= p of (-1)^|a| M_a D_(a+b)(z_T - z_S)
+ *
+ * where D_k are the derivatives of 1/r, calculated with the McMurchie-Davidson
+ * recursion. Multi-indices are stored sorted by degree, so the terms of any
+ * lower order are a prefix of the arrays.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "fastMultipole.h"
+#include "vector3D.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Leaf size that balances direct sums against expansions
+#define FMM_LEAF_SIZE 32
+
+// Multi-indices up to FMM_ORDER_MAX: (FMM_ORDER_MAX + 3)! / (FMM_ORDER_MAX! 3!)
+#define FMM_COEFFICIENTS_MAX 165
+
+// Subtrees the evaluation is split into, at least
+#define FMM_TASKS_MIN 64
+
+/**
+ * Private variables.
+ */
+
+static int tablesAreInitialized = 0;
+static unsigned char coefficientPowers[FMM_COEFFICIENTS_MAX][3];
+static unsigned char coefficientDegree[FMM_COEFFICIENTS_MAX];
+static unsigned short coefficientIndex[FMM_ORDER_MAX + 1][FMM_ORDER_MAX + 1][FMM_ORDER_MAX + 1];
+static unsigned int coefficientsNumByOrder[FMM_ORDER_MAX + 1];
+
+/**
+ * Private function definitions.
+ */
+
+/**
+ * @brief Enumerates every multi-index up to FMM_ORDER_MAX, sorted by degree.
+ */
+static void initializeTables(void);
+
+/**
+ * @brief Makes room for the per node and per body arrays of the last built octree.
+ *
+ * @param fmm Pointer to the solver.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+static int reserveArrays(FastMultipole_t* fmm);
+
+/**
+ * @brief Calculates d^k / k! for every multi-index k up to an order.
+ *
+ * @param d The vector.
+ * @param order The order.
+ * @param powers Where the results are stored.
+ */
+static void getScaledPowers(vector3D_t d, unsigned int order, double* powers);
+
+/**
+ * @brief Calculates the derivatives of 1/r for every multi-index up to an order.
+ *
+ * @param r The vector.
+ * @param order The order.
+ * @param derivatives Where the results are stored.
+ */
+static void getDerivatives(vector3D_t r, unsigned int order, double* derivatives);
+
+/**
+ * @brief Calculates the multipoles and radius of every node, from the leaves up,
+ *		and clears the local expansions and accelerations.
+ *
+ * @param fmm Pointer to the solver.
+ */
+static void upwardPass(FastMultipole_t* fmm);
+
+/**
+ * @brief Splits the octree into subtrees that are evaluated independently.
+ *
+ * @param fmm Pointer to the solver.
+ */
+static void splitTasks(FastMultipole_t* fmm);
+
+/**
+ * @brief Evaluates one subtree: interactions, local expansions and output.
+ *
+ * @param data Pointer to the solver.
+ * @param task Index of the subtree.
+ */
+static void evaluateTask(void* data, unsigned int task);
+
+/**
+ * @brief Adds the pull of the bodies of a source node to the bodies and local
+ *		expansions of a target node.
+ *
+ * @param fmm Pointer to the solver.
+ * @param target Index of the target node.
+ * @param source Index of the source node.
+ */
+static void interactNodes(FastMultipole_t* fmm, unsigned int target, unsigned int source);
+
+/**
+ * @brief Adds the multipole expansion of a source node to the local expansion of a target node.
+ *
+ * @param fmm Pointer to the solver.
+ * @param target Index of the target node.
+ * @param source Index of the source node.
+ * @param r From the source to the target center of mass [m].
+ */
+static inline void translateMultipoleToLocal(FastMultipole_t* fmm, unsigned int target, unsigned int source, vector3D_t r);
+
+/**
+ * @brief Adds the pull of every body of a source leaf to every body of a target leaf.
+ *
+ * @param fmm Pointer to the solver.
+ * @param target Index of the target node.
+ * @param source Index of the source node.
+ */
+static inline void sumDirectly(FastMultipole_t* fmm, unsigned int target, unsigned int source);
+
+/**
+ * @brief Translates the local expansions down to the bodies and stores their accelerations.
+ *
+ * @param fmm Pointer to the solver.
+ * @param node Index of the node.
+ */
+static void downwardPass(FastMultipole_t* fmm, unsigned int node);
+
+FastMultipole_t* constructFastMultipole(unsigned int order, double openingAngle, double softening)
+{
+	FastMultipole_t* fmm = new FastMultipole_t;
+	if (!fmm)
+		return NULL;
+
+	initializeTables();
+
+	order = (order < 1) ? 1 : (order > FMM_ORDER_MAX) ? FMM_ORDER_MAX : order;
+
+	fmm->tree = constructOctree(openingAngle, softening, FMM_LEAF_SIZE);
+	fmm->order = order;
+	fmm->coefficientsNum = coefficientsNumByOrder[order];
+	fmm->multipoles = NULL;
+	fmm->locals = NULL;
+	fmm->radius = NULL;
+	fmm->nodesCapacity = 0;
+	fmm->ax = fmm->ay = fmm->az = NULL;
+	fmm->bodiesCapacity = 0;
+	fmm->tasks = NULL;
+	fmm->tasksNum = 0;
+	fmm->outputX = fmm->outputY = fmm->outputZ = NULL;
+
+	// Index of D_(a+b) for every pair (b, a) of the multipole to local translation
+	unsigned int pairsNum = 0;
+	for (unsigned int b = 0; b < fmm->coefficientsNum; b++)
+		pairsNum += coefficientsNumByOrder[order - coefficientDegree[b]];
+
+	fmm->translationIndex = (unsigned short*)malloc(sizeof(unsigned short) * pairsNum);
+	if (fmm->translationIndex)
+	{
+		unsigned short* index = fmm->translationIndex;
+
+		for (unsigned int b = 0; b < fmm->coefficientsNum; b++)
+		{
+			const unsigned char* pb = coefficientPowers[b];
+
+			for (unsigned int a = 0; a < coefficientsNumByOrder[order - coefficientDegree[b]]; a++)
+			{
+				const unsigned char* pa = coefficientPowers[a];
+				*index++ = coefficientIndex[pa[0] + pb[0]][pa[1] + pb[1]][pa[2] + pb[2]];
+			}
+		}
+	}
+
+	if (!fmm->tree || !fmm->translationIndex)
+	{
+		destroyFastMultipole(fmm);
+		return NULL;
+	}
+
+	return fmm;
+}
+
+void destroyFastMultipole(FastMultipole_t* fmm)
+{
+	if (!fmm)
+		return;
+	destroyOctree(fmm->tree);
+	free(fmm->multipoles);
+	free(fmm->locals);
+	free(fmm->radius);
+	free(fmm->tasks);
+	free(fmm->ax);
+	free(fmm->translationIndex);
+	delete fmm;
+}
+
+int evaluateFastMultipole(FastMultipole_t* fmm, const BodyArrays_t* bodies, unsigned int bodyNum, ThreadPool_t* pool,
+			double* ax, double* ay, double* az)
+{
+	if (buildOctree(fmm->tree, bodies, bodyNum) || reserveArrays(fmm))
+	{
+		memset(ax, 0, sizeof(double) * bodyNum);
+		memset(ay, 0, sizeof(double) * bodyNum);
+		memset(az, 0, sizeof(double) * bodyNum);
+		return -1;
+	}
+
+	fmm->outputX = ax;
+	fmm->outputY = ay;
+	fmm->outputZ = az;
+
+	upwardPass(fmm);
+	splitTasks(fmm);
+
+	// Every task only writes to the nodes and bodies of its own subtree
+	runThreadPool(pool, evaluateTask, fmm, fmm->tasksNum);
+
+	return 0;
+}
+
+double getFastMultipoleError(FastMultipole_t* fmm, const BodyArrays_t* bodies, unsigned int bodyNum, ThreadPool_t* pool,
+			unsigned int sampleNum)
+{
+	if (!bodyNum || !sampleNum)
+		return 0.0;
+
+	double* acceleration = (double*)malloc(sizeof(double) * 3 * bodyNum);
+	if (!acceleration || evaluateFastMultipole(fmm, bodies, bodyNum, pool, acceleration,
+						acceleration + bodyNum, acceleration + 2 * bodyNum))
+	{
+		free(acceleration);
+		return -1.0;
+	}
+
+	double softening_squared = fmm->tree->softening * fmm->tree->softening;
+	double maxError_squared = 0.0;
+	double meanAcceleration_squared = 0.0;
+	unsigned int stride = (bodyNum > sampleNum) ? bodyNum / sampleNum : 1;
+	unsigned int sampled = 0;
+
+	for (unsigned int i = 0; i < bodyNum && sampled < sampleNum; i += stride, sampled++)
+	{
+		vector3D_t direct = {0.0, 0.0, 0.0};
+
+		for (unsigned int j = 0; j < bodyNum; j++)
+		{
+			if (j == i)
+				continue;
+
+			vector3D_t pull = {bodies->x[j] - bodies->x[i], bodies->y[j] - bodies->y[i], bodies->z[j] - bodies->z[i]};
+			double inverse_distance_cubed = 1 / sqrt(DOT_PRODUCT(pull, pull) + softening_squared);
+			inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+
+			direct.x += bodies->mass_GC[j] * pull.x * inverse_distance_cubed;
+			direct.y += bodies->mass_GC[j] * pull.y * inverse_distance_cubed;
+			direct.z += bodies->mass_GC[j] * pull.z * inverse_distance_cubed;
+		}
+
+		vector3D_t error;
+		error.x = acceleration[i] - direct.x;
+		error.y = acceleration[i + bodyNum] - direct.y;
+		error.z = acceleration[i + 2 * bodyNum] - direct.z;
+
+		maxError_squared = fmax(maxError_squared, DOT_PRODUCT(error, error));
+		meanAcceleration_squared += DOT_PRODUCT(direct, direct);
+	}
+	free(acceleration);
+
+	meanAcceleration_squared /= sampled;
+	return (meanAcceleration_squared > 0.0) ? sqrt(maxError_squared / meanAcceleration_squared) : 0.0;
+}
+
+static void initializeTables(void)
+{
+	if (tablesAreInitialized)
+		return;
+
+	unsigned int k = 0;
+
+	for (unsigned int degree = 0; degree <= FMM_ORDER_MAX; degree++)
+	{
+		for (int t = degree; t >= 0; t--)
+		{
+			for (int u = degree - t; u >= 0; u--)
+			{
+				int v = degree - t - u;
+
+				coefficientPowers[k][0] = t;
+				coefficientPowers[k][1] = u;
+				coefficientPowers[k][2] = v;
+				coefficientDegree[k] = degree;
+				coefficientIndex[t][u][v] = k;
+				k++;
+			}
+		}
+		coefficientsNumByOrder[degree] = k;
+	}
+	tablesAreInitialized = 1;
+}
+
+static int reserveArrays(FastMultipole_t* fmm)
+{
+	unsigned int nodesNum = fmm->tree->nodesNum;
+	unsigned int bodyNum = fmm->tree->bodyNum;
+
+	if (nodesNum > fmm->nodesCapacity)
+	{
+		unsigned int capacity = fmm->tree->nodesCapacity;
+
+		free(fmm->multipoles);
+		free(fmm->locals);
+		free(fmm->radius);
+		free(fmm->tasks);
+
+		fmm->multipoles = (double*)malloc(sizeof(double) * fmm->coefficientsNum * capacity);
+		fmm->locals = (double*)malloc(sizeof(double) * fmm->coefficientsNum * capacity);
+		fmm->radius = (double*)malloc(sizeof(double) * capacity);
+		fmm->tasks = (unsigned int*)malloc(sizeof(unsigned int) * 2 * capacity);
+		fmm->nodesCapacity = capacity;
+
+		if (!fmm->multipoles || !fmm->locals || !fmm->radius || !fmm->tasks)
+		{
+			fmm->nodesCapacity = 0;
+			return -1;
+		}
+	}
+
+	if (bodyNum > fmm->bodiesCapacity || !fmm->ax)
+	{
+		unsigned int capacity = fmm->tree->bodiesCapacity;
+
+		free(fmm->ax);
+		fmm->ax = (double*)malloc(sizeof(double) * 3 * capacity);
+		if (!fmm->ax)
+		{
+			fmm->bodiesCapacity = 0;
+			return -1;
+		}
+		fmm->ay = fmm->ax + capacity;
+		fmm->az = fmm->ay + capacity;
+		fmm->bodiesCapacity = capacity;
+	}
+
+	return 0;
+}
+
+static void getScaledPowers(vector3D_t d, unsigned int order, double* powers)
+{
+	double px[FMM_ORDER_MAX + 1], py[FMM_ORDER_MAX + 1], pz[FMM_ORDER_MAX + 1];
+
+	px[0] = py[0] = pz[0] = 1.0;
+	for (unsigned int n = 1; n <= order; n++)
+	{
+		px[n] = px[n - 1] * d.x / n;
+		py[n] = py[n - 1] * d.y / n;
+		pz[n] = pz[n - 1] * d.z / n;
+	}
+
+	for (unsigned int k = 0; k < coefficientsNumByOrder[order]; k++)
+	{
+		powers[k] = px[coefficientPowers[k][0]] * py[coefficientPowers[k][1]] * pz[coefficientPowers[k][2]];
+	}
+}
+
+static void getDerivatives(vector3D_t r, unsigned int order, double* derivatives)
+{
+	// levels[n][k]: k-th derivative of the n-th auxiliary function, only up to degree order - n
+	double levels[FMM_ORDER_MAX + 1][FMM_COEFFICIENTS_MAX];
+	double inverse_distance = 1 / sqrt(DOT_PRODUCT(r, r));
+	double inverse_distance_squared = inverse_distance * inverse_distance;
+	double axis[3] = {r.x, r.y, r.z};
+	unsigned int n;
+
+	// (-1)^n (2n - 1)!! / r^(2n + 1)
+	levels[0][0] = inverse_distance;
+	for (n = 1; n <= order; n++)
+		levels[n][0] = -levels[n - 1][0] * (2 * n - 1) * inverse_distance_squared;
+
+	for (unsigned int k = 1; k < coefficientsNumByOrder[order]; k++)
+	{
+		int power[3] = {coefficientPowers[k][0], coefficientPowers[k][1], coefficientPowers[k][2]};
+		int i = (power[0]) ? 0 : (power[1]) ? 1 : 2;
+		int m = --power[i];
+
+		unsigned int previous = coefficientIndex[power[0]][power[1]][power[2]];
+		unsigned int beforePrevious = 0;
+		if (m)
+		{
+			power[i]--;
+			beforePrevious = coefficientIndex[power[0]][power[1]][power[2]];
+		}
+
+		for (n = 0; n + coefficientDegree[k] <= order; n++)
+		{
+			levels[n][k] = axis[i] * levels[n + 1][previous];
+			if (m)
+				levels[n][k] += m * levels[n + 1][beforePrevious];
+		}
+	}
+
+	memcpy(derivatives, levels[0], sizeof(double) * coefficientsNumByOrder[order]);
+}
+
+static void upwardPass(FastMultipole_t* fmm)
+{
+	const Octree_t* tree = fmm->tree;
+	unsigned int coefficientsNum = fmm->coefficientsNum;
+	double powers[FMM_COEFFICIENTS_MAX];
+
+	memset(fmm->locals, 0, sizeof(double) * coefficientsNum * tree->nodesNum);
+	memset(fmm->ax, 0, sizeof(double) * tree->bodyNum);
+	memset(fmm->ay, 0, sizeof(double) * tree->bodyNum);
+	memset(fmm->az, 0, sizeof(double) * tree->bodyNum);
+
+	// Children are always stored after their parent
+	for (unsigned int i = tree->nodesNum; i-- > 0;)
+	{
+		const OctreeNode_t* node = tree->nodes + i;
+		double* multipole = fmm->multipoles + i * coefficientsNum;
+
+		memset(multipole, 0, sizeof(double) * coefficientsNum);
+		fmm->radius[i] = 0.0;
+
+		if (!node->firstChild)
+		{
+			for (unsigned int k = node->firstBody; k < node->firstBody + node->bodyNum; k++)
+			{
+				vector3D_t d = {tree->x[k] - node->centerOfMass.x, tree->y[k] - node->centerOfMass.y,
+						tree->z[k] - node->centerOfMass.z};
+
+				getScaledPowers(d, fmm->order, powers);
+				for (unsigned int a = 0; a < coefficientsNum; a++)
+					multipole[a] += tree->mass_GC[k] * powers[a];
+
+				fmm->radius[i] = fmax(fmm->radius[i], sqrt(DOT_PRODUCT(d, d)));
+			}
+			continue;
+		}
+
+		for (unsigned int octant = 0; octant < 8; octant++)
+		{
+			unsigned int c = node->firstChild + octant;
+			const OctreeNode_t* child = tree->nodes + c;
+			const double* childMultipole = fmm->multipoles + c * coefficientsNum;
+
+			if (!child->bodyNum)
+				continue;
+
+			vector3D_t s = {child->centerOfMass.x - node->centerOfMass.x, child->centerOfMass.y - node->centerOfMass.y,
+					child->centerOfMass.z - node->centerOfMass.z};
+
+			// M_a += sum over g <= a of M_g s^(a - g) / (a - g)!
+			getScaledPowers(s, fmm->order, powers);
+			for (unsigned int a = 0; a < coefficientsNum; a++)
+			{
+				const unsigned char* pa = coefficientPowers[a];
+
+				for (unsigned int t = 0; t <= pa[0]; t++)
+					for (unsigned int u = 0; u <= pa[1]; u++)
+						for (unsigned int v = 0; v <= pa[2]; v++)
+							multipole[a] += childMultipole[coefficientIndex[t][u][v]] *
+									powers[coefficientIndex[pa[0] - t][pa[1] - u][pa[2] - v]];
+			}
+
+			fmm->radius[i] = fmax(fmm->radius[i], sqrt(DOT_PRODUCT(s, s)) + fmm->radius[c]);
+		}
+	}
+}
+
+static void splitTasks(FastMultipole_t* fmm)
+{
+	const Octree_t* tree = fmm->tree;
+	unsigned int* tasks = fmm->tasks;
+	unsigned int* nextTasks = fmm->tasks + fmm->nodesCapacity;
+	unsigned int tasksNum = 0;
+
+	if (tree->nodesNum && tree->nodes[0].bodyNum)
+		tasks[tasksNum++] = 0;
+
+	// Splits every subtree one level at a time, so the split never depends on the threads
+	while (tasksNum && tasksNum < FMM_TASKS_MIN)
+	{
+		unsigned int nextTasksNum = 0;
+		int split = 0;
+
+		for (unsigned int i = 0; i < tasksNum; i++)
+		{
+			const OctreeNode_t* node = tree->nodes + tasks[i];
+
+			if (!node->firstChild)
+			{
+				nextTasks[nextTasksNum++] = tasks[i];
+				continue;
+			}
+			for (unsigned int octant = 0; octant < 8; octant++)
+			{
+				if (tree->nodes[node->firstChild + octant].bodyNum)
+					nextTasks[nextTasksNum++] = node->firstChild + octant;
+			}
+			split = 1;
+		}
+		if (!split)
+			break;
+
+		memcpy(tasks, nextTasks, sizeof(unsigned int) * nextTasksNum);
+		tasksNum = nextTasksNum;
+	}
+
+	fmm->tasksNum = tasksNum;
+}
+
+static void evaluateTask(void* data, unsigned int task)
+{
+	FastMultipole_t* fmm = (FastMultipole_t*)data;
+	unsigned int node = fmm->tasks[task];
+
+	interactNodes(fmm, node, 0);
+	downwardPass(fmm, node);
+}
+
+static void interactNodes(FastMultipole_t* fmm, unsigned int target, unsigned int source)
+{
+	const Octree_t* tree = fmm->tree;
+	const OctreeNode_t* targetNode = tree->nodes + target;
+	const OctreeNode_t* sourceNode = tree->nodes + source;
+
+	vector3D_t r;
+	r.x = targetNode->centerOfMass.x - sourceNode->centerOfMass.x;
+	r.y = targetNode->centerOfMass.y - sourceNode->centerOfMass.y;
+	r.z = targetNode->centerOfMass.z - sourceNode->centerOfMass.z;
+
+	// Expansions are not softened, so nodes closer than the softening are never accepted
+	double reach = fmm->radius[target] + fmm->radius[source] + 2 * tree->softening;
+
+	if (target != source && reach * reach < tree->openingAngle * tree->openingAngle * DOT_PRODUCT(r, r))
+	{
+		translateMultipoleToLocal(fmm, target, source, r);
+		return;
+	}
+
+	if (!targetNode->firstChild && !sourceNode->firstChild)
+	{
+		sumDirectly(fmm, target, source);
+		return;
+	}
+
+	// Opens the larger node (the target on ties, the leaf never)
+	int openTarget = !sourceNode->firstChild ||
+			(targetNode->firstChild && targetNode->halfSize >= sourceNode->halfSize);
+
+	const OctreeNode_t* opened = (openTarget) ? targetNode : sourceNode;
+	for (unsigned int octant = 0; octant < 8; octant++)
+	{
+		unsigned int child = opened->firstChild + octant;
+
+		if (!tree->nodes[child].bodyNum)
+			continue;
+		if (openTarget)
+			interactNodes(fmm, child, source);
+		else
+			interactNodes(fmm, target, child);
+	}
+}
+
+static inline void translateMultipoleToLocal(FastMultipole_t* fmm, unsigned int target, unsigned int source, vector3D_t r)
+{
+	unsigned int coefficientsNum = fmm->coefficientsNum;
+	const double* multipole = fmm->multipoles + source * coefficientsNum;
+	double* local = fmm->locals + target * coefficientsNum;
+	double derivatives[FMM_COEFFICIENTS_MAX];
+	double signedMultipole[FMM_COEFFICIENTS_MAX];
+
+	const unsigned short* index = fmm->translationIndex;
+
+	getDerivatives(r, fmm->order, derivatives);
+	for (unsigned int a = 0; a < coefficientsNum; a++)
+		signedMultipole[a] = (coefficientDegree[a] & 1) ? -multipole[a] : multipole[a];
+
+	for (unsigned int b = 0; b < coefficientsNum; b++)
+	{
+		unsigned int termsNum = coefficientsNumByOrder[fmm->order - coefficientDegree[b]];
+		double sum = 0.0;
+
+		for (unsigned int a = 0; a < termsNum; a++)
+			sum += signedMultipole[a] * derivatives[index[a]];
+		index += termsNum;
+		local[b] += sum;
+	}
+}
+
+static inline void sumDirectly(FastMultipole_t* fmm, unsigned int target, unsigned int source)
+{
+	const Octree_t* tree = fmm->tree;
+	const OctreeNode_t* targetNode = tree->nodes + target;
+	const OctreeNode_t* sourceNode = tree->nodes + source;
+	double softening_squared = tree->softening * tree->softening;
+
+	for (unsigned int k = targetNode->firstBody; k < targetNode->firstBody + targetNode->bodyNum; k++)
+	{
+		vector3D_t acceleration = {0.0, 0.0, 0.0};
+
+		for (unsigned int j = sourceNode->firstBody; j < sourceNode->firstBody + sourceNode->bodyNum; j++)
+		{
+			if (j == k)
+				continue;
+
+			vector3D_t pull = {tree->x[j] - tree->x[k], tree->y[j] - tree->y[k], tree->z[j] - tree->z[k]};
+			double inverse_distance_cubed = 1 / sqrt(DOT_PRODUCT(pull, pull) + softening_squared);
+			inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+
+			acceleration.x += tree->mass_GC[j] * pull.x * inverse_distance_cubed;
+			acceleration.y += tree->mass_GC[j] * pull.y * inverse_distance_cubed;
+			acceleration.z += tree->mass_GC[j] * pull.z * inverse_distance_cubed;
+		}
+		fmm->ax[k] += acceleration.x;
+		fmm->ay[k] += acceleration.y;
+		fmm->az[k] += acceleration.z;
+	}
+}
+
+static void downwardPass(FastMultipole_t* fmm, unsigned int node)
+{
+	const Octree_t* tree = fmm->tree;
+	const OctreeNode_t* parent = tree->nodes + node;
+	unsigned int coefficientsNum = fmm->coefficientsNum;
+	const double* local = fmm->locals + node * coefficientsNum;
+	double powers[FMM_COEFFICIENTS_MAX];
+
+	if (!parent->firstChild)
+	{
+		unsigned int termsNum = coefficientsNumByOrder[fmm->order - 1];
+
+		// a_i = sum over |b| < p of L_(b + e_i) e^b / b!
+		for (unsigned int k = parent->firstBody; k < parent->firstBody + parent->bodyNum; k++)
+		{
+			vector3D_t e = {tree->x[k] - parent->centerOfMass.x, tree->y[k] - parent->centerOfMass.y,
+					tree->z[k] - parent->centerOfMass.z};
+			vector3D_t acceleration = {0.0, 0.0, 0.0};
+
+			getScaledPowers(e, fmm->order - 1, powers);
+			for (unsigned int b = 0; b < termsNum; b++)
+			{
+				const unsigned char* pb = coefficientPowers[b];
+
+				acceleration.x += local[coefficientIndex[pb[0] + 1][pb[1]][pb[2]]] * powers[b];
+				acceleration.y += local[coefficientIndex[pb[0]][pb[1] + 1][pb[2]]] * powers[b];
+				acceleration.z += local[coefficientIndex[pb[0]][pb[1]][pb[2] + 1]] * powers[b];
+			}
+
+			fmm->outputX[tree->index[k]] = fmm->ax[k] + acceleration.x;
+			fmm->outputY[tree->index[k]] = fmm->ay[k] + acceleration.y;
+			fmm->outputZ[tree->index[k]] = fmm->az[k] + acceleration.z;
+		}
+		return;
+	}
+
+	for (unsigned int octant = 0; octant < 8; octant++)
+	{
+		unsigned int c = parent->firstChild + octant;
+		const OctreeNode_t* child = tree->nodes + c;
+		double* childLocal = fmm->locals + c * coefficientsNum;
+
+		if (!child->bodyNum)
+			continue;
+
+		vector3D_t t = {child->centerOfMass.x - parent->centerOfMass.x, child->centerOfMass.y - parent->centerOfMass.y,
+				child->centerOfMass.z - parent->centerOfMass.z};
+
+		// L_b += sum over |b + d| <= p of L_(b + d) t^d / d!
+		getScaledPowers(t, fmm->order, powers);
+		for (unsigned int b = 0; b < coefficientsNum; b++)
+		{
+			const unsigned char* pb = coefficientPowers[b];
+
+			for (unsigned int d = 0; d < coefficientsNumByOrder[fmm->order - coefficientDegree[b]]; d++)
+			{
+				const unsigned char* pd = coefficientPowers[d];
+				childLocal[b] += local[coefficientIndex[pb[0] + pd[0]][pb[1] + pd[1]][pb[2] + pd[2]]] * powers[d];
+			}
+		}
+
+		downwardPass(fmm, c);
+	}
+}
@@ -0,0 +1,109 @@
+/**
+ * @brief Frame budget governor of the physics
+ *
+ * The updates of a simulated second cost updateTime / dt real seconds, so at
+ * simulationSpeed they take simulationSpeed * updateTime / dt of each real
+ * second. Keeping that share at the budget gives
+ *
+ *	dt = simulationSpeed * updateTime / budget,
+ *
+ * the finest timestep that keeps up. The simulated days per second stay fixed,
+ * only the amount of updates per frame follows the load.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "frameGovernor.h"
+#include <chrono>
+#include <math.h>
+
+// Share of the real time the updates may take, the rest is left to the view
+#define GOVERNOR_BUDGET_MAX 0.8
+#define GOVERNOR_BUDGET_MIN 0.2
+
+// Budget change per measure while the view misses (or makes) its frame time
+#define GOVERNOR_BUDGET_DECREASE 0.95
+#define GOVERNOR_BUDGET_INCREASE 1.01
+
+// Frame time over the target the view may take before the budget shrinks
+#define GOVERNOR_FRAMETIME_SLACK 1.1
+
+// Weight of each new measure in the average time of an update
+#define GOVERNOR_SMOOTHING 0.1
+
+// The timestep only changes once the wanted one is off by more than this ratio
+#define GOVERNOR_HYSTERESIS 1.25
+
+/**
+ * @brief Calculates the timestep that fits the measures of a governor.
+ *
+ * @param governor Pointer to the governor.
+ *
+ * @return The timestep [s].
+ */
+static double getFittedTimestep(const FrameGovernor_t* governor);
+
+void initFrameGovernor(FrameGovernor_t* governor, double simulationSpeed, double targetFrametime, double dt)
+{
+	governor->simulationSpeed = simulationSpeed;
+	governor->targetFrametime = targetFrametime;
+	governor->budget = GOVERNOR_BUDGET_MAX;
+	governor->updateTime = 0.0;
+	governor->dt = dt;
+}
+
+void primeFrameGovernor(FrameGovernor_t* governor, OrbitalSim_t* sim, int spawnBH)
+{
+	sim->dt = governor->dt;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	readSpaceShipInputs(sim);
+	updateOrbitalSim(sim, spawnBH);
+	governor->updateTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	governor->dt = getFittedTimestep(governor);
+	sim->dt = governor->dt;
+}
+
+double updateFrameGovernor(FrameGovernor_t* governor, double updatesTime, unsigned int updatesNum, double frametime)
+{
+	if (!updatesNum)
+		return governor->dt;
+
+	double updateTime = updatesTime / updatesNum;
+	if (governor->updateTime > 0.0)
+		governor->updateTime += GOVERNOR_SMOOTHING * (updateTime - governor->updateTime);
+	else
+		governor->updateTime = updateTime;
+
+	// A slow frame means the physics is taking time the rendering needs
+	if (frametime > governor->targetFrametime * GOVERNOR_FRAMETIME_SLACK)
+		governor->budget = fmax(governor->budget * GOVERNOR_BUDGET_DECREASE, GOVERNOR_BUDGET_MIN);
+	else if (frametime > 0.0)
+		governor->budget = fmin(governor->budget * GOVERNOR_BUDGET_INCREASE, GOVERNOR_BUDGET_MAX);
+
+	double dt = getFittedTimestep(governor);
+	if (dt > governor->dt * GOVERNOR_HYSTERESIS || dt * GOVERNOR_HYSTERESIS < governor->dt)
+		governor->dt = dt;
+
+	return governor->dt;
+}
+
+double getFrameGovernorUpdatesPerFrame(const FrameGovernor_t* governor)
+{
+	return governor->simulationSpeed * governor->targetFrametime / governor->dt;
+}
+
+static double getFittedTimestep(const FrameGovernor_t* governor)
+{
+	double dt = governor->simulationSpeed * governor->updateTime / governor->budget;
+
+	// At least one update per frame, so the view never shows the same state twice
+	double dtMax = governor->simulationSpeed * governor->targetFrametime;
+	if (dt > dtMax || !(dt > 0.0))
+		dt = dtMax;
+
+	return dt;
+}
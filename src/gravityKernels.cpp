@@ -0,0 +1,1219 @@
+/**
+ * @brief Vectorized gravity kernels for the asteroid arrays
+ *
+ * Every kernel performs the same double precision operations, in the same
+ * order, as the scalar one. The pull of the asteroids on each source is
+ * summed in GRAVITY_REACTION_LANES lanes whatever the vector width, and the
+ * lanes are reduced in a fixed tree, so every kernel gives the same bits.
+ *
+ * The mixed precision kernels agree with each other the same way. The offset
+ * of each asteroid to the first source is taken in double and rounded to
+ * float once. From there the offsets to every source, the inverse distances
+ * cubed and the sum of the pulls are single precision IEEE operations (no
+ * approximate reciprocals) done in the same order in every kernel, with the
+ * pull on the sources summed in MIXED_REACTION_LANES float lanes. The sums are
+ * widened to double before they kick and drift the asteroids.
+ *
+ * Every asteroid is anchored on the first source, not on the body that
+ * dominates its pull. Chunks hold asteroids from the whole belt, so one anchor
+ * per chunk would almost always be the star, and one per asteroid would need
+ * a gather per source. The rounding of the offset to the star (about 1E-7 of
+ * it) therefore also goes into the offset to a nearby planet: close to Jupiter
+ * the pull is off by about 3E-6 at 1E10 m and 3E-4 at 1E8 m, against 1E-7 far
+ * from the planets.
+ *
+ * Every kernel is a template on REACTING. Without it the asteroids are test
+ * particles: the reaction lanes are dropped at compile time, and the sweep of
+ * each chunk writes nothing but its own asteroids.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "gravityKernels.h"
+#include "vector3D.h"
+#include <math.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#define GRAVITY_KERNELS_X86
+	#include <immintrin.h>
+#endif
+
+#define GRAVITY_KERNEL_PARAMETERS const GravitySource_t* sources, unsigned int sourcesNum, unsigned int reactingNum, \
+				BodyArrays_t* asteroids, unsigned int begin, unsigned int end, double kick, double drift, \
+				int accumulate, vector3D_t* reactions
+
+// Lanes the pull on each source is summed in: asteroid j goes to lane
+// (j - begin) % GRAVITY_REACTION_LANES. The widest vector fills all of them.
+#define GRAVITY_REACTION_LANES 8
+
+/**
+ * @brief Pull of the asteroids on a source, per lane: x, y and z lanes.
+ */
+typedef double ReactionLanes_t[3][GRAVITY_REACTION_LANES];
+
+// Lanes of the mixed precision kernels, twice as many: the widest float vector fills them
+#define MIXED_REACTION_LANES (GRAVITY_REACTION_LANES * 2)
+
+/**
+ * @brief Pull of the asteroids on a source in the mixed precision kernels, per lane.
+ */
+typedef float MixedReactionLanes_t[3][MIXED_REACTION_LANES];
+
+/**
+ * @brief Source, packed for the mixed precision kernels.
+ */
+typedef struct
+{
+	float offset[3];		// From the first source [m * MIXED_OFFSET_SCALE]
+	float mass_GC;			// [m^3 / s^2 * MIXED_PULL_SCALE]
+} MixedSource_t;
+
+// Offsets are scaled by 2^-32 before they are rounded to float, which keeps the
+// inverse distance cubed of any distance from 1 mm to 1E15 m a normal float.
+// The pulls then come out scaled by 2^-64, undone by scaling the masses.
+#define MIXED_OFFSET_SCALE (1.0 / 4294967296.0)
+#define MIXED_PULL_SCALE (MIXED_OFFSET_SCALE * MIXED_OFFSET_SCALE)
+
+/**
+ * @brief Picks the widest kernel the running CPU supports.
+ *
+ * @param precision Precision of the pulls.
+ *
+ * @return The kernel, with (REACTING) or without the pull of the asteroids on the sources.
+ */
+template <bool REACTING>
+static gravityKernel_t selectGravityKernel(GravityPrecision_t precision);
+
+/**
+ * @brief Scalar kernel.
+ */
+template <bool REACTING>
+static void gravityKernelScalar(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Scalar sweep of the asteroids in [first, end), also used for the
+ *		tail the vector kernels leave.
+ *
+ * @param lanes Where the pull on each reacting source is added, in the lane
+ *		of each asteroid (counted from begin).
+ */
+template <bool REACTING>
+static void sweepAsteroidsScalar(const GravitySource_t* sources, unsigned int sourcesNum, unsigned int reactingNum,
+				BodyArrays_t* asteroids, unsigned int begin, unsigned int first, unsigned int end,
+				double kick, double drift, int accumulate, ReactionLanes_t* lanes);
+
+/**
+ * @brief Reduces the lanes of each reacting source, always in the same tree.
+ *
+ * @param lanes The lanes of each reacting source.
+ * @param reactingNum The amount of reacting sources.
+ * @param reactions Where the pull on each reacting source is stored.
+ */
+static void reduceReactionLanes(const ReactionLanes_t* lanes, unsigned int reactingNum, vector3D_t* reactions);
+
+/**
+ * @brief Mixed precision scalar kernel.
+ */
+template <bool REACTING>
+static void gravityKernelMixedScalar(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Packs the sources for the mixed precision kernels.
+ *
+ * @param sources The sources.
+ * @param sourcesNum The amount of sources.
+ * @param mixedSources Where the packed sources are stored.
+ *
+ * @return The position every offset is taken from, the first source [m].
+ */
+static vector3D_t packMixedSources(const GravitySource_t* sources, unsigned int sourcesNum, MixedSource_t* mixedSources);
+
+/**
+ * @brief Mixed precision scalar sweep of the asteroids in [first, end), also
+ *		used for the tail the mixed precision vector kernels leave.
+ *
+ * @param anchor The position returned by packMixedSources.
+ * @param mixedSources The sources, packed by packMixedSources.
+ * @param lanes Where the pull on each reacting source is added, in the lane
+ *		of each asteroid (counted from begin).
+ */
+template <bool REACTING>
+static void sweepAsteroidsMixedScalar(vector3D_t anchor, const MixedSource_t* mixedSources, unsigned int sourcesNum,
+				unsigned int reactingNum, BodyArrays_t* asteroids, unsigned int begin, unsigned int first,
+				unsigned int end, double kick, double drift, int accumulate, MixedReactionLanes_t* lanes);
+
+/**
+ * @brief Widens the lanes of each reacting source to double and reduces them,
+ *		always in the same tree.
+ *
+ * @param lanes The lanes of each reacting source.
+ * @param reactingNum The amount of reacting sources.
+ * @param reactions Where the pull on each reacting source is stored.
+ */
+static void reduceMixedReactionLanes(const MixedReactionLanes_t* lanes, unsigned int reactingNum, vector3D_t* reactions);
+
+#ifdef GRAVITY_KERNELS_X86
+/**
+ * @brief SSE2 kernel (2 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("sse2")))
+static void gravityKernelSSE2(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief AVX2 kernel (4 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("avx2")))
+static void gravityKernelAVX2(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief AVX-512 kernel (8 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("avx512f")))
+static void gravityKernelAVX512(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Mixed precision SSE2 kernel (4 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("sse2")))
+static void gravityKernelMixedSSE2(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Mixed precision AVX2 kernel (8 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("avx2")))
+static void gravityKernelMixedAVX2(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Mixed precision AVX-512 kernel (16 asteroids per instruction).
+ */
+template <bool REACTING>
+__attribute__((target("avx512f")))
+static void gravityKernelMixedAVX512(GRAVITY_KERNEL_PARAMETERS);
+
+/**
+ * @brief Rounds two double vectors to one float vector, the low one first
+ *		(SSE2, AVX2 and AVX-512 versions).
+ *
+ * @param low The first doubles.
+ * @param high The next doubles.
+ *
+ * @return The floats.
+ */
+static inline __m128 narrowSSE2(__m128d low, __m128d high);
+static inline __m256 narrowAVX2(__m256d low, __m256d high);
+static inline __m512 narrowAVX512(__m512d low, __m512d high);
+
+/**
+ * @brief Widens the low (or high) half of a float vector to double
+ *		(SSE2, AVX2 and AVX-512 versions).
+ *
+ * @param floats The float vector.
+ *
+ * @return The half, as doubles.
+ */
+static inline __m128d widenLowSSE2(__m128 floats);
+static inline __m128d widenHighSSE2(__m128 floats);
+static inline __m256d widenLowAVX2(__m256 floats);
+static inline __m256d widenHighAVX2(__m256 floats);
+static inline __m512d widenLowAVX512(__m512 floats);
+static inline __m512d widenHighAVX512(__m512 floats);
+#endif
+
+gravityKernel_t getGravityKernel(GravityPrecision_t precision, int testParticles)
+{
+	if (testParticles)
+		return selectGravityKernel<false>(precision);
+	return selectGravityKernel<true>(precision);
+}
+
+const char* getGravityKernelName(void)
+{
+	gravityKernel_t kernel = getGravityKernel(GRAVITY_PRECISION_DOUBLE, 0);
+
+#ifdef GRAVITY_KERNELS_X86
+	if (kernel == gravityKernelAVX512<true>)
+		return "AVX-512";
+	if (kernel == gravityKernelAVX2<true>)
+		return "AVX2";
+	if (kernel == gravityKernelSSE2<true>)
+		return "SSE2";
+#endif
+	return (kernel == gravityKernelScalar<true>) ? "Scalar" : "Unknown";
+}
+
+template <bool REACTING>
+static gravityKernel_t selectGravityKernel(GravityPrecision_t precision)
+{
+	int mixed = (precision == GRAVITY_PRECISION_MIXED);
+
+#ifdef GRAVITY_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return (mixed) ? gravityKernelMixedAVX512<REACTING> : gravityKernelAVX512<REACTING>;
+	if (__builtin_cpu_supports("avx2"))
+		return (mixed) ? gravityKernelMixedAVX2<REACTING> : gravityKernelAVX2<REACTING>;
+	if (__builtin_cpu_supports("sse2"))
+		return (mixed) ? gravityKernelMixedSSE2<REACTING> : gravityKernelSSE2<REACTING>;
+#endif
+	return (mixed) ? gravityKernelMixedScalar<REACTING> : gravityKernelScalar<REACTING>;
+}
+
+template <bool REACTING>
+static void gravityKernelScalar(GRAVITY_KERNEL_PARAMETERS)
+{
+	ReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+
+	for (unsigned int i = 0; i < reactingNum; i++)
+	{
+		for (unsigned int lane = 0; lane < GRAVITY_REACTION_LANES; lane++)
+			lanes[i][0][lane] = lanes[i][1][lane] = lanes[i][2][lane] = 0.0;
+	}
+
+	sweepAsteroidsScalar<REACTING>(sources, sourcesNum, reactingNum, asteroids, begin, begin, end, kick, drift, accumulate, lanes);
+	reduceReactionLanes(lanes, reactingNum, reactions);
+}
+
+template <bool REACTING>
+static void sweepAsteroidsScalar(const GravitySource_t* sources, unsigned int sourcesNum, unsigned int reactingNum,
+				BodyArrays_t* asteroids, unsigned int begin, unsigned int first, unsigned int end,
+				double kick, double drift, int accumulate, ReactionLanes_t* lanes)
+{
+	unsigned int i;
+
+	for (unsigned int j = first; j < end; j++)
+	{
+		unsigned int lane = (j - begin) % GRAVITY_REACTION_LANES;
+		vector3D_t position = {asteroids->x[j], asteroids->y[j], asteroids->z[j]};
+		vector3D_t acceleration = {0.0, 0.0, 0.0};
+		double mass_GC = asteroids->mass_GC[j];
+
+		if (accumulate)
+		{
+			acceleration.x = asteroids->ax[j];
+			acceleration.y = asteroids->ay[j];
+			acceleration.z = asteroids->az[j];
+		}
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			vector3D_t pull;
+			double inverse_distance_cubed;
+
+			pull.x = position.x - sources[i].position.x;
+			pull.y = position.y - sources[i].position.y;
+			pull.z = position.z - sources[i].position.z;
+
+			inverse_distance_cubed = 1 / sqrt(DOT_PRODUCT(pull, pull));
+			inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+
+			pull.x *= inverse_distance_cubed;
+			pull.y *= inverse_distance_cubed;
+			pull.z *= inverse_distance_cubed;
+
+			acceleration.x -= sources[i].mass_GC * pull.x;
+			acceleration.y -= sources[i].mass_GC * pull.y;
+			acceleration.z -= sources[i].mass_GC * pull.z;
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			lanes[i][0][lane] += mass_GC * pull.x;
+			lanes[i][1][lane] += mass_GC * pull.y;
+			lanes[i][2][lane] += mass_GC * pull.z;
+		}
+
+		asteroids->ax[j] = acceleration.x;
+		asteroids->ay[j] = acceleration.y;
+		asteroids->az[j] = acceleration.z;
+
+		asteroids->vx[j] += acceleration.x * kick;
+		asteroids->vy[j] += acceleration.y * kick;
+		asteroids->vz[j] += acceleration.z * kick;
+
+		asteroids->x[j] = position.x + asteroids->vx[j] * drift;
+		asteroids->y[j] = position.y + asteroids->vy[j] * drift;
+		asteroids->z[j] = position.z + asteroids->vz[j] * drift;
+	}
+}
+
+static void reduceReactionLanes(const ReactionLanes_t* lanes, unsigned int reactingNum, vector3D_t* reactions)
+{
+	double sums[3];
+
+	for (unsigned int i = 0; i < reactingNum; i++)
+	{
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			const double* lane = lanes[i][axis];
+			sums[axis] = ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+		}
+		reactions[i].x = sums[0];
+		reactions[i].y = sums[1];
+		reactions[i].z = sums[2];
+	}
+}
+
+template <bool REACTING>
+static void gravityKernelMixedScalar(GRAVITY_KERNEL_PARAMETERS)
+{
+	MixedSource_t mixedSources[GRAVITY_SOURCES_MAX];
+	MixedReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	vector3D_t anchor = packMixedSources(sources, sourcesNum, mixedSources);
+
+	for (unsigned int i = 0; i < reactingNum; i++)
+	{
+		for (unsigned int lane = 0; lane < MIXED_REACTION_LANES; lane++)
+			lanes[i][0][lane] = lanes[i][1][lane] = lanes[i][2][lane] = 0.0f;
+	}
+
+	sweepAsteroidsMixedScalar<REACTING>(anchor, mixedSources, sourcesNum, reactingNum, asteroids, begin, begin, end,
+				kick, drift, accumulate, lanes);
+	reduceMixedReactionLanes(lanes, reactingNum, reactions);
+}
+
+static vector3D_t packMixedSources(const GravitySource_t* sources, unsigned int sourcesNum, MixedSource_t* mixedSources)
+{
+	vector3D_t anchor = {0.0, 0.0, 0.0};
+
+	if (sourcesNum)
+		anchor = sources[0].position;
+
+	for (unsigned int i = 0; i < sourcesNum; i++)
+	{
+		mixedSources[i].offset[0] = (float)((sources[i].position.x - anchor.x) * MIXED_OFFSET_SCALE);
+		mixedSources[i].offset[1] = (float)((sources[i].position.y - anchor.y) * MIXED_OFFSET_SCALE);
+		mixedSources[i].offset[2] = (float)((sources[i].position.z - anchor.z) * MIXED_OFFSET_SCALE);
+		mixedSources[i].mass_GC = (float)(sources[i].mass_GC * MIXED_PULL_SCALE);
+	}
+
+	return anchor;
+}
+
+template <bool REACTING>
+static void sweepAsteroidsMixedScalar(vector3D_t anchor, const MixedSource_t* mixedSources, unsigned int sourcesNum,
+				unsigned int reactingNum, BodyArrays_t* asteroids, unsigned int begin, unsigned int first,
+				unsigned int end, double kick, double drift, int accumulate, MixedReactionLanes_t* lanes)
+{
+	unsigned int i;
+
+	for (unsigned int j = first; j < end; j++)
+	{
+		unsigned int lane = (j - begin) % MIXED_REACTION_LANES;
+		vector3D_t position = {asteroids->x[j], asteroids->y[j], asteroids->z[j]};
+		vector3D_t acceleration = {0.0, 0.0, 0.0};
+		float mass_GC = (float)(asteroids->mass_GC[j] * MIXED_PULL_SCALE);
+
+		if (accumulate)
+		{
+			acceleration.x = asteroids->ax[j];
+			acceleration.y = asteroids->ay[j];
+			acceleration.z = asteroids->az[j];
+		}
+
+		float anchorOffsetX = (float)((position.x - anchor.x) * MIXED_OFFSET_SCALE);
+		float anchorOffsetY = (float)((position.y - anchor.y) * MIXED_OFFSET_SCALE);
+		float anchorOffsetZ = (float)((position.z - anchor.z) * MIXED_OFFSET_SCALE);
+		float sumX = 0.0f;
+		float sumY = 0.0f;
+		float sumZ = 0.0f;
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			float offsetX = anchorOffsetX - mixedSources[i].offset[0];
+			float offsetY = anchorOffsetY - mixedSources[i].offset[1];
+			float offsetZ = anchorOffsetZ - mixedSources[i].offset[2];
+
+			float inverse_distance_cubed = 1.0f / sqrtf(offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ);
+			inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+
+			offsetX *= inverse_distance_cubed;
+			offsetY *= inverse_distance_cubed;
+			offsetZ *= inverse_distance_cubed;
+
+			sumX -= mixedSources[i].mass_GC * offsetX;
+			sumY -= mixedSources[i].mass_GC * offsetY;
+			sumZ -= mixedSources[i].mass_GC * offsetZ;
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			lanes[i][0][lane] += mass_GC * offsetX;
+			lanes[i][1][lane] += mass_GC * offsetY;
+			lanes[i][2][lane] += mass_GC * offsetZ;
+		}
+
+		acceleration.x += sumX;
+		acceleration.y += sumY;
+		acceleration.z += sumZ;
+
+		asteroids->ax[j] = acceleration.x;
+		asteroids->ay[j] = acceleration.y;
+		asteroids->az[j] = acceleration.z;
+
+		asteroids->vx[j] += acceleration.x * kick;
+		asteroids->vy[j] += acceleration.y * kick;
+		asteroids->vz[j] += acceleration.z * kick;
+
+		asteroids->x[j] = position.x + asteroids->vx[j] * drift;
+		asteroids->y[j] = position.y + asteroids->vy[j] * drift;
+		asteroids->z[j] = position.z + asteroids->vz[j] * drift;
+	}
+}
+
+static void reduceMixedReactionLanes(const MixedReactionLanes_t* lanes, unsigned int reactingNum, vector3D_t* reactions)
+{
+	double sums[3];
+	double lane[MIXED_REACTION_LANES];
+
+	for (unsigned int i = 0; i < reactingNum; i++)
+	{
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			for (unsigned int k = 0; k < MIXED_REACTION_LANES; k++)
+				lane[k] = lanes[i][axis][k];
+			sums[axis] = (((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]))) +
+					(((lane[8] + lane[9]) + (lane[10] + lane[11])) + ((lane[12] + lane[13]) + (lane[14] + lane[15])));
+		}
+		reactions[i].x = sums[0];
+		reactions[i].y = sums[1];
+		reactions[i].z = sums[2];
+	}
+}
+
+#ifdef GRAVITY_KERNELS_X86
+template <bool REACTING>
+__attribute__((target("sse2")))
+static void gravityKernelSSE2(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d kickStep = _mm_set1_pd(kick);
+	const __m128d driftStep = _mm_set1_pd(drift);
+	__m128d reactionX[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 2];
+	__m128d reactionY[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 2];
+	__m128d reactionZ[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 2];
+	ReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 2; block++)
+		{
+			reactionX[i][block] = _mm_setzero_pd();
+			reactionY[i][block] = _mm_setzero_pd();
+			reactionZ[i][block] = _mm_setzero_pd();
+		}
+	}
+
+	for (j = begin; j + 2 <= end; j += 2)
+	{
+		block = (j - begin) / 2 % (GRAVITY_REACTION_LANES / 2);
+		const __m128d x = _mm_loadu_pd(asteroids->x + j);
+		const __m128d y = _mm_loadu_pd(asteroids->y + j);
+		const __m128d z = _mm_loadu_pd(asteroids->z + j);
+		const __m128d mass = _mm_loadu_pd(asteroids->mass_GC + j);
+		__m128d accelerationX = (accumulate) ? _mm_loadu_pd(asteroids->ax + j) : _mm_setzero_pd();
+		__m128d accelerationY = (accumulate) ? _mm_loadu_pd(asteroids->ay + j) : _mm_setzero_pd();
+		__m128d accelerationZ = (accumulate) ? _mm_loadu_pd(asteroids->az + j) : _mm_setzero_pd();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m128d sourceMass = _mm_set1_pd(sources[i].mass_GC);
+			__m128d pullX = _mm_sub_pd(x, _mm_set1_pd(sources[i].position.x));
+			__m128d pullY = _mm_sub_pd(y, _mm_set1_pd(sources[i].position.y));
+			__m128d pullZ = _mm_sub_pd(z, _mm_set1_pd(sources[i].position.z));
+
+			__m128d distance_squared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(pullX, pullX), _mm_mul_pd(pullY, pullY)), _mm_mul_pd(pullZ, pullZ));
+			__m128d inverse_distance_cubed = _mm_div_pd(one, _mm_sqrt_pd(distance_squared));
+			inverse_distance_cubed = _mm_mul_pd(_mm_mul_pd(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			pullX = _mm_mul_pd(pullX, inverse_distance_cubed);
+			pullY = _mm_mul_pd(pullY, inverse_distance_cubed);
+			pullZ = _mm_mul_pd(pullZ, inverse_distance_cubed);
+
+			accelerationX = _mm_sub_pd(accelerationX, _mm_mul_pd(sourceMass, pullX));
+			accelerationY = _mm_sub_pd(accelerationY, _mm_mul_pd(sourceMass, pullY));
+			accelerationZ = _mm_sub_pd(accelerationZ, _mm_mul_pd(sourceMass, pullZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm_add_pd(reactionX[i][block], _mm_mul_pd(mass, pullX));
+			reactionY[i][block] = _mm_add_pd(reactionY[i][block], _mm_mul_pd(mass, pullY));
+			reactionZ[i][block] = _mm_add_pd(reactionZ[i][block], _mm_mul_pd(mass, pullZ));
+		}
+
+		const __m128d vx = _mm_add_pd(_mm_loadu_pd(asteroids->vx + j), _mm_mul_pd(accelerationX, kickStep));
+		const __m128d vy = _mm_add_pd(_mm_loadu_pd(asteroids->vy + j), _mm_mul_pd(accelerationY, kickStep));
+		const __m128d vz = _mm_add_pd(_mm_loadu_pd(asteroids->vz + j), _mm_mul_pd(accelerationZ, kickStep));
+
+		_mm_storeu_pd(asteroids->ax + j, accelerationX);
+		_mm_storeu_pd(asteroids->ay + j, accelerationY);
+		_mm_storeu_pd(asteroids->az + j, accelerationZ);
+		_mm_storeu_pd(asteroids->vx + j, vx);
+		_mm_storeu_pd(asteroids->vy + j, vy);
+		_mm_storeu_pd(asteroids->vz + j, vz);
+		_mm_storeu_pd(asteroids->x + j, _mm_add_pd(x, _mm_mul_pd(vx, driftStep)));
+		_mm_storeu_pd(asteroids->y + j, _mm_add_pd(y, _mm_mul_pd(vy, driftStep)));
+		_mm_storeu_pd(asteroids->z + j, _mm_add_pd(z, _mm_mul_pd(vz, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 2; block++)
+		{
+			_mm_storeu_pd(lanes[i][0] + block * 2, reactionX[i][block]);
+			_mm_storeu_pd(lanes[i][1] + block * 2, reactionY[i][block]);
+			_mm_storeu_pd(lanes[i][2] + block * 2, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsScalar<REACTING>(sources, sourcesNum, reactingNum, asteroids, begin, j, end, kick, drift, accumulate, lanes);
+	reduceReactionLanes(lanes, reactingNum, reactions);
+}
+
+template <bool REACTING>
+__attribute__((target("avx2")))
+static void gravityKernelAVX2(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d kickStep = _mm256_set1_pd(kick);
+	const __m256d driftStep = _mm256_set1_pd(drift);
+	__m256d reactionX[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 4];
+	__m256d reactionY[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 4];
+	__m256d reactionZ[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 4];
+	ReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 4; block++)
+		{
+			reactionX[i][block] = _mm256_setzero_pd();
+			reactionY[i][block] = _mm256_setzero_pd();
+			reactionZ[i][block] = _mm256_setzero_pd();
+		}
+	}
+
+	for (j = begin; j + 4 <= end; j += 4)
+	{
+		block = (j - begin) / 4 % (GRAVITY_REACTION_LANES / 4);
+		const __m256d x = _mm256_loadu_pd(asteroids->x + j);
+		const __m256d y = _mm256_loadu_pd(asteroids->y + j);
+		const __m256d z = _mm256_loadu_pd(asteroids->z + j);
+		const __m256d mass = _mm256_loadu_pd(asteroids->mass_GC + j);
+		__m256d accelerationX = (accumulate) ? _mm256_loadu_pd(asteroids->ax + j) : _mm256_setzero_pd();
+		__m256d accelerationY = (accumulate) ? _mm256_loadu_pd(asteroids->ay + j) : _mm256_setzero_pd();
+		__m256d accelerationZ = (accumulate) ? _mm256_loadu_pd(asteroids->az + j) : _mm256_setzero_pd();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m256d sourceMass = _mm256_set1_pd(sources[i].mass_GC);
+			__m256d pullX = _mm256_sub_pd(x, _mm256_set1_pd(sources[i].position.x));
+			__m256d pullY = _mm256_sub_pd(y, _mm256_set1_pd(sources[i].position.y));
+			__m256d pullZ = _mm256_sub_pd(z, _mm256_set1_pd(sources[i].position.z));
+
+			__m256d distance_squared = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(pullX, pullX), _mm256_mul_pd(pullY, pullY)), _mm256_mul_pd(pullZ, pullZ));
+			__m256d inverse_distance_cubed = _mm256_div_pd(one, _mm256_sqrt_pd(distance_squared));
+			inverse_distance_cubed = _mm256_mul_pd(_mm256_mul_pd(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			pullX = _mm256_mul_pd(pullX, inverse_distance_cubed);
+			pullY = _mm256_mul_pd(pullY, inverse_distance_cubed);
+			pullZ = _mm256_mul_pd(pullZ, inverse_distance_cubed);
+
+			accelerationX = _mm256_sub_pd(accelerationX, _mm256_mul_pd(sourceMass, pullX));
+			accelerationY = _mm256_sub_pd(accelerationY, _mm256_mul_pd(sourceMass, pullY));
+			accelerationZ = _mm256_sub_pd(accelerationZ, _mm256_mul_pd(sourceMass, pullZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm256_add_pd(reactionX[i][block], _mm256_mul_pd(mass, pullX));
+			reactionY[i][block] = _mm256_add_pd(reactionY[i][block], _mm256_mul_pd(mass, pullY));
+			reactionZ[i][block] = _mm256_add_pd(reactionZ[i][block], _mm256_mul_pd(mass, pullZ));
+		}
+
+		const __m256d vx = _mm256_add_pd(_mm256_loadu_pd(asteroids->vx + j), _mm256_mul_pd(accelerationX, kickStep));
+		const __m256d vy = _mm256_add_pd(_mm256_loadu_pd(asteroids->vy + j), _mm256_mul_pd(accelerationY, kickStep));
+		const __m256d vz = _mm256_add_pd(_mm256_loadu_pd(asteroids->vz + j), _mm256_mul_pd(accelerationZ, kickStep));
+
+		_mm256_storeu_pd(asteroids->ax + j, accelerationX);
+		_mm256_storeu_pd(asteroids->ay + j, accelerationY);
+		_mm256_storeu_pd(asteroids->az + j, accelerationZ);
+		_mm256_storeu_pd(asteroids->vx + j, vx);
+		_mm256_storeu_pd(asteroids->vy + j, vy);
+		_mm256_storeu_pd(asteroids->vz + j, vz);
+		_mm256_storeu_pd(asteroids->x + j, _mm256_add_pd(x, _mm256_mul_pd(vx, driftStep)));
+		_mm256_storeu_pd(asteroids->y + j, _mm256_add_pd(y, _mm256_mul_pd(vy, driftStep)));
+		_mm256_storeu_pd(asteroids->z + j, _mm256_add_pd(z, _mm256_mul_pd(vz, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 4; block++)
+		{
+			_mm256_storeu_pd(lanes[i][0] + block * 4, reactionX[i][block]);
+			_mm256_storeu_pd(lanes[i][1] + block * 4, reactionY[i][block]);
+			_mm256_storeu_pd(lanes[i][2] + block * 4, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsScalar<REACTING>(sources, sourcesNum, reactingNum, asteroids, begin, j, end, kick, drift, accumulate, lanes);
+	reduceReactionLanes(lanes, reactingNum, reactions);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 narrowSSE2(__m128d low, __m128d high)
+{
+	return _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+}
+
+__attribute__((target("sse2")))
+static inline __m128d widenLowSSE2(__m128 floats)
+{
+	return _mm_cvtps_pd(floats);
+}
+
+__attribute__((target("sse2")))
+static inline __m128d widenHighSSE2(__m128 floats)
+{
+	return _mm_cvtps_pd(_mm_movehl_ps(floats, floats));
+}
+
+template <bool REACTING>
+__attribute__((target("sse2")))
+static void gravityKernelMixedSSE2(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128d offsetScale = _mm_set1_pd(MIXED_OFFSET_SCALE);
+	const __m128d pullScale = _mm_set1_pd(MIXED_PULL_SCALE);
+	const __m128d kickStep = _mm_set1_pd(kick);
+	const __m128d driftStep = _mm_set1_pd(drift);
+	__m128 reactionX[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 4];
+	__m128 reactionY[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 4];
+	__m128 reactionZ[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 4];
+	MixedSource_t mixedSources[GRAVITY_SOURCES_MAX];
+	MixedReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	const vector3D_t anchor = packMixedSources(sources, sourcesNum, mixedSources);
+	const __m128d anchorX = _mm_set1_pd(anchor.x);
+	const __m128d anchorY = _mm_set1_pd(anchor.y);
+	const __m128d anchorZ = _mm_set1_pd(anchor.z);
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 4; block++)
+		{
+			reactionX[i][block] = _mm_setzero_ps();
+			reactionY[i][block] = _mm_setzero_ps();
+			reactionZ[i][block] = _mm_setzero_ps();
+		}
+	}
+
+	// Each float vector holds the asteroids of two double vectors, the low and the high one
+	for (j = begin; j + 4 <= end; j += 4)
+	{
+		block = (j - begin) / 4 % (MIXED_REACTION_LANES / 4);
+		const __m128d xLow = _mm_loadu_pd(asteroids->x + j);
+		const __m128d yLow = _mm_loadu_pd(asteroids->y + j);
+		const __m128d zLow = _mm_loadu_pd(asteroids->z + j);
+		const __m128d xHigh = _mm_loadu_pd(asteroids->x + j + 2);
+		const __m128d yHigh = _mm_loadu_pd(asteroids->y + j + 2);
+		const __m128d zHigh = _mm_loadu_pd(asteroids->z + j + 2);
+		const __m128 mass = narrowSSE2(_mm_mul_pd(_mm_loadu_pd(asteroids->mass_GC + j), pullScale),
+						_mm_mul_pd(_mm_loadu_pd(asteroids->mass_GC + j + 2), pullScale));
+		const __m128 anchorOffsetX = narrowSSE2(_mm_mul_pd(_mm_sub_pd(xLow, anchorX), offsetScale),
+						_mm_mul_pd(_mm_sub_pd(xHigh, anchorX), offsetScale));
+		const __m128 anchorOffsetY = narrowSSE2(_mm_mul_pd(_mm_sub_pd(yLow, anchorY), offsetScale),
+						_mm_mul_pd(_mm_sub_pd(yHigh, anchorY), offsetScale));
+		const __m128 anchorOffsetZ = narrowSSE2(_mm_mul_pd(_mm_sub_pd(zLow, anchorZ), offsetScale),
+						_mm_mul_pd(_mm_sub_pd(zHigh, anchorZ), offsetScale));
+		__m128 sumX = _mm_setzero_ps();
+		__m128 sumY = _mm_setzero_ps();
+		__m128 sumZ = _mm_setzero_ps();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m128 sourceMass = _mm_set1_ps(mixedSources[i].mass_GC);
+			__m128 offsetX = _mm_sub_ps(anchorOffsetX, _mm_set1_ps(mixedSources[i].offset[0]));
+			__m128 offsetY = _mm_sub_ps(anchorOffsetY, _mm_set1_ps(mixedSources[i].offset[1]));
+			__m128 offsetZ = _mm_sub_ps(anchorOffsetZ, _mm_set1_ps(mixedSources[i].offset[2]));
+
+			__m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ));
+			__m128 inverse_distance_cubed = _mm_div_ps(one, _mm_sqrt_ps(distance_squared));
+			inverse_distance_cubed = _mm_mul_ps(_mm_mul_ps(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			offsetX = _mm_mul_ps(offsetX, inverse_distance_cubed);
+			offsetY = _mm_mul_ps(offsetY, inverse_distance_cubed);
+			offsetZ = _mm_mul_ps(offsetZ, inverse_distance_cubed);
+
+			sumX = _mm_sub_ps(sumX, _mm_mul_ps(sourceMass, offsetX));
+			sumY = _mm_sub_ps(sumY, _mm_mul_ps(sourceMass, offsetY));
+			sumZ = _mm_sub_ps(sumZ, _mm_mul_ps(sourceMass, offsetZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm_add_ps(reactionX[i][block], _mm_mul_ps(mass, offsetX));
+			reactionY[i][block] = _mm_add_ps(reactionY[i][block], _mm_mul_ps(mass, offsetY));
+			reactionZ[i][block] = _mm_add_ps(reactionZ[i][block], _mm_mul_ps(mass, offsetZ));
+		}
+
+		__m128d accelerationXLow = (accumulate) ? _mm_loadu_pd(asteroids->ax + j) : _mm_setzero_pd();
+		__m128d accelerationYLow = (accumulate) ? _mm_loadu_pd(asteroids->ay + j) : _mm_setzero_pd();
+		__m128d accelerationZLow = (accumulate) ? _mm_loadu_pd(asteroids->az + j) : _mm_setzero_pd();
+		__m128d accelerationXHigh = (accumulate) ? _mm_loadu_pd(asteroids->ax + j + 2) : _mm_setzero_pd();
+		__m128d accelerationYHigh = (accumulate) ? _mm_loadu_pd(asteroids->ay + j + 2) : _mm_setzero_pd();
+		__m128d accelerationZHigh = (accumulate) ? _mm_loadu_pd(asteroids->az + j + 2) : _mm_setzero_pd();
+		accelerationXLow = _mm_add_pd(accelerationXLow, widenLowSSE2(sumX));
+		accelerationYLow = _mm_add_pd(accelerationYLow, widenLowSSE2(sumY));
+		accelerationZLow = _mm_add_pd(accelerationZLow, widenLowSSE2(sumZ));
+		accelerationXHigh = _mm_add_pd(accelerationXHigh, widenHighSSE2(sumX));
+		accelerationYHigh = _mm_add_pd(accelerationYHigh, widenHighSSE2(sumY));
+		accelerationZHigh = _mm_add_pd(accelerationZHigh, widenHighSSE2(sumZ));
+
+		const __m128d vxLow = _mm_add_pd(_mm_loadu_pd(asteroids->vx + j), _mm_mul_pd(accelerationXLow, kickStep));
+		const __m128d vyLow = _mm_add_pd(_mm_loadu_pd(asteroids->vy + j), _mm_mul_pd(accelerationYLow, kickStep));
+		const __m128d vzLow = _mm_add_pd(_mm_loadu_pd(asteroids->vz + j), _mm_mul_pd(accelerationZLow, kickStep));
+		const __m128d vxHigh = _mm_add_pd(_mm_loadu_pd(asteroids->vx + j + 2), _mm_mul_pd(accelerationXHigh, kickStep));
+		const __m128d vyHigh = _mm_add_pd(_mm_loadu_pd(asteroids->vy + j + 2), _mm_mul_pd(accelerationYHigh, kickStep));
+		const __m128d vzHigh = _mm_add_pd(_mm_loadu_pd(asteroids->vz + j + 2), _mm_mul_pd(accelerationZHigh, kickStep));
+
+		_mm_storeu_pd(asteroids->ax + j, accelerationXLow);
+		_mm_storeu_pd(asteroids->ay + j, accelerationYLow);
+		_mm_storeu_pd(asteroids->az + j, accelerationZLow);
+		_mm_storeu_pd(asteroids->ax + j + 2, accelerationXHigh);
+		_mm_storeu_pd(asteroids->ay + j + 2, accelerationYHigh);
+		_mm_storeu_pd(asteroids->az + j + 2, accelerationZHigh);
+		_mm_storeu_pd(asteroids->vx + j, vxLow);
+		_mm_storeu_pd(asteroids->vy + j, vyLow);
+		_mm_storeu_pd(asteroids->vz + j, vzLow);
+		_mm_storeu_pd(asteroids->vx + j + 2, vxHigh);
+		_mm_storeu_pd(asteroids->vy + j + 2, vyHigh);
+		_mm_storeu_pd(asteroids->vz + j + 2, vzHigh);
+		_mm_storeu_pd(asteroids->x + j, _mm_add_pd(xLow, _mm_mul_pd(vxLow, driftStep)));
+		_mm_storeu_pd(asteroids->y + j, _mm_add_pd(yLow, _mm_mul_pd(vyLow, driftStep)));
+		_mm_storeu_pd(asteroids->z + j, _mm_add_pd(zLow, _mm_mul_pd(vzLow, driftStep)));
+		_mm_storeu_pd(asteroids->x + j + 2, _mm_add_pd(xHigh, _mm_mul_pd(vxHigh, driftStep)));
+		_mm_storeu_pd(asteroids->y + j + 2, _mm_add_pd(yHigh, _mm_mul_pd(vyHigh, driftStep)));
+		_mm_storeu_pd(asteroids->z + j + 2, _mm_add_pd(zHigh, _mm_mul_pd(vzHigh, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 4; block++)
+		{
+			_mm_storeu_ps(lanes[i][0] + block * 4, reactionX[i][block]);
+			_mm_storeu_ps(lanes[i][1] + block * 4, reactionY[i][block]);
+			_mm_storeu_ps(lanes[i][2] + block * 4, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsMixedScalar<REACTING>(anchor, mixedSources, sourcesNum, reactingNum, asteroids, begin, j, end,
+				kick, drift, accumulate, lanes);
+	reduceMixedReactionLanes(lanes, reactingNum, reactions);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 narrowAVX2(__m256d low, __m256d high)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(low)), _mm256_cvtpd_ps(high), 1);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d widenLowAVX2(__m256 floats)
+{
+	return _mm256_cvtps_pd(_mm256_castps256_ps128(floats));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d widenHighAVX2(__m256 floats)
+{
+	return _mm256_cvtps_pd(_mm256_extractf128_ps(floats, 1));
+}
+
+template <bool REACTING>
+__attribute__((target("avx2")))
+static void gravityKernelMixedAVX2(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256d offsetScale = _mm256_set1_pd(MIXED_OFFSET_SCALE);
+	const __m256d pullScale = _mm256_set1_pd(MIXED_PULL_SCALE);
+	const __m256d kickStep = _mm256_set1_pd(kick);
+	const __m256d driftStep = _mm256_set1_pd(drift);
+	__m256 reactionX[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 8];
+	__m256 reactionY[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 8];
+	__m256 reactionZ[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 8];
+	MixedSource_t mixedSources[GRAVITY_SOURCES_MAX];
+	MixedReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	const vector3D_t anchor = packMixedSources(sources, sourcesNum, mixedSources);
+	const __m256d anchorX = _mm256_set1_pd(anchor.x);
+	const __m256d anchorY = _mm256_set1_pd(anchor.y);
+	const __m256d anchorZ = _mm256_set1_pd(anchor.z);
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 8; block++)
+		{
+			reactionX[i][block] = _mm256_setzero_ps();
+			reactionY[i][block] = _mm256_setzero_ps();
+			reactionZ[i][block] = _mm256_setzero_ps();
+		}
+	}
+
+	// Each float vector holds the asteroids of two double vectors, the low and the high one
+	for (j = begin; j + 8 <= end; j += 8)
+	{
+		block = (j - begin) / 8 % (MIXED_REACTION_LANES / 8);
+		const __m256d xLow = _mm256_loadu_pd(asteroids->x + j);
+		const __m256d yLow = _mm256_loadu_pd(asteroids->y + j);
+		const __m256d zLow = _mm256_loadu_pd(asteroids->z + j);
+		const __m256d xHigh = _mm256_loadu_pd(asteroids->x + j + 4);
+		const __m256d yHigh = _mm256_loadu_pd(asteroids->y + j + 4);
+		const __m256d zHigh = _mm256_loadu_pd(asteroids->z + j + 4);
+		const __m256 mass = narrowAVX2(_mm256_mul_pd(_mm256_loadu_pd(asteroids->mass_GC + j), pullScale),
+						_mm256_mul_pd(_mm256_loadu_pd(asteroids->mass_GC + j + 4), pullScale));
+		const __m256 anchorOffsetX = narrowAVX2(_mm256_mul_pd(_mm256_sub_pd(xLow, anchorX), offsetScale),
+						_mm256_mul_pd(_mm256_sub_pd(xHigh, anchorX), offsetScale));
+		const __m256 anchorOffsetY = narrowAVX2(_mm256_mul_pd(_mm256_sub_pd(yLow, anchorY), offsetScale),
+						_mm256_mul_pd(_mm256_sub_pd(yHigh, anchorY), offsetScale));
+		const __m256 anchorOffsetZ = narrowAVX2(_mm256_mul_pd(_mm256_sub_pd(zLow, anchorZ), offsetScale),
+						_mm256_mul_pd(_mm256_sub_pd(zHigh, anchorZ), offsetScale));
+		__m256 sumX = _mm256_setzero_ps();
+		__m256 sumY = _mm256_setzero_ps();
+		__m256 sumZ = _mm256_setzero_ps();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m256 sourceMass = _mm256_set1_ps(mixedSources[i].mass_GC);
+			__m256 offsetX = _mm256_sub_ps(anchorOffsetX, _mm256_set1_ps(mixedSources[i].offset[0]));
+			__m256 offsetY = _mm256_sub_ps(anchorOffsetY, _mm256_set1_ps(mixedSources[i].offset[1]));
+			__m256 offsetZ = _mm256_sub_ps(anchorOffsetZ, _mm256_set1_ps(mixedSources[i].offset[2]));
+
+			__m256 distance_squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), _mm256_mul_ps(offsetY, offsetY)), _mm256_mul_ps(offsetZ, offsetZ));
+			__m256 inverse_distance_cubed = _mm256_div_ps(one, _mm256_sqrt_ps(distance_squared));
+			inverse_distance_cubed = _mm256_mul_ps(_mm256_mul_ps(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			offsetX = _mm256_mul_ps(offsetX, inverse_distance_cubed);
+			offsetY = _mm256_mul_ps(offsetY, inverse_distance_cubed);
+			offsetZ = _mm256_mul_ps(offsetZ, inverse_distance_cubed);
+
+			sumX = _mm256_sub_ps(sumX, _mm256_mul_ps(sourceMass, offsetX));
+			sumY = _mm256_sub_ps(sumY, _mm256_mul_ps(sourceMass, offsetY));
+			sumZ = _mm256_sub_ps(sumZ, _mm256_mul_ps(sourceMass, offsetZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm256_add_ps(reactionX[i][block], _mm256_mul_ps(mass, offsetX));
+			reactionY[i][block] = _mm256_add_ps(reactionY[i][block], _mm256_mul_ps(mass, offsetY));
+			reactionZ[i][block] = _mm256_add_ps(reactionZ[i][block], _mm256_mul_ps(mass, offsetZ));
+		}
+
+		__m256d accelerationXLow = (accumulate) ? _mm256_loadu_pd(asteroids->ax + j) : _mm256_setzero_pd();
+		__m256d accelerationYLow = (accumulate) ? _mm256_loadu_pd(asteroids->ay + j) : _mm256_setzero_pd();
+		__m256d accelerationZLow = (accumulate) ? _mm256_loadu_pd(asteroids->az + j) : _mm256_setzero_pd();
+		__m256d accelerationXHigh = (accumulate) ? _mm256_loadu_pd(asteroids->ax + j + 4) : _mm256_setzero_pd();
+		__m256d accelerationYHigh = (accumulate) ? _mm256_loadu_pd(asteroids->ay + j + 4) : _mm256_setzero_pd();
+		__m256d accelerationZHigh = (accumulate) ? _mm256_loadu_pd(asteroids->az + j + 4) : _mm256_setzero_pd();
+		accelerationXLow = _mm256_add_pd(accelerationXLow, widenLowAVX2(sumX));
+		accelerationYLow = _mm256_add_pd(accelerationYLow, widenLowAVX2(sumY));
+		accelerationZLow = _mm256_add_pd(accelerationZLow, widenLowAVX2(sumZ));
+		accelerationXHigh = _mm256_add_pd(accelerationXHigh, widenHighAVX2(sumX));
+		accelerationYHigh = _mm256_add_pd(accelerationYHigh, widenHighAVX2(sumY));
+		accelerationZHigh = _mm256_add_pd(accelerationZHigh, widenHighAVX2(sumZ));
+
+		const __m256d vxLow = _mm256_add_pd(_mm256_loadu_pd(asteroids->vx + j), _mm256_mul_pd(accelerationXLow, kickStep));
+		const __m256d vyLow = _mm256_add_pd(_mm256_loadu_pd(asteroids->vy + j), _mm256_mul_pd(accelerationYLow, kickStep));
+		const __m256d vzLow = _mm256_add_pd(_mm256_loadu_pd(asteroids->vz + j), _mm256_mul_pd(accelerationZLow, kickStep));
+		const __m256d vxHigh = _mm256_add_pd(_mm256_loadu_pd(asteroids->vx + j + 4), _mm256_mul_pd(accelerationXHigh, kickStep));
+		const __m256d vyHigh = _mm256_add_pd(_mm256_loadu_pd(asteroids->vy + j + 4), _mm256_mul_pd(accelerationYHigh, kickStep));
+		const __m256d vzHigh = _mm256_add_pd(_mm256_loadu_pd(asteroids->vz + j + 4), _mm256_mul_pd(accelerationZHigh, kickStep));
+
+		_mm256_storeu_pd(asteroids->ax + j, accelerationXLow);
+		_mm256_storeu_pd(asteroids->ay + j, accelerationYLow);
+		_mm256_storeu_pd(asteroids->az + j, accelerationZLow);
+		_mm256_storeu_pd(asteroids->ax + j + 4, accelerationXHigh);
+		_mm256_storeu_pd(asteroids->ay + j + 4, accelerationYHigh);
+		_mm256_storeu_pd(asteroids->az + j + 4, accelerationZHigh);
+		_mm256_storeu_pd(asteroids->vx + j, vxLow);
+		_mm256_storeu_pd(asteroids->vy + j, vyLow);
+		_mm256_storeu_pd(asteroids->vz + j, vzLow);
+		_mm256_storeu_pd(asteroids->vx + j + 4, vxHigh);
+		_mm256_storeu_pd(asteroids->vy + j + 4, vyHigh);
+		_mm256_storeu_pd(asteroids->vz + j + 4, vzHigh);
+		_mm256_storeu_pd(asteroids->x + j, _mm256_add_pd(xLow, _mm256_mul_pd(vxLow, driftStep)));
+		_mm256_storeu_pd(asteroids->y + j, _mm256_add_pd(yLow, _mm256_mul_pd(vyLow, driftStep)));
+		_mm256_storeu_pd(asteroids->z + j, _mm256_add_pd(zLow, _mm256_mul_pd(vzLow, driftStep)));
+		_mm256_storeu_pd(asteroids->x + j + 4, _mm256_add_pd(xHigh, _mm256_mul_pd(vxHigh, driftStep)));
+		_mm256_storeu_pd(asteroids->y + j + 4, _mm256_add_pd(yHigh, _mm256_mul_pd(vyHigh, driftStep)));
+		_mm256_storeu_pd(asteroids->z + j + 4, _mm256_add_pd(zHigh, _mm256_mul_pd(vzHigh, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 8; block++)
+		{
+			_mm256_storeu_ps(lanes[i][0] + block * 8, reactionX[i][block]);
+			_mm256_storeu_ps(lanes[i][1] + block * 8, reactionY[i][block]);
+			_mm256_storeu_ps(lanes[i][2] + block * 8, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsMixedScalar<REACTING>(anchor, mixedSources, sourcesNum, reactingNum, asteroids, begin, j, end,
+				kick, drift, accumulate, lanes);
+	reduceMixedReactionLanes(lanes, reactingNum, reactions);
+}
+
+// GCC's AVX-512 headers seed some intrinsics with _mm512_undefined_pd()
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+template <bool REACTING>
+__attribute__((target("avx512f")))
+static void gravityKernelAVX512(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __m512d kickStep = _mm512_set1_pd(kick);
+	const __m512d driftStep = _mm512_set1_pd(drift);
+	__m512d reactionX[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 8];
+	__m512d reactionY[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 8];
+	__m512d reactionZ[GRAVITY_SOURCES_MAX][GRAVITY_REACTION_LANES / 8];
+	ReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 8; block++)
+		{
+			reactionX[i][block] = _mm512_setzero_pd();
+			reactionY[i][block] = _mm512_setzero_pd();
+			reactionZ[i][block] = _mm512_setzero_pd();
+		}
+	}
+
+	for (j = begin; j + 8 <= end; j += 8)
+	{
+		block = (j - begin) / 8 % (GRAVITY_REACTION_LANES / 8);
+		const __m512d x = _mm512_loadu_pd(asteroids->x + j);
+		const __m512d y = _mm512_loadu_pd(asteroids->y + j);
+		const __m512d z = _mm512_loadu_pd(asteroids->z + j);
+		const __m512d mass = _mm512_loadu_pd(asteroids->mass_GC + j);
+		__m512d accelerationX = (accumulate) ? _mm512_loadu_pd(asteroids->ax + j) : _mm512_setzero_pd();
+		__m512d accelerationY = (accumulate) ? _mm512_loadu_pd(asteroids->ay + j) : _mm512_setzero_pd();
+		__m512d accelerationZ = (accumulate) ? _mm512_loadu_pd(asteroids->az + j) : _mm512_setzero_pd();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m512d sourceMass = _mm512_set1_pd(sources[i].mass_GC);
+			__m512d pullX = _mm512_sub_pd(x, _mm512_set1_pd(sources[i].position.x));
+			__m512d pullY = _mm512_sub_pd(y, _mm512_set1_pd(sources[i].position.y));
+			__m512d pullZ = _mm512_sub_pd(z, _mm512_set1_pd(sources[i].position.z));
+
+			__m512d distance_squared = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(pullX, pullX), _mm512_mul_pd(pullY, pullY)), _mm512_mul_pd(pullZ, pullZ));
+			__m512d inverse_distance_cubed = _mm512_div_pd(one, _mm512_sqrt_pd(distance_squared));
+			inverse_distance_cubed = _mm512_mul_pd(_mm512_mul_pd(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			pullX = _mm512_mul_pd(pullX, inverse_distance_cubed);
+			pullY = _mm512_mul_pd(pullY, inverse_distance_cubed);
+			pullZ = _mm512_mul_pd(pullZ, inverse_distance_cubed);
+
+			accelerationX = _mm512_sub_pd(accelerationX, _mm512_mul_pd(sourceMass, pullX));
+			accelerationY = _mm512_sub_pd(accelerationY, _mm512_mul_pd(sourceMass, pullY));
+			accelerationZ = _mm512_sub_pd(accelerationZ, _mm512_mul_pd(sourceMass, pullZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm512_add_pd(reactionX[i][block], _mm512_mul_pd(mass, pullX));
+			reactionY[i][block] = _mm512_add_pd(reactionY[i][block], _mm512_mul_pd(mass, pullY));
+			reactionZ[i][block] = _mm512_add_pd(reactionZ[i][block], _mm512_mul_pd(mass, pullZ));
+		}
+
+		const __m512d vx = _mm512_add_pd(_mm512_loadu_pd(asteroids->vx + j), _mm512_mul_pd(accelerationX, kickStep));
+		const __m512d vy = _mm512_add_pd(_mm512_loadu_pd(asteroids->vy + j), _mm512_mul_pd(accelerationY, kickStep));
+		const __m512d vz = _mm512_add_pd(_mm512_loadu_pd(asteroids->vz + j), _mm512_mul_pd(accelerationZ, kickStep));
+
+		_mm512_storeu_pd(asteroids->ax + j, accelerationX);
+		_mm512_storeu_pd(asteroids->ay + j, accelerationY);
+		_mm512_storeu_pd(asteroids->az + j, accelerationZ);
+		_mm512_storeu_pd(asteroids->vx + j, vx);
+		_mm512_storeu_pd(asteroids->vy + j, vy);
+		_mm512_storeu_pd(asteroids->vz + j, vz);
+		_mm512_storeu_pd(asteroids->x + j, _mm512_add_pd(x, _mm512_mul_pd(vx, driftStep)));
+		_mm512_storeu_pd(asteroids->y + j, _mm512_add_pd(y, _mm512_mul_pd(vy, driftStep)));
+		_mm512_storeu_pd(asteroids->z + j, _mm512_add_pd(z, _mm512_mul_pd(vz, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < GRAVITY_REACTION_LANES / 8; block++)
+		{
+			_mm512_storeu_pd(lanes[i][0] + block * 8, reactionX[i][block]);
+			_mm512_storeu_pd(lanes[i][1] + block * 8, reactionY[i][block]);
+			_mm512_storeu_pd(lanes[i][2] + block * 8, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsScalar<REACTING>(sources, sourcesNum, reactingNum, asteroids, begin, j, end, kick, drift, accumulate, lanes);
+	reduceReactionLanes(lanes, reactingNum, reactions);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 narrowAVX512(__m512d low, __m512d high)
+{
+	return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(low))),
+				_mm256_castps_pd(_mm512_cvtpd_ps(high)), 1));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d widenLowAVX512(__m512 floats)
+{
+	return _mm512_cvtps_pd(_mm512_castps512_ps256(floats));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d widenHighAVX512(__m512 floats)
+{
+	return _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(floats), 1)));
+}
+
+template <bool REACTING>
+__attribute__((target("avx512f")))
+static void gravityKernelMixedAVX512(GRAVITY_KERNEL_PARAMETERS)
+{
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512d offsetScale = _mm512_set1_pd(MIXED_OFFSET_SCALE);
+	const __m512d pullScale = _mm512_set1_pd(MIXED_PULL_SCALE);
+	const __m512d kickStep = _mm512_set1_pd(kick);
+	const __m512d driftStep = _mm512_set1_pd(drift);
+	__m512 reactionX[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 16];
+	__m512 reactionY[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 16];
+	__m512 reactionZ[GRAVITY_SOURCES_MAX][MIXED_REACTION_LANES / 16];
+	MixedSource_t mixedSources[GRAVITY_SOURCES_MAX];
+	MixedReactionLanes_t lanes[GRAVITY_SOURCES_MAX];
+	unsigned int i, j, block;
+
+	const vector3D_t anchor = packMixedSources(sources, sourcesNum, mixedSources);
+	const __m512d anchorX = _mm512_set1_pd(anchor.x);
+	const __m512d anchorY = _mm512_set1_pd(anchor.y);
+	const __m512d anchorZ = _mm512_set1_pd(anchor.z);
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 16; block++)
+		{
+			reactionX[i][block] = _mm512_setzero_ps();
+			reactionY[i][block] = _mm512_setzero_ps();
+			reactionZ[i][block] = _mm512_setzero_ps();
+		}
+	}
+
+	// Each float vector holds the asteroids of two double vectors, the low and the high one
+	for (j = begin; j + 16 <= end; j += 16)
+	{
+		block = (j - begin) / 16 % (MIXED_REACTION_LANES / 16);
+		const __m512d xLow = _mm512_loadu_pd(asteroids->x + j);
+		const __m512d yLow = _mm512_loadu_pd(asteroids->y + j);
+		const __m512d zLow = _mm512_loadu_pd(asteroids->z + j);
+		const __m512d xHigh = _mm512_loadu_pd(asteroids->x + j + 8);
+		const __m512d yHigh = _mm512_loadu_pd(asteroids->y + j + 8);
+		const __m512d zHigh = _mm512_loadu_pd(asteroids->z + j + 8);
+		const __m512 mass = narrowAVX512(_mm512_mul_pd(_mm512_loadu_pd(asteroids->mass_GC + j), pullScale),
+						_mm512_mul_pd(_mm512_loadu_pd(asteroids->mass_GC + j + 8), pullScale));
+		const __m512 anchorOffsetX = narrowAVX512(_mm512_mul_pd(_mm512_sub_pd(xLow, anchorX), offsetScale),
+						_mm512_mul_pd(_mm512_sub_pd(xHigh, anchorX), offsetScale));
+		const __m512 anchorOffsetY = narrowAVX512(_mm512_mul_pd(_mm512_sub_pd(yLow, anchorY), offsetScale),
+						_mm512_mul_pd(_mm512_sub_pd(yHigh, anchorY), offsetScale));
+		const __m512 anchorOffsetZ = narrowAVX512(_mm512_mul_pd(_mm512_sub_pd(zLow, anchorZ), offsetScale),
+						_mm512_mul_pd(_mm512_sub_pd(zHigh, anchorZ), offsetScale));
+		__m512 sumX = _mm512_setzero_ps();
+		__m512 sumY = _mm512_setzero_ps();
+		__m512 sumZ = _mm512_setzero_ps();
+
+		for (i = 0; i < sourcesNum; i++)
+		{
+			const __m512 sourceMass = _mm512_set1_ps(mixedSources[i].mass_GC);
+			__m512 offsetX = _mm512_sub_ps(anchorOffsetX, _mm512_set1_ps(mixedSources[i].offset[0]));
+			__m512 offsetY = _mm512_sub_ps(anchorOffsetY, _mm512_set1_ps(mixedSources[i].offset[1]));
+			__m512 offsetZ = _mm512_sub_ps(anchorOffsetZ, _mm512_set1_ps(mixedSources[i].offset[2]));
+
+			__m512 distance_squared = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(offsetX, offsetX), _mm512_mul_ps(offsetY, offsetY)), _mm512_mul_ps(offsetZ, offsetZ));
+			__m512 inverse_distance_cubed = _mm512_div_ps(one, _mm512_sqrt_ps(distance_squared));
+			inverse_distance_cubed = _mm512_mul_ps(_mm512_mul_ps(inverse_distance_cubed, inverse_distance_cubed), inverse_distance_cubed);
+
+			offsetX = _mm512_mul_ps(offsetX, inverse_distance_cubed);
+			offsetY = _mm512_mul_ps(offsetY, inverse_distance_cubed);
+			offsetZ = _mm512_mul_ps(offsetZ, inverse_distance_cubed);
+
+			sumX = _mm512_sub_ps(sumX, _mm512_mul_ps(sourceMass, offsetX));
+			sumY = _mm512_sub_ps(sumY, _mm512_mul_ps(sourceMass, offsetY));
+			sumZ = _mm512_sub_ps(sumZ, _mm512_mul_ps(sourceMass, offsetZ));
+
+			if (!REACTING || i >= reactingNum)
+				continue;
+			reactionX[i][block] = _mm512_add_ps(reactionX[i][block], _mm512_mul_ps(mass, offsetX));
+			reactionY[i][block] = _mm512_add_ps(reactionY[i][block], _mm512_mul_ps(mass, offsetY));
+			reactionZ[i][block] = _mm512_add_ps(reactionZ[i][block], _mm512_mul_ps(mass, offsetZ));
+		}
+
+		__m512d accelerationXLow = (accumulate) ? _mm512_loadu_pd(asteroids->ax + j) : _mm512_setzero_pd();
+		__m512d accelerationYLow = (accumulate) ? _mm512_loadu_pd(asteroids->ay + j) : _mm512_setzero_pd();
+		__m512d accelerationZLow = (accumulate) ? _mm512_loadu_pd(asteroids->az + j) : _mm512_setzero_pd();
+		__m512d accelerationXHigh = (accumulate) ? _mm512_loadu_pd(asteroids->ax + j + 8) : _mm512_setzero_pd();
+		__m512d accelerationYHigh = (accumulate) ? _mm512_loadu_pd(asteroids->ay + j + 8) : _mm512_setzero_pd();
+		__m512d accelerationZHigh = (accumulate) ? _mm512_loadu_pd(asteroids->az + j + 8) : _mm512_setzero_pd();
+		accelerationXLow = _mm512_add_pd(accelerationXLow, widenLowAVX512(sumX));
+		accelerationYLow = _mm512_add_pd(accelerationYLow, widenLowAVX512(sumY));
+		accelerationZLow = _mm512_add_pd(accelerationZLow, widenLowAVX512(sumZ));
+		accelerationXHigh = _mm512_add_pd(accelerationXHigh, widenHighAVX512(sumX));
+		accelerationYHigh = _mm512_add_pd(accelerationYHigh, widenHighAVX512(sumY));
+		accelerationZHigh = _mm512_add_pd(accelerationZHigh, widenHighAVX512(sumZ));
+
+		const __m512d vxLow = _mm512_add_pd(_mm512_loadu_pd(asteroids->vx + j), _mm512_mul_pd(accelerationXLow, kickStep));
+		const __m512d vyLow = _mm512_add_pd(_mm512_loadu_pd(asteroids->vy + j), _mm512_mul_pd(accelerationYLow, kickStep));
+		const __m512d vzLow = _mm512_add_pd(_mm512_loadu_pd(asteroids->vz + j), _mm512_mul_pd(accelerationZLow, kickStep));
+		const __m512d vxHigh = _mm512_add_pd(_mm512_loadu_pd(asteroids->vx + j + 8), _mm512_mul_pd(accelerationXHigh, kickStep));
+		const __m512d vyHigh = _mm512_add_pd(_mm512_loadu_pd(asteroids->vy + j + 8), _mm512_mul_pd(accelerationYHigh, kickStep));
+		const __m512d vzHigh = _mm512_add_pd(_mm512_loadu_pd(asteroids->vz + j + 8), _mm512_mul_pd(accelerationZHigh, kickStep));
+
+		_mm512_storeu_pd(asteroids->ax + j, accelerationXLow);
+		_mm512_storeu_pd(asteroids->ay + j, accelerationYLow);
+		_mm512_storeu_pd(asteroids->az + j, accelerationZLow);
+		_mm512_storeu_pd(asteroids->ax + j + 8, accelerationXHigh);
+		_mm512_storeu_pd(asteroids->ay + j + 8, accelerationYHigh);
+		_mm512_storeu_pd(asteroids->az + j + 8, accelerationZHigh);
+		_mm512_storeu_pd(asteroids->vx + j, vxLow);
+		_mm512_storeu_pd(asteroids->vy + j, vyLow);
+		_mm512_storeu_pd(asteroids->vz + j, vzLow);
+		_mm512_storeu_pd(asteroids->vx + j + 8, vxHigh);
+		_mm512_storeu_pd(asteroids->vy + j + 8, vyHigh);
+		_mm512_storeu_pd(asteroids->vz + j + 8, vzHigh);
+		_mm512_storeu_pd(asteroids->x + j, _mm512_add_pd(xLow, _mm512_mul_pd(vxLow, driftStep)));
+		_mm512_storeu_pd(asteroids->y + j, _mm512_add_pd(yLow, _mm512_mul_pd(vyLow, driftStep)));
+		_mm512_storeu_pd(asteroids->z + j, _mm512_add_pd(zLow, _mm512_mul_pd(vzLow, driftStep)));
+		_mm512_storeu_pd(asteroids->x + j + 8, _mm512_add_pd(xHigh, _mm512_mul_pd(vxHigh, driftStep)));
+		_mm512_storeu_pd(asteroids->y + j + 8, _mm512_add_pd(yHigh, _mm512_mul_pd(vyHigh, driftStep)));
+		_mm512_storeu_pd(asteroids->z + j + 8, _mm512_add_pd(zHigh, _mm512_mul_pd(vzHigh, driftStep)));
+	}
+
+	for (i = 0; i < reactingNum; i++)
+	{
+		for (block = 0; block < MIXED_REACTION_LANES / 16; block++)
+		{
+			_mm512_storeu_ps(lanes[i][0] + block * 16, reactionX[i][block]);
+			_mm512_storeu_ps(lanes[i][1] + block * 16, reactionY[i][block]);
+			_mm512_storeu_ps(lanes[i][2] + block * 16, reactionZ[i][block]);
+		}
+	}
+
+	sweepAsteroidsMixedScalar<REACTING>(anchor, mixedSources, sourcesNum, reactingNum, asteroids, begin, j, end,
+				kick, drift, accumulate, lanes);
+	reduceMixedReactionLanes(lanes, reactingNum, reactions);
+}
+
+#pragma GCC diagnostic pop
+
+#endif
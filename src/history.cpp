@@ -0,0 +1,311 @@
+/**
+ * @brief Rewind history of the orbital simulation
+ *
+ * The keyframes live in a ring, keyframe k (taken at update k * interval) in
+ * slot k % keyframesMax, and each slot is allocated the first time it is used.
+ * Keyframes only hold what survives from one update to the next: everything
+ * else (block levels, absorbed flags, trees) is rebuilt by every update.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "history.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HISTORY_ARRAYS_AMOUNT 10
+
+/**
+ * @brief State of the simulation at the start of an update.
+ */
+typedef struct
+{
+	double timeElapsed;		// In seconds
+	double dt;			// Of every update up to the next keyframe
+	double kick;
+	double drift;
+	double asteroidsKick;
+	double asteroidsDrift;
+	int accelerationsValid;
+	unsigned int activeChunks;
+	unsigned int bodyNum;
+	unsigned int asteroidsNum;
+	unsigned int asteroidsOrder;
+	unsigned long long interactionsNum;
+	EphemeridesBody_t SpaceShip;
+	BlackHole_t BlackHole;
+	EphemeridesBody_t* PlanetarySystem;	// NULL while the slot is not allocated
+	BodyArrays_t* Asteroids;
+	vector3D_t* asteroidsReactions;
+	unsigned int* asteroidsIds;
+	unsigned char* engines;		// spaceShipEngines of each update after the keyframe
+} Keyframe_t;
+
+struct History
+{
+	unsigned int interval;
+	unsigned int bodyCapacity;
+	unsigned int asteroidsCapacity;
+	unsigned int reactionsCapacity;
+	unsigned int keyframesMax;
+	Keyframe_t* keyframes;
+	unsigned long long first;		// Index of the oldest keyframe kept
+	unsigned long long keyframesNum;	// Keyframes kept, the newest one is first + keyframesNum - 1
+	unsigned long long step;		// Updates since the history started
+};
+
+/**
+ * @brief Keeps the current state as the keyframe of the current step,
+ *		dropping the oldest keyframe if the budget is used up.
+ *
+ * @param history Pointer to the history.
+ * @param sim Pointer to the simulation.
+ */
+static void keepKeyframe(History_t* history, const OrbitalSim_t* sim);
+
+/**
+ * @brief Allocates a keyframe.
+ *
+ * @param history Pointer to the history.
+ * @param keyframe Pointer to the keyframe.
+ *
+ * @return 1 if it was allocated, 0 if not (what it got is freed).
+ */
+static int allocateKeyframe(const History_t* history, Keyframe_t* keyframe);
+
+/**
+ * @brief Frees a keyframe, allocated or not.
+ *
+ * @param keyframe Pointer to the keyframe.
+ */
+static void freeKeyframe(Keyframe_t* keyframe);
+
+/**
+ * @brief Copies the asteroids between arrays.
+ *
+ * @param destination The arrays copied into.
+ * @param source The arrays copied from.
+ * @param asteroidsNum The amount of asteroids.
+ */
+static void copyAsteroids(BodyArrays_t* destination, const BodyArrays_t* source, unsigned int asteroidsNum);
+
+History_t* constructHistory(const OrbitalSim_t* sim, unsigned int interval, size_t budget)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned int bodyCapacity = (sim->bodyNum) ? sim->bodyNum : 1;
+	interval = (interval) ? interval : 1;
+
+	// The asteroid arrays also round up to the alignment
+	size_t keyframeSize = sizeof(Keyframe_t) + sizeof(EphemeridesBody_t) * bodyCapacity +
+				sizeof(double) * HISTORY_ARRAYS_AMOUNT * sim->asteroidsNum + BODY_ARRAYS_ALIGNMENT * HISTORY_ARRAYS_AMOUNT +
+				sizeof(vector3D_t) * chunksNum * sim->bodyNum + sizeof(unsigned int) * sim->asteroidsNum + interval;
+	size_t keyframesMax = budget / keyframeSize;
+	if (!keyframesMax)
+		return NULL;
+
+	History_t* history = new History_t;
+	if (!history)
+		return NULL;
+
+	history->interval = interval;
+	history->bodyCapacity = bodyCapacity;
+	history->asteroidsCapacity = sim->asteroidsNum;
+	history->reactionsCapacity = chunksNum * sim->bodyNum;
+	history->keyframesMax = (keyframesMax < 0xFFFFFFFFU) ? (unsigned int)keyframesMax : 0xFFFFFFFFU;
+	history->first = 0;
+	history->keyframesNum = 0;
+	history->step = 0;
+
+	// Zeroed, so every slot starts not allocated
+	history->keyframes = (Keyframe_t*) calloc(history->keyframesMax, sizeof(Keyframe_t));
+	if (!history->keyframes)
+	{
+		delete history;
+		return NULL;
+	}
+
+	return history;
+}
+
+void destroyHistory(History_t* history)
+{
+	if (!history)
+		return;
+
+	for (unsigned int i = 0; i < history->keyframesMax; i++)
+		freeKeyframe(&history->keyframes[i]);
+	free(history->keyframes);
+	delete history;
+}
+
+void updateOrbitalSimHistory(History_t* history, OrbitalSim_t* sim, int spawnBH)
+{
+	unsigned int offset = history->step % history->interval;
+
+	if (!offset)
+		keepKeyframe(history, sim);
+
+	// Without a keyframe before it (it could not be allocated) the update is not kept
+	if (history->keyframesNum && history->first + history->keyframesNum - 1 == history->step / history->interval)
+	{
+		Keyframe_t* keyframe = &history->keyframes[(history->step / history->interval) % history->keyframesMax];
+		keyframe->engines[offset] = (unsigned char) sim->spaceShipEngines;
+	}
+
+	updateOrbitalSim(sim, spawnBH);
+	history->step++;
+}
+
+int isHistoryAtKeyframe(const History_t* history)
+{
+	return !(history->step % history->interval);
+}
+
+unsigned long long rewindOrbitalSimHistory(History_t* history, OrbitalSim_t* sim, int spawnBH, unsigned long long steps)
+{
+	if (!history->keyframesNum)
+		return 0;
+
+	unsigned long long oldest = history->first * history->interval;
+	unsigned long long target = (history->step - oldest > steps) ? history->step - steps : oldest;
+	if (target == history->step)
+		return 0;
+
+	unsigned long long index = target / history->interval;
+	const Keyframe_t* keyframe = &history->keyframes[index % history->keyframesMax];
+
+	sim->timeElapsed = keyframe->timeElapsed;
+	sim->dt = keyframe->dt;
+	sim->kick = keyframe->kick;
+	sim->drift = keyframe->drift;
+	sim->asteroidsKick = keyframe->asteroidsKick;
+	sim->asteroidsDrift = keyframe->asteroidsDrift;
+	sim->accelerationsValid = keyframe->accelerationsValid;
+	sim->activeChunks = keyframe->activeChunks;
+	sim->bodyNum = keyframe->bodyNum;
+	sim->asteroidsNum = keyframe->asteroidsNum;
+	sim->asteroidsOrder = keyframe->asteroidsOrder;
+	sim->interactionsNum = keyframe->interactionsNum;
+	sim->SpaceShip = keyframe->SpaceShip;
+	sim->BlackHole = keyframe->BlackHole;
+	memcpy(sim->PlanetarySystem, keyframe->PlanetarySystem, sizeof(EphemeridesBody_t) * keyframe->bodyNum);
+	copyAsteroids(sim->Asteroids, keyframe->Asteroids, keyframe->asteroidsNum);
+	if (history->reactionsCapacity)
+		memcpy(sim->asteroidsReactions, keyframe->asteroidsReactions, sizeof(vector3D_t) * history->reactionsCapacity);
+	if (keyframe->asteroidsNum)
+		memcpy(sim->asteroidsIds, keyframe->asteroidsIds, sizeof(unsigned int) * keyframe->asteroidsNum);
+
+	// The same inputs on the same state give back the same steps, bit for bit
+	for (unsigned long long step = index * history->interval; step < target; step++)
+	{
+		sim->spaceShipEngines = keyframe->engines[step - index * history->interval];
+		updateOrbitalSim(sim, spawnBH);
+	}
+
+	unsigned long long undone = history->step - target;
+	history->keyframesNum = index - history->first + 1;
+	history->step = target;
+	return undone;
+}
+
+static void keepKeyframe(History_t* history, const OrbitalSim_t* sim)
+{
+	unsigned long long index = history->step / history->interval;
+
+	// After a rewind this keyframe and the ones after it are taken again
+	if (history->keyframesNum && history->first + history->keyframesNum > index)
+		history->keyframesNum = index - history->first;
+	if (history->keyframesNum == history->keyframesMax)
+	{
+		history->first++;
+		history->keyframesNum--;
+	}
+	if (!history->keyframesNum)
+		history->first = index;
+
+	Keyframe_t* keyframe = &history->keyframes[index % history->keyframesMax];
+	if (!keyframe->PlanetarySystem && !allocateKeyframe(history, keyframe))
+	{
+		// Out of memory: the history starts again at the next keyframe
+		history->keyframesNum = 0;
+		return;
+	}
+
+	keyframe->timeElapsed = sim->timeElapsed;
+	keyframe->dt = sim->dt;
+	keyframe->kick = sim->kick;
+	keyframe->drift = sim->drift;
+	keyframe->asteroidsKick = sim->asteroidsKick;
+	keyframe->asteroidsDrift = sim->asteroidsDrift;
+	keyframe->accelerationsValid = sim->accelerationsValid;
+	keyframe->activeChunks = sim->activeChunks;
+	keyframe->bodyNum = sim->bodyNum;
+	keyframe->asteroidsNum = sim->asteroidsNum;
+	keyframe->asteroidsOrder = sim->asteroidsOrder;
+	keyframe->interactionsNum = sim->interactionsNum;
+	keyframe->SpaceShip = sim->SpaceShip;
+	keyframe->BlackHole = sim->BlackHole;
+	memcpy(keyframe->PlanetarySystem, sim->PlanetarySystem, sizeof(EphemeridesBody_t) * sim->bodyNum);
+	copyAsteroids(keyframe->Asteroids, sim->Asteroids, sim->asteroidsNum);
+	if (history->reactionsCapacity)
+		memcpy(keyframe->asteroidsReactions, sim->asteroidsReactions, sizeof(vector3D_t) * history->reactionsCapacity);
+	if (sim->asteroidsNum)
+		memcpy(keyframe->asteroidsIds, sim->asteroidsIds, sizeof(unsigned int) * sim->asteroidsNum);
+
+	history->keyframesNum++;
+}
+
+static int allocateKeyframe(const History_t* history, Keyframe_t* keyframe)
+{
+	keyframe->PlanetarySystem = (EphemeridesBody_t*) malloc(sizeof(EphemeridesBody_t) * history->bodyCapacity);
+	keyframe->Asteroids = constructBodyArrays(history->asteroidsCapacity);
+	keyframe->asteroidsReactions = (vector3D_t*) ((history->reactionsCapacity) ?
+					malloc(sizeof(vector3D_t) * history->reactionsCapacity) : NULL);
+	keyframe->asteroidsIds = (unsigned int*) ((history->asteroidsCapacity) ?
+					malloc(sizeof(unsigned int) * history->asteroidsCapacity) : NULL);
+	keyframe->engines = (unsigned char*) malloc(history->interval);
+
+	if (!keyframe->PlanetarySystem || !keyframe->Asteroids || !keyframe->engines ||
+		(history->reactionsCapacity && !keyframe->asteroidsReactions) ||
+		(history->asteroidsCapacity && !keyframe->asteroidsIds))
+	{
+		freeKeyframe(keyframe);
+		return 0;
+	}
+	return 1;
+}
+
+static void freeKeyframe(Keyframe_t* keyframe)
+{
+	if (keyframe->PlanetarySystem)
+		free(keyframe->PlanetarySystem);
+	destroyBodyArrays(keyframe->Asteroids);
+	if (keyframe->asteroidsReactions)
+		free(keyframe->asteroidsReactions);
+	if (keyframe->asteroidsIds)
+		free(keyframe->asteroidsIds);
+	if (keyframe->engines)
+		free(keyframe->engines);
+
+	keyframe->PlanetarySystem = NULL;
+	keyframe->Asteroids = NULL;
+	keyframe->asteroidsReactions = NULL;
+	keyframe->asteroidsIds = NULL;
+	keyframe->engines = NULL;
+}
+
+static void copyAsteroids(BodyArrays_t* destination, const BodyArrays_t* source, unsigned int asteroidsNum)
+{
+	const double* sourceArrays[HISTORY_ARRAYS_AMOUNT] = {source->x, source->y, source->z,
+								source->vx, source->vy, source->vz,
+								source->ax, source->ay, source->az, source->mass_GC};
+	double* destinationArrays[HISTORY_ARRAYS_AMOUNT] = {destination->x, destination->y, destination->z,
+								destination->vx, destination->vy, destination->vz,
+								destination->ax, destination->ay, destination->az,
+								destination->mass_GC};
+
+	for (unsigned int i = 0; i < HISTORY_ARRAYS_AMOUNT; i++)
+		memcpy(destinationArrays[i], sourceArrays[i], sizeof(double) * asteroidsNum);
+}
@@ -0,0 +1,134 @@
+/**
+ * @brief Two body (Kepler) propagation
+ *
+ * Solves Kepler's equation in universal variables,
+ *
+ *	r0 s + eta G2(s) + zeta G3(s) = dt,
+ *
+ * with Newton's method, where G_n(s) = s^n c_n(beta s^2) are built from the
+ * Stumpff functions, and moves the body with the f and g functions.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "kepler.h"
+#include <math.h>
+
+#define KEPLER_ITERATIONS_MAX 50
+#define KEPLER_TOLERANCE 1E-15
+
+// Below this |beta s^2| the Stumpff functions are summed as series (avoids cancellation)
+#define STUMPFF_SERIES_LIMIT 0.1
+#define STUMPFF_SERIES_TERMS 8
+
+/**
+ * @brief Calculates the Stumpff functions c0, c1, c2 and c3.
+ *
+ * @param z The argument (beta s^2).
+ * @param c Where c0, c1, c2 and c3 are stored.
+ */
+static void getStumpff(double z, double* c);
+
+void driftKepler(double mu, vector3D_t* position, vector3D_t* velocity, double dt)
+{
+	double r0 = sqrt(DOT_PRODUCT(*position, *position));
+	double eta = DOT_PRODUCT(*position, *velocity);
+	double beta = 2 * mu / r0 - DOT_PRODUCT(*velocity, *velocity);	// mu / semi-major axis
+	double zeta = mu - beta * r0;
+	double c[4];
+	double s = dt / r0;
+	double G1 = 0.0, G2 = 0.0, G3 = 0.0;
+	double r = r0;
+
+	if (!dt || !r0 || !mu)
+	{
+		position->x += velocity->x * dt;
+		position->y += velocity->y * dt;
+		position->z += velocity->z * dt;
+		return;
+	}
+
+	for (int i = 0; i < KEPLER_ITERATIONS_MAX; i++)
+	{
+		getStumpff(beta * s * s, c);
+		G1 = s * c[1];
+		G2 = s * s * c[2];
+		G3 = s * s * s * c[3];
+		r = r0 + eta * G1 + zeta * G2;
+
+		double ds = (r0 * s + eta * G2 + zeta * G3 - dt) / r;
+		s -= ds;
+		if (fabs(ds) <= KEPLER_TOLERANCE * fabs(s))
+			break;
+	}
+
+	// Coefficients at the converged s
+	getStumpff(beta * s * s, c);
+	G1 = s * c[1];
+	G2 = s * s * c[2];
+	G3 = s * s * s * c[3];
+	r = r0 + eta * G1 + zeta * G2;
+
+	double f = 1 - mu / r0 * G2;
+	double g = dt - mu * G3;
+	double fdot = -mu / (r * r0) * G1;
+	double gdot = 1 - mu / r * G2;
+
+	vector3D_t p = *position;
+	vector3D_t v = *velocity;
+
+	position->x = f * p.x + g * v.x;
+	position->y = f * p.y + g * v.y;
+	position->z = f * p.z + g * v.z;
+
+	velocity->x = fdot * p.x + gdot * v.x;
+	velocity->y = fdot * p.y + gdot * v.y;
+	velocity->z = fdot * p.z + gdot * v.z;
+}
+
+static void getStumpff(double z, double* c)
+{
+	if (fabs(z) < STUMPFF_SERIES_LIMIT)
+	{
+		// c2 = sum (-z)^k / (2k + 2)!, c3 = sum (-z)^k / (2k + 3)!
+		double term2 = 0.5;
+		double term3 = 1.0 / 6;
+
+		c[2] = c[3] = 0.0;
+		for (int k = 0; k < STUMPFF_SERIES_TERMS; k++)
+		{
+			c[2] += term2;
+			c[3] += term3;
+			term2 *= -z / ((2 * k + 3) * (2 * k + 4));
+			term3 *= -z / ((2 * k + 4) * (2 * k + 5));
+		}
+		c[1] = 1 - z * c[3];
+		c[0] = 1 - z * c[2];
+		return;
+	}
+
+	if (z > 0)
+	{
+		double x = sqrt(z);
+		double sine = sin(x);
+		double halfSine = sin(x / 2);
+
+		c[0] = cos(x);
+		c[1] = sine / x;
+		c[2] = 2 * halfSine * halfSine / z;
+		c[3] = (x - sine) / (z * x);
+	}
+	else
+	{
+		double x = sqrt(-z);
+		double sine = sinh(x);
+		double halfSine = sinh(x / 2);
+
+		c[0] = cosh(x);
+		c[1] = sine / x;
+		c[2] = -2 * halfSine * halfSine / z;
+		c[3] = (x - sine) / (z * x);
+	}
+}
@@ -16,6 +16,8 @@
 #define TOGGLE_ASTEROIDS_RENDER_MODE_KEY KEY_F8
 #define TOGGLE_SHOW_VELOCITY_KEY KEY_F9
 #define TOGGLE_SHOW_ACCELERATION_KEY KEY_F10
+#define TOGGLE_SHOW_TRAILS_KEY KEY_F3
+#define TOGGLE_PROFILER_KEY KEY_F1
 
 #define SPACESHIP_XP_KEY KEY_U
 #define SPACESHIP_YP_KEY KEY_I
@@ -75,6 +77,16 @@ const keybind_t keybinds[KEYBINDS_AMOUNT] =
 	{
 		TOGGLE_FULLSCREEN_KEY,
 		"Toggle Fullscreen: F11"
+	},
+	// TOGGLE_SHOW_TRAILS
+	{
+		TOGGLE_SHOW_TRAILS_KEY,
+		"Show/Hide Trails: F3"
+	},
+	// TOGGLE_PROFILER
+	{
+		TOGGLE_PROFILER_KEY,
+		"Show/Hide Profiler: F1"
 	}
 };
 
@@ -88,4 +100,4 @@ const int movementKeys[] =
 
 const unsigned int movementKeysAmount = sizeof(movementKeys) / sizeof(movementKeys[0]);
 
-int movementKeyIsDown[movementKeysAmount];
\ No newline at end of file
+std::atomic<int> movementKeyIsDown[movementKeysAmount];
\ No newline at end of file
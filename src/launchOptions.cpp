@@ -56,7 +56,7 @@ const launchOptions_t launchOptions[] =
 		"-asteroids_amount",
 		1,
 		0,
-		{0, 20000}
+		{0, 1000000}
 	},
 	{
 		"-show_velocity_vectors",
@@ -93,6 +93,108 @@ const launchOptions_t launchOptions[] =
 		1,
 		0,
 		{0, 1}
+	},
+	{
+		"-threads",
+		1,
+		0,
+		{0, 256}
+	},
+	{
+		"-asteroid_self_gravity",
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-opening_angle",	// Hundredths
+		1,
+		50,
+		{0, 200}
+	},
+	{
+		"-fmm_order",		// 0 keeps Barnes-Hut
+		1,
+		0,
+		{0, 8}
+	},
+	{
+		"-integrator",		// Integrator_t
+		1,
+		0,
+		{0, 5}
+	},
+	{
+		"-headless",		// Steps to run without a window (0 opens the window)
+		1,
+		0,
+		{0, 1000000000}
+	},
+	{
+		"-show_trails",
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-save_checkpoint",	// Saves CHECKPOINT_PATH when the simulation ends
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-load_checkpoint",	// Restores CHECKPOINT_PATH instead of a new simulation
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-record",		// Updates between frames written to RECORD_PATH (0 records nothing)
+		1,
+		0,
+		{0, 1000000}
+	},
+	{
+		"-record_delta",
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-rewind_memory",	// Megabytes of keyframes kept to rewind (0 disables rewinding)
+		1,
+		256,
+		{0, 16384}
+	},
+	{
+		"-seed",		// Seed of the asteroids and the SpaceShip
+		1,
+		0,
+		{0, 2147483647}
+	},
+	{
+		"-state_hash",		// Updates between the state hashes printed in headless mode (0 only prints the last)
+		1,
+		0,
+		{0, 1000000000}
+	},
+	{
+		"-trace",		// Profiles every stage and writes the last ones to PROFILER_TRACE_PATH
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-mixed_precision",	// Pulls the asteroids in float, they still move in double
+		0,
+		0,
+		{0, 1}
+	},
+	{
+		"-massless_asteroids",	// The asteroids feel the bodies, but do not pull anything
+		0,
+		0,
+		{0, 1}
 	}
 };
 
@@ -13,154 +13,274 @@
 #include "orbitalSim.h"
 #include "view.h"
 #include "controller.h"
+#include "gravityKernels.h"
+#include "physicsThread.h"
+#include "checkpoint.h"
+#include "recorder.h"
+#include "history.h"
+#include "frameGovernor.h"
+#include "profiler.h"
 #include <stdio.h>
-
-//#define TEST_UPDATE_ORBITAL_SIM
-#ifdef TEST_UPDATE_ORBITAL_SIM
-	#include <time.h>
-#endif
+#include <math.h>
+#include <chrono>
 
 #define INITIAL_SIM_UPDATES_PER_FRAME 100
 #define SECONDS_PER_DAY ( 24 * 60 * 60 )
+#define FMM_ERROR_SAMPLE_SIZE 100
+#define BYTES_PER_MEGABYTE ( 1024 * 1024 )
 
 /**
- * @brief Finds the number of updates per frame that the computer can perform
- *			to achieve the desired frame rate.
+ * @brief Runs the simulation without a window and prints its throughput.
+ *
+ * @param sim The orbital simulation
+ * @param steps The amount of updates to run
+ * @param spawnBH Lets the black hole absorb bodies
+ * @param recorder Records every update (NULL if nothing is recorded)
+ * @param hashInterval Updates between the state hashes printed (0 only prints the last one)
+ */
+static void runHeadless(OrbitalSim_t* sim, int steps, int spawnBH, Recorder_t* recorder, int hashInterval);
+
+/**
+ * @brief Starts recording to RECORD_PATH, if the -record launch option asks for it.
+ *
  * @param sim The orbital simulation
- * @param view The view
- * @param target_frametime The desired frametime
- * @param PIDC Constant for the PID that will adjust the nummer of sim updates per frame
+ * @param launchOptionsValues Values of the launch options
  *
- * @return SimUpdatesPerFrame (1 if even updating the simulation 1 time per frame the computer can not render the desired FPS)
+ * @return The recorder (NULL if nothing is recorded)
  */
-static int getInitialSimUpdatesPerFrame(OrbitalSim_t* sim, view_t* view, double target_frametime, double PIDC, int spawnBH);
+static Recorder_t* startRecording(const OrbitalSim_t* sim, const int* launchOptionsValues);
 
 /**
- * @brief 
+ * @brief Writes what is left of the recording and reports it.
  *
- * @param target_frametime 
- * @param frametime 
+ * @param recorder The recorder (NULL if nothing was recorded)
+ */
+static void stopRecording(Recorder_t* recorder);
+
+/**
+ * @brief Starts keeping the history of the simulation, if the -rewind_memory
+ *		launch option allows it. A keyframe is taken every frame worth of
+ *		updates, so rewinding costs about as much as going forwards.
  *
- * @return 
+ * @param sim The orbital simulation
+ * @param launchOptionsValues Values of the launch options
+ * @param simulationSpeed Simulated seconds per real second
+ *
+ * @return The history (NULL if the simulation cannot rewind)
  */
-static double frametime_PID(double target_frametime, double frametime);
+static History_t* startHistory(const OrbitalSim_t* sim, const int* launchOptionsValues, double simulationSpeed);
+
+/**
+ * @brief Writes the events kept by the profiler to PROFILER_TRACE_PATH, if the
+ *		-trace launch option asks for it, and reports it.
+ *
+ * @param launchOptionsValues Values of the launch options
+ */
+static void writeTrace(const int* launchOptionsValues);
+
+/**
+ * @brief Saves the simulation to CHECKPOINT_PATH and reports it.
+ *
+ * @param sim The orbital simulation
+ */
+static void saveSimulation(const OrbitalSim_t* sim);
 
 int main(int argc, char* argv[])
 {
 	int launchOptionsValues[launchOptionsAmount];
-	int time_direction = 0;
-	int prev_time_direction = 0;
-	int sim_updates_per_frame;
 	double simulationSpeed;
-	double target_frametime;
-	double PIDC;
+	double targetFrametime;
+	FrameGovernor_t governor;
 
 	searchLaunchOptions(argc, argv, launchOptionsValues);
 	simulationSpeed = launchOptionsValues[DAYS_PER_SIMULATION_SECOND] * SECONDS_PER_DAY;
+	targetFrametime = 1.0 / launchOptionsValues[TARGET_FPS];
 	solarSystem[JUPITER].body.mass_GC *= (launchOptionsValues[MASSIVE_JUPITER]) ? 1E3 : 1.0;
+	setProfilerEnabled(launchOptionsValues[TRACE]);
+
+	OrbitalSimSettings_t settings;
+	settings.threadsNum = launchOptionsValues[THREADS];
+	// Massless asteroids do not pull each other either
+	settings.asteroidsGravity = (launchOptionsValues[MASSLESS_ASTEROIDS]) ? ASTEROIDS_GRAVITY_NONE :
+					(launchOptionsValues[FMM_ORDER]) ? ASTEROIDS_GRAVITY_FMM :
+					(launchOptionsValues[ASTEROID_SELF_GRAVITY]) ? ASTEROIDS_GRAVITY_BARNES_HUT :
+					ASTEROIDS_GRAVITY_NONE;
+	settings.openingAngle = launchOptionsValues[OPENING_ANGLE] / 100.0;
+	settings.expansionOrder = launchOptionsValues[FMM_ORDER];
+	settings.integrator = (Integrator_t) launchOptionsValues[INTEGRATOR];
+	settings.asteroidsPrecision = (GravityPrecision_t) launchOptionsValues[MIXED_PRECISION];
+	settings.masslessAsteroids = launchOptionsValues[MASSLESS_ASTEROIDS];
+
+	OrbitalSim_t* sim = NULL;
+	if (launchOptionsValues[LOAD_CHECKPOINT])
+	{
+		sim = loadCheckpoint(CHECKPOINT_PATH, &settings);
+		if (!sim)
+			printf("\nCould not load %s, starting a new simulation\n", CHECKPOINT_PATH);
+	}
 
-	OrbitalSim_t* sim = constructOrbitalSim(launchOptionsValues[ASTEROIDS_AMOUNT],
-						launchOptionsValues[EASTER_EGG],
-						launchOptionsValues[SYSTEM],
-						launchOptionsValues[SPAWN_BLACKHOLE]);
+	// A restored simulation keeps its dt, and always starts forwards
+	int restored = (sim != NULL);
+	if (restored)
+	{
+		sim->dt = fabs(sim->dt);
+		launchOptionsValues[SPAWN_BLACKHOLE] = (sim->BlackHole.absorbRadius != 0.0);
+		printf("\nRestored %s: %u asteroids, %.2lf simulated days\n", CHECKPOINT_PATH, sim->asteroidsNum,
+			sim->timeElapsed / SECONDS_PER_DAY);
+	}
+	else
+		sim = constructOrbitalSim(launchOptionsValues[ASTEROIDS_AMOUNT],
+					launchOptionsValues[EASTER_EGG],
+					launchOptionsValues[SYSTEM],
+					launchOptionsValues[SPAWN_BLACKHOLE],
+					launchOptionsValues[SEED],
+					&settings);
+
+	if (launchOptionsValues[HEADLESS])
+	{
+		if (!restored)
+			sim->dt = simulationSpeed * targetFrametime / INITIAL_SIM_UPDATES_PER_FRAME;
+		Recorder_t* recorder = startRecording(sim, launchOptionsValues);
+		runHeadless(sim, launchOptionsValues[HEADLESS], launchOptionsValues[SPAWN_BLACKHOLE], recorder,
+				launchOptionsValues[STATE_HASH]);
+		stopRecording(recorder);
+		writeTrace(launchOptionsValues);
+		if (launchOptionsValues[SAVE_CHECKPOINT])
+			saveSimulation(sim);
+		destroyOrbitalSim(sim);
+		destroyProfiler();
+		return 0;
+	}
 
-#ifndef TEST_UPDATE_ORBITAL_SIM
 	view_t* view = constructView(	0,
 					launchOptionsValues[FULLSCREEN],
 					launchOptionsValues[WIDTH],
 					launchOptionsValues[HEIGHT],
 					launchOptionsValues[SHOW_VELOCITY_VECTORS],
-					launchOptionsValues[SHOW_ACCELERATION_VECTORS]);
-
-	PIDC = (sim->asteroidsNum == 0) ? 1E4 : 1E4 / sim->asteroidsNum;
-	PIDC = (PIDC < 1) ? 1 : PIDC;
-
-	target_frametime = 1.0 / launchOptionsValues[TARGET_FPS];
-	sim_updates_per_frame = getInitialSimUpdatesPerFrame(sim, view, target_frametime, PIDC, launchOptionsValues[SPAWN_BLACKHOLE]);
-	sim->dt = simulationSpeed * target_frametime / sim_updates_per_frame;
-	printf("\nsim_updates_per_frame = %d\ndt = %.15lf seconds\n", sim_updates_per_frame, sim->dt);
-
-	while (isViewRendering(view))
+					launchOptionsValues[SHOW_ACCELERATION_VECTORS],
+					launchOptionsValues[SHOW_TRAILS]);
+
+	// The timing of a first update picks dt, the physics thread keeps refitting it
+	initFrameGovernor(&governor, simulationSpeed, targetFrametime,
+				(restored) ? sim->dt : simulationSpeed * targetFrametime / INITIAL_SIM_UPDATES_PER_FRAME);
+	primeFrameGovernor(&governor, sim, launchOptionsValues[SPAWN_BLACKHOLE]);
+	printf("\nsim_updates_per_frame = %.1lf", getFrameGovernorUpdatesPerFrame(&governor));
+	printf("\ndt = %.15lf seconds\n", sim->dt);
+	printf("gravity kernel = %s%s\nthreads = %u\n", getGravityKernelName(),
+		(sim->asteroidsPrecision == GRAVITY_PRECISION_MIXED) ? " (mixed precision)" : "", getThreadPoolSize(sim->threadPool));
+	printf("integrator = %s\n", getIntegratorName(sim->integrator));
+	if (sim->fastMultipole)
+		printf("fmm order = %u\nfmm error = %.3g (max over %u asteroids, relative to their RMS acceleration)\n",
+			sim->fastMultipole->order, getAsteroidsGravityError(sim, FMM_ERROR_SAMPLE_SIZE), FMM_ERROR_SAMPLE_SIZE);
+
+	// From here on only the physics thread touches sim
+	Recorder_t* recorder = startRecording(sim, launchOptionsValues);
+	History_t* history = startHistory(sim, launchOptionsValues, simulationSpeed);
+	PhysicsThread_t* physics = constructPhysicsThread(sim, launchOptionsValues[SPAWN_BLACKHOLE], &governor, recorder, history);
+
+	while (physics && isViewRendering(view))
 	{
-		updateUserInputs(sim->bodyNum);
-
-		for (int i = 0; i < sim_updates_per_frame; i++)
-			updateOrbitalSim(sim, launchOptionsValues[SPAWN_BLACKHOLE]);
+		const SimSnapshot_t* latest = getPhysicsSnapshot(physics);
 
-		renderView(view, sim);
-		prev_time_direction = time_direction;
-		time_direction = keybindsValues[TOGGLE_REWIND];
-		if (time_direction == prev_time_direction)
-			continue;
-
-		sim->dt = -sim->dt;
+		updateUserInputs(latest->bodyNum);
+		setPhysicsTimeDirection(physics, keybindsValues[TOGGLE_REWIND]);
+		setProfilerEnabled(launchOptionsValues[TRACE] || keybindsValues[TOGGLE_PROFILER]);
+		renderView(view, latest);
+		setPhysicsFrametime(physics, GetFrameTime());
 	}
 
+	destroyPhysicsThread(physics);
+	destroyHistory(history);
+	stopRecording(recorder);
 	destroyView(view);
+	writeTrace(launchOptionsValues);
+	if (launchOptionsValues[SAVE_CHECKPOINT])
+		saveSimulation(sim);
 	destroyOrbitalSim(sim);
+	destroyProfiler();
 
 	return 0;
-#else
-	#define TEST_TIME (60 * 20)
-	time_t t0, t1;
-	size_t counter = 0;
-	t0 = time(NULL);
+}
 
-	do
-	{
-		updateOrbitalSim(sim, launchOptionsValues[SPAWN_BLACKHOLE]);
-		counter++;
-		t1 = time(NULL);
-	} while (difftime(t1,t0) < TEST_TIME);
+static void runHeadless(OrbitalSim_t* sim, int steps, int spawnBH, Recorder_t* recorder, int hashInterval)
+{
+	printf("\ndt = %.15lf seconds\ngravity kernel = %s%s\nthreads = %u\nintegrator = %s\n", sim->dt,
+		getGravityKernelName(), (sim->asteroidsPrecision == GRAVITY_PRECISION_MIXED) ? " (mixed precision)" : "",
+		getThreadPoolSize(sim->threadPool), getIntegratorName(sim->integrator));
 
-	printf("\nUpdates:\t%zu\nTime:\t%lld\n", counter, t1 - t0);
-	printf("\nUpdates per second:\t%zu\n",counter / TEST_TIME);
-	printf("\nUpdates per frame:\t%zu\n",counter / (TEST_TIME * launchOptionsValues[TARGET_FPS]));
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; i++)
+	{
+		updateOrbitalSim(sim, spawnBH);
+		if (recorder)
+			recordOrbitalSim(recorder, sim);
+		if (hashInterval && (i + 1) % hashInterval == 0)
+			printf("Update %d:\thash %016llx\n", i + 1, getOrbitalSimHash(sim));
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
 
-	return 0;
-#endif
+	printf("\nUpdates:\t%d\nTime:\t%.3lf s\n", steps, seconds);
+	printf("Updates per second:\t%.1lf\n", steps / seconds);
+	printf("ns per interaction:\t%.3lf\n", seconds * 1E9 / sim->interactionsNum);
+	printf("Simulated days:\t%.2lf\n", sim->timeElapsed / SECONDS_PER_DAY);
+	printf("State hash:\t%016llx\n", getOrbitalSimHash(sim));
 }
 
-static int getInitialSimUpdatesPerFrame(OrbitalSim_t* sim, view_t* view, double target_frametime, double PIDC, int spawnBH)
+static Recorder_t* startRecording(const OrbitalSim_t* sim, const int* launchOptionsValues)
 {
-	double sim_updates_per_frame = INITIAL_SIM_UPDATES_PER_FRAME;
-	double frametime = 0;
+	if (!launchOptionsValues[RECORD])
+		return NULL;
 
-	sim->dt = 0;
+	Recorder_t* recorder = constructRecorder(RECORD_PATH, sim, launchOptionsValues[RECORD], launchOptionsValues[RECORD_DELTA]);
+	if (!recorder)
+		printf("\nCould not create %s, nothing is recorded\n", RECORD_PATH);
+	return recorder;
+}
 
-	while (isViewRendering(view) && ((frametime < 0.99 * target_frametime) || (frametime > 1.01 * target_frametime)))
-	{
-		updateUserInputs(sim->bodyNum);
+static void stopRecording(Recorder_t* recorder)
+{
+	unsigned long long framesNum, droppedNum;
 
-		for (int i = 0; i < sim_updates_per_frame; i++)
-			updateOrbitalSim(sim, spawnBH);
+	if (!recorder)
+		return;
 
-		renderView(view, sim);
-		frametime = GetFrameTime();
-		if (sim_updates_per_frame < 2.0 && frametime > target_frametime)	// if target frametime can not be obtained
-			break;
+	if (destroyRecorder(recorder, &framesNum, &droppedNum))
+		printf("\nRecorded %llu frames to %s (%llu dropped, the disk was behind)\n", framesNum, RECORD_PATH, droppedNum);
+	else
+		printf("\nCould not write %s, only the first %llu frames were recorded\n", RECORD_PATH, framesNum);
+}
 
-		sim_updates_per_frame += PIDC * frametime_PID(target_frametime, frametime);
-		sim_updates_per_frame = (sim_updates_per_frame > 1) ? sim_updates_per_frame : 1;
-	}
+static History_t* startHistory(const OrbitalSim_t* sim, const int* launchOptionsValues, double simulationSpeed)
+{
+	if (!launchOptionsValues[REWIND_MEMORY])
+		return NULL;
+
+	double updatesPerFrame = simulationSpeed / (launchOptionsValues[TARGET_FPS] * sim->dt);
+	unsigned int interval = (unsigned int) fmin(fmax(round(updatesPerFrame), 1.0), 1E6);
 
-	return (int)sim_updates_per_frame;
+	History_t* history = constructHistory(sim, interval, (size_t)launchOptionsValues[REWIND_MEMORY] * BYTES_PER_MEGABYTE);
+	if (!history)
+		printf("\n%d MB do not hold a keyframe of the simulation, it cannot rewind\n", launchOptionsValues[REWIND_MEMORY]);
+	return history;
 }
 
-static double frametime_PID(double target_frametime, double frametime)
+static void writeTrace(const int* launchOptionsValues)
 {
-	static double PC = 10;
-	static double IC = 10;
-	static double DC = 10;
-
-	static double I = 0;				// Stores the accumulated error
-	static double prev_dif = 0;
+	unsigned long long eventsNum;
 
-	double P = target_frametime - frametime;	// Stores the current error
-	double D = P - prev_dif;			// Stores the difference between the prev error and the current one
+	if (!launchOptionsValues[TRACE])
+		return;
 
-	prev_dif = P;
-	I += P;
+	if (writeProfilerTrace(PROFILER_TRACE_PATH, &eventsNum))
+		printf("\nWrote %llu profiler events to %s\n", eventsNum, PROFILER_TRACE_PATH);
+	else
+		printf("\nCould not write %s\n", PROFILER_TRACE_PATH);
+}
 
-	return P * PC + I * IC + D * DC;
-}
\ No newline at end of file
+static void saveSimulation(const OrbitalSim_t* sim)
+{
+	if (saveCheckpoint(sim, CHECKPOINT_PATH))
+		printf("\nSaved %s: %u asteroids, %.2lf simulated days\n", CHECKPOINT_PATH, sim->asteroidsNum, sim->timeElapsed / SECONDS_PER_DAY);
+	else
+		printf("\nCould not save %s\n", CHECKPOINT_PATH);
+}
@@ -15,39 +15,194 @@
 #include "orbitalSim.h"
 #include "vector3D.h"
 #include "keyBinds.h"
+#include "gravityKernels.h"
+#include "threadPool.h"
+#include "barnesHut.h"
+#include "fastMultipole.h"
+#include "kepler.h"
+#include "profiler.h"
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
-#define ASTEROIDS_MEAN_RADIUS 4E11F
+#define ASTEROIDS_MEAN_RADIUS 4E11
+
+// Softening of the gravity between asteroids, keeps close encounters from
+// launching them (about the size of the Earth) [m]
+#define ASTEROIDS_SOFTENING 1E7
+
+// Bodies per Barnes-Hut leaf
+#define ASTEROIDS_OCTREE_LEAF_SIZE 8
+
+// Yoshida weights, w1 = 1 / (2 - 2^(1/3)) and w0 = 1 - 2 w1
+#define YOSHIDA_W1 1.3512071919596578
+#define YOSHIDA_W0 (-1.7024143839193156)
+
+// Force evaluations per step of the leapfrog style schemes
+#define SYMPLECTIC_STAGES_MAX 3
+
+// Block timesteps: finest level (steps of dt / 2^level) and the fraction of
+// |acceleration| / |jerk| a body may step over
+#define BLOCK_LEVELS_MAX 10
+#define BLOCK_TIMESTEP_ETA 0.02
 
 // SpaceShip defines
 #define SpaceShip_ACCELERATION 1E-3
 
+// Random streams of a seed. Asteroid i draws the values
+// [i * ASTEROID_RANDOM_DRAWS, (i + 1) * ASTEROID_RANDOM_DRAWS) of its stream,
+// whichever asteroids are generated before it
+#define RANDOM_STREAM_ASTEROIDS 0
+#define RANDOM_STREAM_SPACESHIP 1
+#define ASTEROID_RANDOM_DRAWS 4
+
+// Weyl increment of the random counters (2^64 / golden ratio)
+#define RANDOM_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+// FNV-1a, hashes the state
+#define STATE_HASH_OFFSET 0xCBF29CE484222325ULL
+#define STATE_HASH_PRIME 0x100000001B3ULL
+
+/**
+ * Private types.
+ */
+
+/**
+ * @brief Scheme made of a leading drift and force evaluations that each kick
+ *		and then drift every body. Times are fractions of dt.
+ */
+typedef struct
+{
+	double leadingDrift;
+	unsigned int stagesNum;
+	double kicks[SYMPLECTIC_STAGES_MAX];
+	double drifts[SYMPLECTIC_STAGES_MAX];
+} SymplecticScheme_t;
+
+/**
+ * @brief Which bodies of a pair feel the other one.
+ */
+typedef enum
+{
+	PULL_TWO_WAY,		// Each body feels the other
+	PULL_ONE_WAY		// Only the first body feels the second
+} Pull_t;
+
+/**
+ * @brief Counter based random stream: value n is a hash of the key and n, so
+ *		any value can be drawn without drawing the ones before it.
+ */
+typedef struct
+{
+	unsigned long long key;		// Seed and stream
+	unsigned long long counter;	// Next value drawn
+} RandomStream_t;
+
+/**
+ * @brief What every chunk of a new belt of asteroids is generated from.
+ */
+typedef struct
+{
+	BodyArrays_t* asteroids;
+	unsigned int asteroidsNum;
+	unsigned int seed;
+	int easter_egg;
+	double centerMass;		// The mass of the most massive object in the star system
+} AsteroidsGenerator_t;
+
+/**
+ * Private variables.
+ */
+
+static const SymplecticScheme_t eulerScheme = {0.0, 1, {1.0}, {1.0}};
+static const SymplecticScheme_t leapfrogScheme = {0.5, 1, {1.0}, {0.5}};
+static const SymplecticScheme_t yoshidaScheme =
+{
+	YOSHIDA_W1 / 2,
+	3,
+	{YOSHIDA_W1, YOSHIDA_W0, YOSHIDA_W1},
+	{(YOSHIDA_W0 + YOSHIDA_W1) / 2, (YOSHIDA_W0 + YOSHIDA_W1) / 2, YOSHIDA_W1 / 2}
+};
+
+static const char* const integratorNames[INTEGRATORS_AMOUNT] = {"Euler", "Leapfrog", "Yoshida", "Wisdom-Holman",
+									"Block leapfrog", "Wisdom-Holman (Jacobi)"};
+
 /**
  * Private function definitions.
  */
 
 /**
- * @brief Gets a uniform random value in a range.
+ * @brief Mixes the bits of a word (SplitMix64 finalizer).
+ *
+ * @param x The word.
+ *
+ * @return The mixed word.
+ */
+static inline unsigned long long mixBits(unsigned long long x);
+
+/**
+ * @brief Gets a random stream.
  *
+ * @param seed Seed of the simulation.
+ * @param stream Stream of the seed (RANDOM_STREAM_*).
+ * @param counter First value drawn.
+ *
+ * @return The random stream.
+ */
+static RandomStream_t getRandomStream(unsigned int seed, unsigned int stream, unsigned long long counter);
+
+/**
+ * @brief Draws a uniform random value in a range, never min or max themselves.
+ *
+ * @param random The random stream.
  * @param min Minimum value.
  * @param max Maximum value.
  *
  * @return The random value.
  */
-static float getRandomFloat(float min, float max);
+static double getRandomDouble(RandomStream_t* random, double min, double max);
 
 /**
  * @brief Configures an asteroid.
  *
  * @param body An orbital body.
  * @param centerMass The mass of the most massive object in the star system.
+ * @param random The random stream, ASTEROID_RANDOM_DRAWS values are drawn.
  */
-static void configureAsteroid(Body_t* body, float centerMass, int easter_egg);
+static void configureAsteroid(Body_t* body, double centerMass, int easter_egg, RandomStream_t* random);
 
 /**
- * @brief Sets PlanetarySystem, Asteroids and SpaceShip accelerations to 0
+ * @brief Generates the asteroids of a chunk. Each asteroid only depends on the
+ *		seed and its index, so chunks are generated in any order.
+ *
+ * @param data Pointer to the AsteroidsGenerator_t.
+ * @param chunk Index of the chunk.
+ */
+static void generateAsteroidsChunk(void* data, unsigned int chunk);
+
+/**
+ * @brief Adds a value to a state hash, byte by byte from the least significant one.
+ *
+ * @param hash The hash.
+ * @param value The value.
+ *
+ * @return The new hash.
+ */
+static inline unsigned long long hashValue(unsigned long long hash, double value);
+
+/**
+ * @brief Adds the position and velocity of a body to a state hash.
+ *
+ * @param hash The hash.
+ * @param body The body.
+ *
+ * @return The new hash.
+ */
+static inline unsigned long long hashBody(unsigned long long hash, const Body_t* body);
+
+/**
+ * @brief Sets PlanetarySystem, SpaceShip and BlackHole accelerations to 0
  *		Must be called before updateAccelerations.
  *
  * @param sim Pointer to the simulation.
@@ -55,42 +210,260 @@ static void configureAsteroid(Body_t* body, float centerMass, int easter_egg);
 static inline void initializeAccelerations(OrbitalSim_t* sim);
 
 /**
- * @brief Calculates the accelerations between two bodies.
+ * @brief Calculates the accelerations between two bodies. The kind of pull is
+ *		a template parameter, so one way pairs never compute the reaction.
  *
  * @param body0 First body.
- * @param body1 Second body.
+ * @param body1 Second body, the black hole or the star under Wisdom-Holman in one way pairs.
  */
+template <Pull_t PULL>
 static inline void calculateAccelerations(Body_t* body0, Body_t* body1);
 
 /**
- * @brief Calculates the acceleration of one body
- * @param body0 First body.
- * @param body1 Second body.
+ * @brief Calculates the acceleration for every body in the simulation, except the asteroids.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static inline void updateAccelerations(OrbitalSim_t* sim);
+
+/**
+ * @brief Calculates the acceleration, speed and position of one chunk of asteroids
+ *		in a single sweep. Stores the pull of the chunk on each body in
+ *		sim->asteroidsReactions.
+ *
+ * @param data Pointer to the simulation.
+ * @param chunk Index of the chunk.
  */
-static inline void calculateAccelerationsOneWay(Body_t* body0, Body_t* body1);
+static void updateAsteroidsChunk(void* data, unsigned int chunk);
 
 /**
- * @brief Calculates the acceleration for every body in the simulation.
+ * @brief Flags the asteroids of a chunk that are inside the black hole.
+ *		Runs right after the chunk is updated, while it is still in cache.
  *
  * @param sim Pointer to the simulation.
+ * @param begin Index of the first asteroid.
+ * @param end Index past the last asteroid.
+ *
+ * @return The amount of asteroids newly flagged.
  */
-static inline void updateAccelerations(OrbitalSim_t* sim);
+static inline unsigned int flagAbsorbedAsteroids(OrbitalSim_t* sim, unsigned int begin, unsigned int end);
 
 /**
- * @brief Calculates the new speed and position for a given body.
+ * @brief Updates every asteroid in the thread pool and adds their pull to the bodies.
+ *		Must be called after updateAccelerations and before updateSpeedsAndPositions,
+ *		so the asteroids see the bodies where they were at the start of the step.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static inline void updateAsteroids(OrbitalSim_t* sim);
+
+/**
+ * @brief Kicks and then drifts a given body.
  *
  * @param body Pointer to the body.
- * @param dt Time step used to calculate discrete integrals.
+ * @param kick Time the acceleration is applied for.
+ * @param drift Time the new velocity is applied for.
  */
-static inline void calculateSpeedAndPosition(Body_t* body, double dt);
+static inline void calculateSpeedAndPosition(Body_t* body, double kick, double drift);
 
 /**
- * @brief Calculates the speed and position for every body in the simulation.
+ * @brief Kicks and drifts every body in the simulation, except the asteroids,
+ *		by sim->kick and sim->drift.
  *
  * @param sim Pointer to the simulation.
  */
 static inline void updateSpeedsAndPositions(OrbitalSim_t* sim);
 
+/**
+ * @brief Calculates every acceleration, then kicks and drifts the bodies by
+ *		sim->kick and sim->drift, and the first sim->activeChunks asteroid
+ *		chunks by sim->asteroidsKick and sim->asteroidsDrift.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static void evaluateActiveForces(OrbitalSim_t* sim);
+
+/**
+ * @brief Calculates every acceleration, then kicks and drifts every body.
+ *
+ * @param sim Pointer to the simulation.
+ * @param kick Time the accelerations are applied for.
+ * @param drift Time the new velocities are applied for.
+ */
+static void evaluateForces(OrbitalSim_t* sim, double kick, double drift);
+
+/**
+ * @brief Kicks one chunk of asteroids by sim->asteroidsKick with their last
+ *		accelerations, then moves them in a straight line for sim->asteroidsDrift.
+ *
+ * @param data Pointer to the simulation.
+ * @param chunk Index of the chunk.
+ */
+static void kickDriftAsteroidsChunk(void* data, unsigned int chunk);
+
+/**
+ * @brief Moves every body in a straight line, without calculating any acceleration.
+ *
+ * @param sim Pointer to the simulation.
+ * @param drift Time the velocities are applied for.
+ */
+static void driftBodies(OrbitalSim_t* sim, double drift);
+
+/**
+ * @brief Advances a timestep with a leapfrog style scheme.
+ *
+ * @param sim Pointer to the simulation.
+ * @param scheme The scheme.
+ */
+static void stepSymplectic(OrbitalSim_t* sim, const SymplecticScheme_t* scheme);
+
+/**
+ * @brief Moves a body along its Kepler orbit around the central star, which
+ *		moves in a straight line for the same time.
+ *
+ * @param star The central star, at the start of the drift.
+ * @param mu Mass of the star [m^3 / s^2]. The pull of the body on the star
+ *		is left to the kicks, which move the star.
+ * @param position Position of the body, updated.
+ * @param velocity Velocity of the body, updated.
+ * @param dt Time to move the body for.
+ */
+static inline void driftAroundStar(const Body_t* star, double mu, vector3D_t* position, vector3D_t* velocity, double dt);
+
+/**
+ * @brief Kicks one chunk of asteroids by sim->kick with their last accelerations,
+ *		then moves them along their Kepler orbits for sim->drift.
+ *
+ * @param data Pointer to the simulation.
+ * @param chunk Index of the chunk.
+ */
+static void kickDriftAsteroidsKeplerChunk(void* data, unsigned int chunk);
+
+/**
+ * @brief Converts vectors of the massive bodies to Jacobi coordinates: each
+ *		body relative to the center of mass of the bodies before it. The
+ *		first one becomes the center of mass of them all.
+ *
+ * @param bodies The massive bodies, their masses weigh the vectors.
+ * @param bodyNum The amount of massive bodies.
+ * @param inertial The vector of each body (positions, velocities or accelerations).
+ * @param jacobi Where the Jacobi vectors are stored.
+ */
+static void transformToJacobi(const EphemeridesBody_t* bodies, unsigned int bodyNum, const vector3D_t* inertial,
+				vector3D_t* jacobi);
+
+/**
+ * @brief Converts vectors of the massive bodies back from Jacobi coordinates.
+ *
+ * @param bodies The massive bodies, their masses weigh the vectors.
+ * @param bodyNum The amount of massive bodies.
+ * @param jacobi The Jacobi vectors.
+ * @param inertial Where the vector of each body is stored.
+ */
+static void transformFromJacobi(const EphemeridesBody_t* bodies, unsigned int bodyNum, const vector3D_t* jacobi,
+				vector3D_t* inertial);
+
+/**
+ * @brief Takes out of the accelerations of the massive bodies the part their
+ *		Jacobi Kepler drifts already account for: the pull of the mass
+ *		inside each orbit, as if it was all at its center of mass.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static void subtractJacobiKeplerAccelerations(OrbitalSim_t* sim);
+
+/**
+ * @brief Moves the massive bodies along their Jacobi Kepler orbits: each body
+ *		around the center of mass of the bodies before it, with their
+ *		mass plus its own.
+ *
+ * @param sim Pointer to the simulation.
+ * @param dt Time to move the bodies for.
+ */
+static void driftBodiesJacobi(OrbitalSim_t* sim, double dt);
+
+/**
+ * @brief Advances a timestep with the Wisdom-Holman map: half a kick by the
+ *		perturbations, a Kepler drift and another half kick. The
+ *		accelerations of the last step are reused for the first half kick,
+ *		so it needs a single force evaluation per step. The asteroids, the
+ *		SpaceShip and (with INTEGRATOR_WISDOM_HOLMAN) the massive bodies
+ *		drift around the central star in heliocentric coordinates. With
+ *		INTEGRATOR_WISDOM_HOLMAN_JACOBI the massive bodies drift in Jacobi
+ *		coordinates instead, so each Kepler orbit holds all the mass inside
+ *		it and a binary star is drifted exactly. While it is selected, the
+ *		accelerations of every body leave out what its drift accounts for.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static void stepWisdomHolman(OrbitalSim_t* sim);
+
+/**
+ * @brief Adds the jerk (time derivative of the acceleration) a body gets from another.
+ *
+ * @param body The body.
+ * @param source The body pulling it.
+ * @param jerk Where the jerk is added.
+ */
+static inline void addJerk(const Body_t* body, const Body_t* source, vector3D_t* jerk);
+
+/**
+ * @brief Gets the block level a body needs, halving dt until it is below
+ *		BLOCK_TIMESTEP_ETA |acceleration| / |jerk|.
+ *
+ * @param acceleration Acceleration of the body.
+ * @param jerk Jerk of the body.
+ * @param dt Time step of level 0.
+ *
+ * @return The level (0 to BLOCK_LEVELS_MAX).
+ */
+static inline unsigned int getBlockLevel(vector3D_t acceleration, vector3D_t jerk, double dt);
+
+/**
+ * @brief Gets the block level of every asteroid in one chunk.
+ *
+ * @param data Pointer to the simulation.
+ * @param chunk Index of the chunk.
+ */
+static void assignAsteroidsLevelsChunk(void* data, unsigned int chunk);
+
+/**
+ * @brief Assigns a block level to every asteroid chunk, sorting the asteroids
+ *		from the finest level down so every level is a prefix of the chunks.
+ *		The massive bodies always take the finest level in use.
+ *
+ * @param sim Pointer to the simulation.
+ *
+ * @return The finest level in use.
+ */
+static unsigned int assignBlockLevels(OrbitalSim_t* sim);
+
+/**
+ * @brief Advances a timestep with block timesteps: every asteroid chunk takes
+ *		kick-drift-kick leapfrog steps of dt / 2^level, and only the chunks
+ *		finishing a step are updated on each substep. With gravity between
+ *		asteroids every chunk takes the finest level, so the tree sees
+ *		every asteroid at the same time.
+ *
+ * @param sim Pointer to the simulation.
+ */
+static void stepBlockLeapfrog(OrbitalSim_t* sim);
+
+static void stepEuler(OrbitalSim_t* sim);
+static void stepLeapfrog(OrbitalSim_t* sim);
+static void stepYoshida(OrbitalSim_t* sim);
+
+// Stepping strategy of each integrator
+static void (*const integratorSteps[INTEGRATORS_AMOUNT])(OrbitalSim_t* sim) =
+{
+	stepEuler,
+	stepLeapfrog,
+	stepYoshida,
+	stepWisdomHolman,
+	stepBlockLeapfrog,
+	stepWisdomHolman
+};
+
 /**
  * @brief Add the accelerations produced by the SpaceShip's engines.
  *
@@ -99,7 +472,9 @@ static inline void updateSpeedsAndPositions(OrbitalSim_t* sim);
 static inline void updateSpaceShipUserInputs(OrbitalSim_t* sim);
 
 /**
- * @brief Removes a body of the simulation.
+ * @brief Removes the bodies absorbed by the black hole. The asteroids were
+ *		flagged by the force evaluations of this step, so they are
+ *		compacted in a single pass without measuring them again.
  * @param sim Pointer to the simulation.
  */
 static inline void removeBody(OrbitalSim_t* sim);
@@ -108,37 +483,98 @@ static inline void removeBody(OrbitalSim_t* sim);
  * Public function definitions.
  */
 
-OrbitalSim_t* constructOrbitalSim(unsigned int asteroidsNum, int easter_egg, int System, int spawnBlackHole)
+OrbitalSim_t* constructOrbitalSim(unsigned int asteroidsNum, int easter_egg, int System, int spawnBlackHole, unsigned int seed,
+				const OrbitalSimSettings_t* settings)
 {
+	BodyArrays_t* asteroids = constructBodyArrays(asteroidsNum);
+	if (!asteroids)
+		return NULL;
+
+	// Nothing reads the asteroids while constructing, so they are generated
+	// afterwards, by the thread pool of the simulation
+	OrbitalSim_t* sim = constructOrbitalSimWithAsteroids(asteroids, asteroidsNum, System, spawnBlackHole, seed, settings);
+	if (!sim)
+		return NULL;
+
+	AsteroidsGenerator_t generator = {sim->Asteroids, asteroidsNum, seed, easter_egg, sim->PlanetarySystem[0].body.mass_GC};
+	runThreadPool(sim->threadPool, generateAsteroidsChunk, &generator,
+			(asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE);
+
+	return sim;
+}
+
+OrbitalSim_t* constructOrbitalSimWithAsteroids(BodyArrays_t* asteroids, unsigned int asteroidsNum, int System, int spawnBlackHole,
+						unsigned int seed, const OrbitalSimSettings_t* settings)
+{
+	AsteroidsGravity_t asteroidsGravity = settings->asteroidsGravity;
+	Integrator_t integrator = settings->integrator;
+
 	OrbitalSim_t* sim = new OrbitalSim_t;
 	if (!sim)
+	{
+		destroyBodyArrays(asteroids);
 		return NULL;
+	}
 
 	sim->bodyNum = (System) ? ALPHACENTAURISYSTEM_BODYNUM : SOLARSYSTEM_BODYNUM;
 	sim->asteroidsNum = asteroidsNum;
 	sim->PlanetarySystem = (System) ? alphaCentauriSystem : solarSystem;
-	sim->Asteroids = (Body_t*) ((sim->asteroidsNum) ? (malloc(sizeof(Body_t) * sim->asteroidsNum)) : NULL);
-
-	if (sim->asteroidsNum && !sim->Asteroids)
+	sim->Asteroids = asteroids;
+	sim->threadPool = constructThreadPool(settings->threadsNum);
+	sim->octree = (asteroidsGravity == ASTEROIDS_GRAVITY_BARNES_HUT) ?
+			constructOctree(settings->openingAngle, ASTEROIDS_SOFTENING, ASTEROIDS_OCTREE_LEAF_SIZE) : NULL;
+	sim->fastMultipole = (asteroidsGravity == ASTEROIDS_GRAVITY_FMM) ?
+			constructFastMultipole(settings->expansionOrder, settings->openingAngle, ASTEROIDS_SOFTENING) : NULL;
+
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	sim->asteroidsReactions = (vector3D_t*) ((chunksNum) ? (calloc(chunksNum * sim->bodyNum, sizeof(vector3D_t))) : NULL);
+
+	int blockSteps = (integrator == INTEGRATOR_BLOCK_LEAPFROG && chunksNum);
+	sim->asteroidsLevels = (unsigned char*) ((blockSteps) ? malloc(sim->asteroidsNum) : NULL);
+	sim->chunksLevels = (unsigned char*) ((blockSteps) ? calloc(chunksNum, 1) : NULL);
+	sim->sortedAsteroids = (blockSteps) ? constructBodyArrays(sim->asteroidsNum) : NULL;
+	sim->asteroidsIds = (unsigned int*) ((chunksNum) ? malloc(sizeof(unsigned int) * sim->asteroidsNum) : NULL);
+	sim->sortedAsteroidsIds = (unsigned int*) ((blockSteps) ? malloc(sizeof(unsigned int) * sim->asteroidsNum) : NULL);
+
+	int absorbAsteroids = (spawnBlackHole && chunksNum);
+	sim->absorbedAsteroids = (unsigned char*) ((absorbAsteroids) ? calloc(sim->asteroidsNum, 1) : NULL);
+	sim->chunksAbsorbed = (unsigned int*) ((absorbAsteroids) ? calloc(chunksNum, sizeof(unsigned int)) : NULL);
+
+	if (!sim->Asteroids || !sim->threadPool || (chunksNum && (!sim->asteroidsReactions || !sim->asteroidsIds)) ||
+		(blockSteps && (!sim->asteroidsLevels || !sim->chunksLevels || !sim->sortedAsteroids || !sim->sortedAsteroidsIds)) ||
+		(absorbAsteroids && (!sim->absorbedAsteroids || !sim->chunksAbsorbed)) ||
+		(asteroidsGravity == ASTEROIDS_GRAVITY_BARNES_HUT && !sim->octree) ||
+		(asteroidsGravity == ASTEROIDS_GRAVITY_FMM && !sim->fastMultipole))
 	{
-		delete sim;
+		destroyOrbitalSim(sim);
 		return NULL;
 	}
 
 	sim->dt = 0.0;
 	sim->timeElapsed = 0.0;
-
+	sim->integrator = (integrator < INTEGRATORS_AMOUNT) ? integrator : INTEGRATOR_EULER;
+	sim->kick = 0.0;
+	sim->drift = 0.0;
+	sim->accelerationsValid = 0;
+	sim->asteroidsKick = 0.0;
+	sim->asteroidsDrift = 0.0;
+	sim->activeChunks = chunksNum;
+	sim->interactionsNum = 0;
+	sim->asteroidsOrder = 0;
+	sim->spaceShipEngines = 0;
 	for (unsigned int i = 0; i < sim->asteroidsNum; i++)
-	{
-		configureAsteroid(sim->Asteroids + i, sim->PlanetarySystem[0].body.mass_GC, easter_egg);
-	}
+		sim->asteroidsIds[i] = i;
+	sim->asteroidsPrecision = settings->asteroidsPrecision;
+	sim->masslessAsteroids = settings->masslessAsteroids;
+	sim->gravityKernel = getGravityKernel(settings->asteroidsPrecision, settings->masslessAsteroids);
 
 	if(spawnBlackHole)
 		sim->BlackHole = BlackHole;
 	else
 		sim->BlackHole = BlackHole_t{};
 
-	configureAsteroid(&sim->SpaceShip.body, sim->PlanetarySystem[0].body.mass_GC, 0);
+	RandomStream_t random = getRandomStream(seed, RANDOM_STREAM_SPACESHIP, 0);
+	configureAsteroid(&sim->SpaceShip.body, sim->PlanetarySystem[0].body.mass_GC, 0, &random);
 	sim->SpaceShip.color = GREEN;
 	sim->SpaceShip.radius = 120;
 	sim->SpaceShip.body.mass_GC = 5E6 * GRAVITATIONAL_CONSTANT;
@@ -150,59 +586,179 @@ void destroyOrbitalSim(OrbitalSim_t* sim)
 {
 	if (!sim)
 		return;
-	if (sim->Asteroids)
-		free(sim->Asteroids);
+	destroyBodyArrays(sim->Asteroids);
+	destroyThreadPool(sim->threadPool);
+	destroyOctree(sim->octree);
+	destroyFastMultipole(sim->fastMultipole);
+	if (sim->asteroidsReactions)
+		free(sim->asteroidsReactions);
+	if (sim->asteroidsLevels)
+		free(sim->asteroidsLevels);
+	if (sim->chunksLevels)
+		free(sim->chunksLevels);
+	destroyBodyArrays(sim->sortedAsteroids);
+	if (sim->asteroidsIds)
+		free(sim->asteroidsIds);
+	if (sim->sortedAsteroidsIds)
+		free(sim->sortedAsteroidsIds);
+	if (sim->absorbedAsteroids)
+		free(sim->absorbedAsteroids);
+	if (sim->chunksAbsorbed)
+		free(sim->chunksAbsorbed);
 	delete sim;
 }
 
 void updateOrbitalSim(OrbitalSim_t* sim, int spawnBH)
 {
-	sim->timeElapsed += sim->dt;
-	initializeAccelerations(sim);
-	updateSpaceShipUserInputs(sim);
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_UPDATE);
 
-	updateAccelerations(sim);
-	updateSpeedsAndPositions(sim);
+	sim->timeElapsed += sim->dt;
+	integratorSteps[sim->integrator](sim);
 	if(spawnBH)
+	{
+		ProfilerMark_t removeMark = beginProfilerStage(PROFILER_REMOVE_BODY);
 		removeBody(sim);
+		endProfilerStage(removeMark);
+	}
+
+	endProfilerStage(mark);
+}
+
+void readSpaceShipInputs(OrbitalSim_t* sim)
+{
+	sim->spaceShipEngines = 0;
+	for (unsigned int i = 0; i < movementKeysAmount; i++)
+		sim->spaceShipEngines |= (movementKeyIsDown[i]) ? 1U << i : 0;
+}
+
+unsigned long long getOrbitalSimHash(const OrbitalSim_t* sim)
+{
+	unsigned long long hash = hashValue(STATE_HASH_OFFSET, sim->timeElapsed);
+
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+		hash = hashBody(hash, &sim->PlanetarySystem[i].body);
+	hash = hashBody(hash, &sim->SpaceShip.body);
+	hash = hashBody(hash, &sim->BlackHole.body);
+
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	for (unsigned int i = 0; i < sim->asteroidsNum; i++)
+	{
+		hash = hashValue(hash, sim->asteroidsIds[i]);
+		hash = hashValue(hash, asteroids->x[i]);
+		hash = hashValue(hash, asteroids->y[i]);
+		hash = hashValue(hash, asteroids->z[i]);
+		hash = hashValue(hash, asteroids->vx[i]);
+		hash = hashValue(hash, asteroids->vy[i]);
+		hash = hashValue(hash, asteroids->vz[i]);
+	}
+
+	return hash;
 }
 
-static float getRandomFloat(float min, float max)
+const char* getIntegratorName(Integrator_t integrator)
 {
-	return min + (max - min) * rand() / (float)RAND_MAX;
+	return (integrator < INTEGRATORS_AMOUNT) ? integratorNames[integrator] : "Unknown";
 }
 
-static void configureAsteroid(Body_t* body, float centerMass, int easter_egg)
+double getAsteroidsGravityError(OrbitalSim_t* sim, unsigned int sampleNum)
+{
+	if (!sim->fastMultipole)
+		return -1.0;
+	return getFastMultipoleError(sim->fastMultipole, sim->Asteroids, sim->asteroidsNum, sim->threadPool, sampleNum);
+}
+
+static inline unsigned long long mixBits(unsigned long long x)
+{
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+static RandomStream_t getRandomStream(unsigned int seed, unsigned int stream, unsigned long long counter)
+{
+	RandomStream_t random = {mixBits(((unsigned long long)seed << 32) | stream), counter};
+	return random;
+}
+
+static double getRandomDouble(RandomStream_t* random, double min, double max)
+{
+	unsigned long long bits = mixBits(random->key + random->counter++ * RANDOM_GOLDEN_GAMMA);
+
+	// 52 bits plus half a step, exact in a double and strictly inside (0, 1)
+	double unit = ((double)(bits >> 12) + 0.5) * (1.0 / (1ULL << 52));
+	return min + (max - min) * unit;
+}
+
+static void configureAsteroid(Body_t* body, double centerMass, int easter_egg, RandomStream_t* random)
 {
 	// Logit distribution
-	float x = getRandomFloat(0, 1);
-	float l = logf(x) - logf(1 - x) + 1;
+	double x = getRandomDouble(random, 0, 1);
+	double l = log(x / (1 - x)) + 1;
 
 	// https://mathworld.wolfram.com/DiskPointPicking.html
-	float r = ASTEROIDS_MEAN_RADIUS * sqrtf(fabsf(l));
-	float phi = getRandomFloat(0, 2.0F * (float)M_PI);
+	double r = ASTEROIDS_MEAN_RADIUS * sqrt(fabs(l));
+	double phi = getRandomDouble(random, 0, 2.0 * M_PI);
 
 	// Surprise!
 	if (easter_egg)
 		phi = 0;
 
 	// https://en.wikipedia.org/wiki/Circular_orbit#Velocity
-	float v = sqrtf(centerMass / r) * getRandomFloat(0.6F, 1.2F);
-	float vy = getRandomFloat(-1E2F, 1E2F);
+	double v = sqrt(centerMass / r) * getRandomDouble(random, 0.6, 1.2);
+	double vy = getRandomDouble(random, -1E2, 1E2);
+	double sinPhi = sin(phi);
+	double cosPhi = cos(phi);
 
 	// Fill in with your own fields:
 	body->mass_GC = 1E12 * GRAVITATIONAL_CONSTANT;  // Typical asteroid weight: 1 billion tons
-	body->position.x = r * cosf(phi);
+	body->position.x = r * cosPhi;
 	body->position.y = 0;
-	body->position.z = r * sinf(phi);
+	body->position.z = r * sinPhi;
 
-	body->velocity.x = -v * sinf(phi);
+	body->velocity.x = -v * sinPhi;
 	body->velocity.y = vy;
-	body->velocity.z = v * cosf(phi);
+	body->velocity.z = v * cosPhi;
+}
+
+static void generateAsteroidsChunk(void* data, unsigned int chunk)
+{
+	const AsteroidsGenerator_t* generator = (const AsteroidsGenerator_t*) data;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int end = (begin + ASTEROIDS_CHUNK_SIZE < generator->asteroidsNum) ? begin + ASTEROIDS_CHUNK_SIZE : generator->asteroidsNum;
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		Body_t asteroid = Body_t{};
+		RandomStream_t random = getRandomStream(generator->seed, RANDOM_STREAM_ASTEROIDS, (unsigned long long)i * ASTEROID_RANDOM_DRAWS);
+
+		configureAsteroid(&asteroid, generator->centerMass, generator->easter_egg, &random);
+		setBody(generator->asteroids, i, &asteroid);
+	}
+}
+
+static inline unsigned long long hashValue(unsigned long long hash, double value)
+{
+	unsigned long long bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	for (unsigned int i = 0; i < sizeof(bits); i++, bits >>= 8)
+		hash = (hash ^ (bits & 0xFF)) * STATE_HASH_PRIME;
+	return hash;
+}
+
+static inline unsigned long long hashBody(unsigned long long hash, const Body_t* body)
+{
+	hash = hashValue(hash, body->position.x);
+	hash = hashValue(hash, body->position.y);
+	hash = hashValue(hash, body->position.z);
+	hash = hashValue(hash, body->velocity.x);
+	hash = hashValue(hash, body->velocity.y);
+	return hashValue(hash, body->velocity.z);
 }
 
 static inline void initializeAccelerations(OrbitalSim_t* sim)
 {
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_INITIALIZE_ACCELERATIONS);
 	unsigned int i;
 
 	for (i = 0; i < sim->bodyNum; i++)
@@ -211,13 +767,6 @@ static inline void initializeAccelerations(OrbitalSim_t* sim)
 		sim->PlanetarySystem[i].body.acceleration.y = 0.0;
 		sim->PlanetarySystem[i].body.acceleration.z = 0.0;
 	}
-	for (i = 0; i < sim->asteroidsNum; i++)
-	{
-		sim->Asteroids[i].acceleration.x = 0.0;
-		sim->Asteroids[i].acceleration.y = 0.0;
-		sim->Asteroids[i].acceleration.z = 0.0;
-	}
-
 	sim->SpaceShip.body.acceleration.x = 0.0;
 	sim->SpaceShip.body.acceleration.y = 0.0;
 	sim->SpaceShip.body.acceleration.z = 0.0;
@@ -225,8 +774,11 @@ static inline void initializeAccelerations(OrbitalSim_t* sim)
 	sim->BlackHole.body.acceleration.x = 0.0;
 	sim->BlackHole.body.acceleration.y = 0.0;
 	sim->BlackHole.body.acceleration.z = 0.0;
+
+	endProfilerStage(mark);
 }
 
+template <Pull_t PULL>
 static inline void calculateAccelerations(Body_t* body0, Body_t* body1)
 {
 	vector3D_t acceleration;
@@ -247,80 +799,669 @@ static inline void calculateAccelerations(Body_t* body0, Body_t* body1)
 	body0->acceleration.y += body1->mass_GC * acceleration.y;
 	body0->acceleration.z += body1->mass_GC * acceleration.z;
 
+	if (PULL == PULL_ONE_WAY)
+		return;
 	body1->acceleration.x -= body0->mass_GC * acceleration.x;
 	body1->acceleration.y -= body0->mass_GC * acceleration.y;
 	body1->acceleration.z -= body0->mass_GC * acceleration.z;
 }
 
-static inline void calculateAccelerationsOneWay(Body_t* body0, Body_t* body1)
+static inline void updateAccelerations(OrbitalSim_t* sim)
 {
-	vector3D_t acceleration;
-	double inverse_distance_cubed;
-
-	acceleration.x = body1->position.x - body0->position.x;
-	acceleration.y = body1->position.y - body0->position.y;
-	acceleration.z = body1->position.z - body0->position.z;
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_UPDATE_ACCELERATIONS);
+	unsigned int i = 0, j;
 
-	inverse_distance_cubed = 1 / sqrt(DOT_PRODUCT(acceleration, acceleration));
-	inverse_distance_cubed = inverse_distance_cubed * inverse_distance_cubed * inverse_distance_cubed;
+	// Wisdom-Holman: the star is felt through the Kepler drifts, it only feels the rest.
+	// In Jacobi coordinates the massive bodies feel it, the drifts only hold part of it.
+	if ((sim->integrator == INTEGRATOR_WISDOM_HOLMAN || sim->integrator == INTEGRATOR_WISDOM_HOLMAN_JACOBI) && sim->bodyNum)
+	{
+		for (j = 1; j < sim->bodyNum; j++)
+		{
+			if (sim->integrator == INTEGRATOR_WISDOM_HOLMAN_JACOBI)
+				calculateAccelerations<PULL_TWO_WAY>(&sim->PlanetarySystem[0].body, &sim->PlanetarySystem[j].body);
+			else
+				calculateAccelerations<PULL_ONE_WAY>(&sim->PlanetarySystem[0].body, &sim->PlanetarySystem[j].body);
+		}
+		calculateAccelerations<PULL_ONE_WAY>(&sim->PlanetarySystem[0].body, &sim->SpaceShip.body);
+		calculateAccelerations<PULL_ONE_WAY>(&sim->PlanetarySystem[0].body, &sim->BlackHole.body);
+		i = 1;
+	}
 
-	acceleration.x *= inverse_distance_cubed;
-	acceleration.y *= inverse_distance_cubed;
-	acceleration.z *= inverse_distance_cubed;
+	for (; i < sim->bodyNum; i++)
+	{
+		for (j = i + 1; j < sim->bodyNum; j++)
+		{
+			calculateAccelerations<PULL_TWO_WAY>(&sim->PlanetarySystem[i].body, &sim->PlanetarySystem[j].body);
+		}
+		calculateAccelerations<PULL_TWO_WAY>(&sim->PlanetarySystem[i].body, &sim->SpaceShip.body);
+		calculateAccelerations<PULL_ONE_WAY>(&sim->PlanetarySystem[i].body, &sim->BlackHole.body);
+	}
 
-	body0->acceleration.x += body1->mass_GC * acceleration.x;
-	body0->acceleration.y += body1->mass_GC * acceleration.y;
-	body0->acceleration.z += body1->mass_GC * acceleration.z;
+	endProfilerStage(mark);
 }
 
-static inline void updateAccelerations(OrbitalSim_t* sim)
+static void updateAsteroidsChunk(void* data, unsigned int chunk)
 {
-	unsigned int i, j;
+	OrbitalSim_t* sim = (OrbitalSim_t*)data;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int end = (begin + ASTEROIDS_CHUNK_SIZE < sim->asteroidsNum) ? begin + ASTEROIDS_CHUNK_SIZE : sim->asteroidsNum;
 
-	for (i = 0; i < sim->bodyNum; i++)
+	if (sim->octree)
 	{
-		for (j = 0; j < sim->asteroidsNum; j++)
+		// The octree holds the positions at the start of the step
+		for (unsigned int i = begin; i < end; i++)
 		{
-			calculateAccelerations(&sim->PlanetarySystem[i].body, sim->Asteroids + j);
-		}
-		for (j = i + 1; j < sim->bodyNum; j++)
-		{
-			calculateAccelerations(&sim->PlanetarySystem[i].body, &sim->PlanetarySystem[j].body);
+			vector3D_t position = {sim->Asteroids->x[i], sim->Asteroids->y[i], sim->Asteroids->z[i]};
+			vector3D_t acceleration = getOctreeAcceleration(sim->octree, position, i);
+
+			sim->Asteroids->ax[i] = acceleration.x;
+			sim->Asteroids->ay[i] = acceleration.y;
+			sim->Asteroids->az[i] = acceleration.z;
 		}
-		calculateAccelerations(&sim->PlanetarySystem[i].body, &sim->SpaceShip.body);
-		calculateAccelerationsOneWay(&sim->PlanetarySystem[i].body, &sim->BlackHole.body);
 	}
-	for (j = 0; j < sim->asteroidsNum; j++)
+
+	// Each level steps half as long as the one before
+	int level = (sim->chunksLevels) ? sim->chunksLevels[chunk] : 0;
+
+	// Massless asteroids only feel the bodies, the test particle kernels leave the reactions out
+	unsigned int reactingNum = (sim->masslessAsteroids) ? 0 : sim->bodyNum;
+
+	sim->gravityKernel(sim->gravitySources, sim->bodyNum + 1, reactingNum, sim->Asteroids, begin, end,
+			ldexp(sim->asteroidsKick, -level), ldexp(sim->asteroidsDrift, -level),
+			sim->octree || sim->fastMultipole, sim->asteroidsReactions + chunk * sim->bodyNum);
+
+	if (sim->absorbedAsteroids)
+		sim->chunksAbsorbed[chunk] += flagAbsorbedAsteroids(sim, begin, end);
+}
+
+static inline unsigned int flagAbsorbedAsteroids(OrbitalSim_t* sim, unsigned int begin, unsigned int end)
+{
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	double absorbRadius_squared = sim->BlackHole.absorbRadius * sim->BlackHole.absorbRadius;
+	unsigned int flagged = 0;
+
+	for (unsigned int i = begin; i < end; i++)
 	{
-		calculateAccelerationsOneWay(sim->Asteroids + j, &sim->BlackHole.body);
+		vector3D_t diff = {asteroids->x[i] - sim->absorbCenter.x,
+				asteroids->y[i] - sim->absorbCenter.y,
+				asteroids->z[i] - sim->absorbCenter.z};
+
+		if (sim->absorbedAsteroids[i] || DOT_PRODUCT(diff, diff) > absorbRadius_squared)
+			continue;
+
+		sim->absorbedAsteroids[i] = 1;
+		flagged++;
 	}
+
+	return flagged;
 }
 
-static inline void calculateSpeedAndPosition(Body_t* body, double dt)
+static inline void updateAsteroids(OrbitalSim_t* sim)
 {
-	body->velocity.x += body->acceleration.x * dt;
-	body->velocity.y += body->acceleration.y * dt;
-	body->velocity.z += body->acceleration.z * dt;
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_UPDATE_ASTEROIDS);
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+
+	// Every body pulls the asteroids, only the black hole does not feel them back
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+	{
+		sim->gravitySources[i].position = sim->PlanetarySystem[i].body.position;
+		sim->gravitySources[i].mass_GC = sim->PlanetarySystem[i].body.mass_GC;
+	}
+	sim->gravitySources[sim->bodyNum].position = sim->BlackHole.body.position;
+	sim->gravitySources[sim->bodyNum].mass_GC = sim->BlackHole.body.mass_GC;
+
+	// Where the black hole ends up once this evaluation moves it, its acceleration is already known
+	const Body_t* blackHole = &sim->BlackHole.body;
+	sim->absorbCenter.x = blackHole->position.x + (blackHole->velocity.x + blackHole->acceleration.x * sim->kick) * sim->drift;
+	sim->absorbCenter.y = blackHole->position.y + (blackHole->velocity.y + blackHole->acceleration.y * sim->kick) * sim->drift;
+	sim->absorbCenter.z = blackHole->position.z + (blackHole->velocity.z + blackHole->acceleration.z * sim->kick) * sim->drift;
+
+	// Wisdom-Holman: the star does not pull, but still feels the asteroids
+	if ((sim->integrator == INTEGRATOR_WISDOM_HOLMAN || sim->integrator == INTEGRATOR_WISDOM_HOLMAN_JACOBI) && sim->bodyNum)
+		sim->gravitySources[0].mass_GC = 0.0;
+
+	// Without memory the asteroids only lose their own pull for this step
+	if (sim->octree)
+		buildOctree(sim->octree, sim->Asteroids, sim->asteroidsNum);
+	if (sim->fastMultipole)
+		evaluateFastMultipole(sim->fastMultipole, sim->Asteroids, sim->asteroidsNum, sim->threadPool,
+					sim->Asteroids->ax, sim->Asteroids->ay, sim->Asteroids->az);
+
+	runThreadPool(sim->threadPool, updateAsteroidsChunk, sim, sim->activeChunks);
+
+	// Reduced in chunk order, whichever thread updated each chunk. Chunks
+	// left out of this evaluation still pull with their last reaction.
+	// Massless asteroids never pull, so there is nothing to reduce.
+	unsigned int reactingNum = (sim->masslessAsteroids) ? 0 : sim->bodyNum;
+	for (unsigned int i = 0; i < reactingNum; i++)
+	{
+		for (unsigned int chunk = 0; chunk < chunksNum; chunk++)
+		{
+			vector3D_t* reaction = sim->asteroidsReactions + chunk * sim->bodyNum + i;
 
-	body->position.x += body->velocity.x * dt;
-	body->position.y += body->velocity.y * dt;
-	body->position.z += body->velocity.z * dt;
+			sim->PlanetarySystem[i].body.acceleration.x += reaction->x;
+			sim->PlanetarySystem[i].body.acceleration.y += reaction->y;
+			sim->PlanetarySystem[i].body.acceleration.z += reaction->z;
+		}
+	}
+
+	endProfilerStage(mark);
+}
+
+static inline void calculateSpeedAndPosition(Body_t* body, double kick, double drift)
+{
+	body->velocity.x += body->acceleration.x * kick;
+	body->velocity.y += body->acceleration.y * kick;
+	body->velocity.z += body->acceleration.z * kick;
+
+	body->position.x += body->velocity.x * drift;
+	body->position.y += body->velocity.y * drift;
+	body->position.z += body->velocity.z * drift;
 }
 
 static inline void updateSpeedsAndPositions(OrbitalSim_t* sim)
 {
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_UPDATE_SPEEDS_AND_POSITIONS);
 	unsigned int i;
 
 	for (i = 0; i < sim->bodyNum; i++)
 	{
-		calculateSpeedAndPosition(&sim->PlanetarySystem[i].body, sim->dt);
+		calculateSpeedAndPosition(&sim->PlanetarySystem[i].body, sim->kick, sim->drift);
+	}
+	calculateSpeedAndPosition(&sim->SpaceShip.body, sim->kick, sim->drift);
+	calculateSpeedAndPosition(&sim->BlackHole.body, sim->kick, sim->drift);
+
+	endProfilerStage(mark);
+}
+
+static void evaluateActiveForces(OrbitalSim_t* sim)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned int activeAsteroids = sim->activeChunks * ASTEROIDS_CHUNK_SIZE;
+
+	initializeAccelerations(sim);
+	updateSpaceShipUserInputs(sim);
+
+	updateAccelerations(sim);
+	updateAsteroids(sim);
+	if (sim->integrator == INTEGRATOR_WISDOM_HOLMAN_JACOBI && sim->bodyNum)
+		subtractJacobiKeplerAccelerations(sim);
+	updateSpeedsAndPositions(sim);
+
+	// Pairs of massive bodies, plus the spaceship and the black hole, plus every active asteroid with every source
+	activeAsteroids = (activeAsteroids < sim->asteroidsNum) ? activeAsteroids : sim->asteroidsNum;
+	sim->interactionsNum += (unsigned long long)sim->bodyNum * (sim->bodyNum + 3) / 2 +
+				(unsigned long long)activeAsteroids * (sim->bodyNum + 1);
+
+	// Only true when every body was evaluated and nothing drifted after it
+	sim->accelerationsValid = (sim->drift == 0.0 && sim->asteroidsDrift == 0.0 && sim->activeChunks == chunksNum);
+}
+
+static void evaluateForces(OrbitalSim_t* sim, double kick, double drift)
+{
+	sim->kick = sim->asteroidsKick = kick;
+	sim->drift = sim->asteroidsDrift = drift;
+	sim->activeChunks = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+
+	evaluateActiveForces(sim);
+}
+
+static void kickDriftAsteroidsChunk(void* data, unsigned int chunk)
+{
+	OrbitalSim_t* sim = (OrbitalSim_t*)data;
+	BodyArrays_t* asteroids = sim->Asteroids;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int end = (begin + ASTEROIDS_CHUNK_SIZE < sim->asteroidsNum) ? begin + ASTEROIDS_CHUNK_SIZE : sim->asteroidsNum;
+	int level = (sim->chunksLevels) ? sim->chunksLevels[chunk] : 0;
+	double kick = ldexp(sim->asteroidsKick, -level);
+	double drift = ldexp(sim->asteroidsDrift, -level);
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		asteroids->vx[i] += asteroids->ax[i] * kick;
+		asteroids->vy[i] += asteroids->ay[i] * kick;
+		asteroids->vz[i] += asteroids->az[i] * kick;
+
+		asteroids->x[i] += asteroids->vx[i] * drift;
+		asteroids->y[i] += asteroids->vy[i] * drift;
+		asteroids->z[i] += asteroids->vz[i] * drift;
+	}
+}
+
+static void driftBodies(OrbitalSim_t* sim, double drift)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+
+	sim->kick = sim->asteroidsKick = 0.0;
+	sim->drift = sim->asteroidsDrift = drift;
+	updateSpeedsAndPositions(sim);
+	runThreadPool(sim->threadPool, kickDriftAsteroidsChunk, sim, chunksNum);
+	sim->accelerationsValid = 0;
+}
+
+static void stepSymplectic(OrbitalSim_t* sim, const SymplecticScheme_t* scheme)
+{
+	if (scheme->leadingDrift != 0.0)
+		driftBodies(sim, scheme->leadingDrift * sim->dt);
+
+	for (unsigned int i = 0; i < scheme->stagesNum; i++)
+		evaluateForces(sim, scheme->kicks[i] * sim->dt, scheme->drifts[i] * sim->dt);
+}
+
+static inline void driftAroundStar(const Body_t* star, double mu, vector3D_t* position, vector3D_t* velocity, double dt)
+{
+	vector3D_t relativePosition = {position->x - star->position.x,
+					position->y - star->position.y,
+					position->z - star->position.z};
+	vector3D_t relativeVelocity = {velocity->x - star->velocity.x,
+					velocity->y - star->velocity.y,
+					velocity->z - star->velocity.z};
+
+	driftKepler(mu, &relativePosition, &relativeVelocity, dt);
+
+	position->x = star->position.x + star->velocity.x * dt + relativePosition.x;
+	position->y = star->position.y + star->velocity.y * dt + relativePosition.y;
+	position->z = star->position.z + star->velocity.z * dt + relativePosition.z;
+
+	velocity->x = star->velocity.x + relativeVelocity.x;
+	velocity->y = star->velocity.y + relativeVelocity.y;
+	velocity->z = star->velocity.z + relativeVelocity.z;
+}
+
+static void kickDriftAsteroidsKeplerChunk(void* data, unsigned int chunk)
+{
+	OrbitalSim_t* sim = (OrbitalSim_t*)data;
+	BodyArrays_t* asteroids = sim->Asteroids;
+	const Body_t* star = &sim->PlanetarySystem[0].body;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int end = (begin + ASTEROIDS_CHUNK_SIZE < sim->asteroidsNum) ? begin + ASTEROIDS_CHUNK_SIZE : sim->asteroidsNum;
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		vector3D_t position = {asteroids->x[i], asteroids->y[i], asteroids->z[i]};
+		vector3D_t velocity = {asteroids->vx[i] + asteroids->ax[i] * sim->kick,
+					asteroids->vy[i] + asteroids->ay[i] * sim->kick,
+					asteroids->vz[i] + asteroids->az[i] * sim->kick};
+
+		driftAroundStar(star, star->mass_GC, &position, &velocity, sim->drift);
+
+		asteroids->x[i] = position.x;
+		asteroids->y[i] = position.y;
+		asteroids->z[i] = position.z;
+		asteroids->vx[i] = velocity.x;
+		asteroids->vy[i] = velocity.y;
+		asteroids->vz[i] = velocity.z;
+	}
+}
+
+static void transformToJacobi(const EphemeridesBody_t* bodies, unsigned int bodyNum, const vector3D_t* inertial,
+				vector3D_t* jacobi)
+{
+	if (!bodyNum)
+		return;
+
+	// Mass weighted sum of the bodies so far, and their mass
+	vector3D_t sum = {bodies[0].body.mass_GC * inertial[0].x,
+				bodies[0].body.mass_GC * inertial[0].y,
+				bodies[0].body.mass_GC * inertial[0].z};
+	double mass = bodies[0].body.mass_GC;
+
+	for (unsigned int i = 1; i < bodyNum; i++)
+	{
+		double mass_GC = bodies[i].body.mass_GC;
+
+		jacobi[i].x = inertial[i].x - sum.x / mass;
+		jacobi[i].y = inertial[i].y - sum.y / mass;
+		jacobi[i].z = inertial[i].z - sum.z / mass;
+
+		sum.x += mass_GC * inertial[i].x;
+		sum.y += mass_GC * inertial[i].y;
+		sum.z += mass_GC * inertial[i].z;
+		mass += mass_GC;
+	}
+
+	jacobi[0].x = sum.x / mass;
+	jacobi[0].y = sum.y / mass;
+	jacobi[0].z = sum.z / mass;
+}
+
+static void transformFromJacobi(const EphemeridesBody_t* bodies, unsigned int bodyNum, const vector3D_t* jacobi,
+				vector3D_t* inertial)
+{
+	double mass = 0.0;
+
+	if (!bodyNum)
+		return;
+	for (unsigned int i = 0; i < bodyNum; i++)
+		mass += bodies[i].body.mass_GC;
+
+	// Peeled from the outside in: the center of mass of the bodies before each one
+	vector3D_t center = jacobi[0];
+	for (unsigned int i = bodyNum - 1; i > 0; i--)
+	{
+		double mass_GC = bodies[i].body.mass_GC;
+
+		center.x -= mass_GC * jacobi[i].x / mass;
+		center.y -= mass_GC * jacobi[i].y / mass;
+		center.z -= mass_GC * jacobi[i].z / mass;
+
+		inertial[i].x = center.x + jacobi[i].x;
+		inertial[i].y = center.y + jacobi[i].y;
+		inertial[i].z = center.z + jacobi[i].z;
+		mass -= mass_GC;
+	}
+
+	inertial[0] = center;
+}
+
+static void subtractJacobiKeplerAccelerations(OrbitalSim_t* sim)
+{
+	vector3D_t positions[GRAVITY_SOURCES_MAX];
+	vector3D_t jacobi[GRAVITY_SOURCES_MAX];
+	vector3D_t kepler[GRAVITY_SOURCES_MAX];
+	vector3D_t accelerations[GRAVITY_SOURCES_MAX];
+	double mass = sim->PlanetarySystem[0].body.mass_GC;
+
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+		positions[i] = sim->PlanetarySystem[i].body.position;
+	transformToJacobi(sim->PlanetarySystem, sim->bodyNum, positions, jacobi);
+
+	// The Kepler pull, with the opposite sign, on each Jacobi body. The center of mass feels none.
+	kepler[0].x = kepler[0].y = kepler[0].z = 0.0;
+	for (unsigned int i = 1; i < sim->bodyNum; i++)
+	{
+		mass += sim->PlanetarySystem[i].body.mass_GC;
+
+		double inverse_distance = 1.0 / sqrt(DOT_PRODUCT(jacobi[i], jacobi[i]));
+		double factor = mass * inverse_distance * inverse_distance * inverse_distance;
+
+		kepler[i].x = jacobi[i].x * factor;
+		kepler[i].y = jacobi[i].y * factor;
+		kepler[i].z = jacobi[i].z * factor;
+	}
+	transformFromJacobi(sim->PlanetarySystem, sim->bodyNum, kepler, accelerations);
+
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+	{
+		sim->PlanetarySystem[i].body.acceleration.x += accelerations[i].x;
+		sim->PlanetarySystem[i].body.acceleration.y += accelerations[i].y;
+		sim->PlanetarySystem[i].body.acceleration.z += accelerations[i].z;
+	}
+}
+
+static void driftBodiesJacobi(OrbitalSim_t* sim, double dt)
+{
+	vector3D_t positions[GRAVITY_SOURCES_MAX], velocities[GRAVITY_SOURCES_MAX];
+	vector3D_t jacobiPositions[GRAVITY_SOURCES_MAX], jacobiVelocities[GRAVITY_SOURCES_MAX];
+	double mass = sim->PlanetarySystem[0].body.mass_GC;
+
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+	{
+		positions[i] = sim->PlanetarySystem[i].body.position;
+		velocities[i] = sim->PlanetarySystem[i].body.velocity;
+	}
+	transformToJacobi(sim->PlanetarySystem, sim->bodyNum, positions, jacobiPositions);
+	transformToJacobi(sim->PlanetarySystem, sim->bodyNum, velocities, jacobiVelocities);
+
+	for (unsigned int i = 1; i < sim->bodyNum; i++)
+	{
+		mass += sim->PlanetarySystem[i].body.mass_GC;
+		driftKepler(mass, &jacobiPositions[i], &jacobiVelocities[i], dt);
+	}
+	jacobiPositions[0].x += jacobiVelocities[0].x * dt;
+	jacobiPositions[0].y += jacobiVelocities[0].y * dt;
+	jacobiPositions[0].z += jacobiVelocities[0].z * dt;
+
+	transformFromJacobi(sim->PlanetarySystem, sim->bodyNum, jacobiPositions, positions);
+	transformFromJacobi(sim->PlanetarySystem, sim->bodyNum, jacobiVelocities, velocities);
+	for (unsigned int i = 0; i < sim->bodyNum; i++)
+	{
+		sim->PlanetarySystem[i].body.position = positions[i];
+		sim->PlanetarySystem[i].body.velocity = velocities[i];
+	}
+}
+
+static void stepWisdomHolman(OrbitalSim_t* sim)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	double halfStep = sim->dt / 2;
+	Body_t* star;
+
+	// Without a star to orbit there is nothing to split
+	if (!sim->bodyNum)
+	{
+		stepLeapfrog(sim);
+		return;
+	}
+	star = &sim->PlanetarySystem[0].body;
+
+	if (!sim->accelerationsValid)
+		evaluateForces(sim, 0.0, 0.0);
+
+	// First half kick, with the accelerations at the start of the step
+	sim->kick = halfStep;
+	sim->drift = 0.0;
+	updateSpeedsAndPositions(sim);
+
+	// Kepler drift, the star keeps its position until every body has used it
+	sim->kick = halfStep;
+	sim->drift = sim->dt;
+	runThreadPool(sim->threadPool, kickDriftAsteroidsKeplerChunk, sim, chunksNum);
+
+	driftAroundStar(star, star->mass_GC, &sim->SpaceShip.body.position, &sim->SpaceShip.body.velocity, sim->dt);
+	calculateSpeedAndPosition(&sim->BlackHole.body, 0.0, sim->dt);
+	if (sim->integrator == INTEGRATOR_WISDOM_HOLMAN_JACOBI)
+		driftBodiesJacobi(sim, sim->dt);
+	else
+	{
+		for (unsigned int i = 1; i < sim->bodyNum; i++)
+		{
+			Body_t* body = &sim->PlanetarySystem[i].body;
+			driftAroundStar(star, star->mass_GC, &body->position, &body->velocity, sim->dt);
+		}
+		calculateSpeedAndPosition(star, 0.0, sim->dt);
+	}
+
+	// Second half kick, its accelerations are reused by the next step
+	evaluateForces(sim, halfStep, 0.0);
+}
+
+static inline void addJerk(const Body_t* body, const Body_t* source, vector3D_t* jerk)
+{
+	vector3D_t distance, velocity;
+	double inverse_distance_squared, inverse_distance_cubed, radial;
+
+	distance.x = source->position.x - body->position.x;
+	distance.y = source->position.y - body->position.y;
+	distance.z = source->position.z - body->position.z;
+
+	velocity.x = source->velocity.x - body->velocity.x;
+	velocity.y = source->velocity.y - body->velocity.y;
+	velocity.z = source->velocity.z - body->velocity.z;
+
+	inverse_distance_squared = 1 / DOT_PRODUCT(distance, distance);
+	inverse_distance_cubed = source->mass_GC * inverse_distance_squared * sqrt(inverse_distance_squared);
+	radial = 3 * DOT_PRODUCT(distance, velocity) * inverse_distance_squared;
+
+	jerk->x += inverse_distance_cubed * (velocity.x - radial * distance.x);
+	jerk->y += inverse_distance_cubed * (velocity.y - radial * distance.y);
+	jerk->z += inverse_distance_cubed * (velocity.z - radial * distance.z);
+}
+
+static inline unsigned int getBlockLevel(vector3D_t acceleration, vector3D_t jerk, double dt)
+{
+	double jerk_squared = DOT_PRODUCT(jerk, jerk);
+	double step = fabs(dt);
+	unsigned int level = 0;
+
+	if (jerk_squared == 0.0)
+		return 0;
+
+	double timestep = BLOCK_TIMESTEP_ETA * sqrt(DOT_PRODUCT(acceleration, acceleration) / jerk_squared);
+	for (; level < BLOCK_LEVELS_MAX && step > timestep; level++)
+		step /= 2;
+
+	return level;
+}
+
+static void assignAsteroidsLevelsChunk(void* data, unsigned int chunk)
+{
+	OrbitalSim_t* sim = (OrbitalSim_t*)data;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int end = (begin + ASTEROIDS_CHUNK_SIZE < sim->asteroidsNum) ? begin + ASTEROIDS_CHUNK_SIZE : sim->asteroidsNum;
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		Body_t asteroid = getBody(sim->Asteroids, i);
+		vector3D_t jerk = {0.0, 0.0, 0.0};
+
+		for (unsigned int j = 0; j < sim->bodyNum; j++)
+			addJerk(&asteroid, &sim->PlanetarySystem[j].body, &jerk);
+		addJerk(&asteroid, &sim->BlackHole.body, &jerk);
+
+		sim->asteroidsLevels[i] = (unsigned char) getBlockLevel(asteroid.acceleration, jerk, sim->dt);
+	}
+}
+
+static unsigned int assignBlockLevels(OrbitalSim_t* sim)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned int levelsNum[BLOCK_LEVELS_MAX + 1] = {0};
+	unsigned int maxLevel = 0, level, i, j;
+	int sorted = 1;
+
+	for (i = 0; i < sim->bodyNum; i++)
+	{
+		vector3D_t jerk = {0.0, 0.0, 0.0};
+		Body_t* body = &sim->PlanetarySystem[i].body;
+
+		for (j = 0; j < sim->bodyNum; j++)
+		{
+			if (j != i)
+				addJerk(body, &sim->PlanetarySystem[j].body, &jerk);
+		}
+		addJerk(body, &sim->SpaceShip.body, &jerk);
+		addJerk(body, &sim->BlackHole.body, &jerk);
+
+		level = getBlockLevel(body->acceleration, jerk, sim->dt);
+		maxLevel = (level > maxLevel) ? level : maxLevel;
 	}
+
+	if (!chunksNum)
+		return maxLevel;
+
+	runThreadPool(sim->threadPool, assignAsteroidsLevelsChunk, sim, chunksNum);
+
 	for (i = 0; i < sim->asteroidsNum; i++)
 	{
-		calculateSpeedAndPosition(sim->Asteroids + i, sim->dt);
+		levelsNum[sim->asteroidsLevels[i]]++;
+		if (i && sim->asteroidsLevels[i] > sim->asteroidsLevels[i - 1])
+			sorted = 0;
+	}
+
+	// Stable counting sort, finest level first
+	if (!sorted)
+	{
+		unsigned int next[BLOCK_LEVELS_MAX + 1];
+
+		for (level = BLOCK_LEVELS_MAX + 1, j = 0; level-- > 0; j += levelsNum[level])
+			next[level] = j;
+
+		for (i = 0; i < sim->asteroidsNum; i++)
+		{
+			Body_t asteroid = getBody(sim->Asteroids, i);
+			j = next[sim->asteroidsLevels[i]]++;
+			setBody(sim->sortedAsteroids, j, &asteroid);
+			sim->sortedAsteroidsIds[j] = sim->asteroidsIds[i];
+		}
+
+		BodyArrays_t* asteroids = sim->Asteroids;
+		sim->Asteroids = sim->sortedAsteroids;
+		sim->sortedAsteroids = asteroids;
+		unsigned int* ids = sim->asteroidsIds;
+		sim->asteroidsIds = sim->sortedAsteroidsIds;
+		sim->sortedAsteroidsIds = ids;
+		sim->asteroidsOrder++;
+
+		for (level = BLOCK_LEVELS_MAX + 1, j = 0; level-- > 0;)
+		{
+			for (i = 0; i < levelsNum[level]; i++)
+				sim->asteroidsLevels[j++] = (unsigned char) level;
+		}
+	}
+
+	for (i = 0; i < chunksNum; i++)
+		sim->chunksLevels[i] = sim->asteroidsLevels[i * ASTEROIDS_CHUNK_SIZE];
+	maxLevel = (sim->chunksLevels[0] > maxLevel) ? sim->chunksLevels[0] : maxLevel;
+
+	if (sim->octree || sim->fastMultipole)
+	{
+		for (i = 0; i < chunksNum; i++)
+			sim->chunksLevels[i] = (unsigned char) maxLevel;
 	}
-	calculateSpeedAndPosition(&sim->SpaceShip.body, sim->dt);
-	calculateSpeedAndPosition(&sim->BlackHole.body, sim->dt);
+
+	return maxLevel;
+}
+
+static void stepBlockLeapfrog(OrbitalSim_t* sim)
+{
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned int maxLevel, substepsNum, substep, minLevel, step;
+
+	if (!sim->accelerationsValid)
+		evaluateForces(sim, 0.0, 0.0);
+
+	maxLevel = assignBlockLevels(sim);
+	substepsNum = 1U << maxLevel;
+
+	// Opening half kicks, the asteroids also drift to the end of their first step
+	sim->kick = ldexp(sim->dt, -(int)maxLevel) / 2;
+	sim->drift = 0.0;
+	updateSpeedsAndPositions(sim);
+
+	sim->asteroidsKick = sim->dt / 2;
+	sim->asteroidsDrift = sim->dt;
+	runThreadPool(sim->threadPool, kickDriftAsteroidsChunk, sim, chunksNum);
+
+	for (substep = 1; substep <= substepsNum; substep++)
+	{
+		int last = (substep == substepsNum);
+
+		sim->kick = 0.0;
+		sim->drift = ldexp(sim->dt, -(int)maxLevel);
+		updateSpeedsAndPositions(sim);
+
+		// Levels finishing a step now: dt / 2^level divides the elapsed time
+		for (minLevel = maxLevel, step = substep; !(step & 1); step >>= 1)
+			minLevel--;
+		for (sim->activeChunks = 0; sim->activeChunks < chunksNum; sim->activeChunks++)
+		{
+			if (sim->chunksLevels[sim->activeChunks] < minLevel)
+				break;
+		}
+
+		// Closing half kick plus the opening half kick of the next step
+		sim->kick = (last) ? sim->drift / 2 : sim->drift;
+		sim->drift = 0.0;
+		sim->asteroidsKick = (last) ? sim->dt / 2 : sim->dt;
+		sim->asteroidsDrift = (last) ? 0.0 : sim->dt;
+		evaluateActiveForces(sim);
+	}
+}
+
+static void stepEuler(OrbitalSim_t* sim)
+{
+	stepSymplectic(sim, &eulerScheme);
+}
+
+static void stepLeapfrog(OrbitalSim_t* sim)
+{
+	stepSymplectic(sim, &leapfrogScheme);
+}
+
+static void stepYoshida(OrbitalSim_t* sim)
+{
+	stepSymplectic(sim, &yoshidaScheme);
 }
 
 static inline void updateSpaceShipUserInputs(OrbitalSim_t* sim)
@@ -331,7 +1472,7 @@ static inline void updateSpaceShipUserInputs(OrbitalSim_t* sim)
 	{
 		// i = 0,1,2 Para los ejes en sentido positivo (teclas U, I y O)
 		// i = 3,4,5 Para los ejes en sentido negativo (teclas J, K y L)
-		if (movementKeyIsDown[i])
+		if (sim->spaceShipEngines & (1U << i))
 		{
 			acceleration[axis] += (i < 3) ? SpaceShip_ACCELERATION : -SpaceShip_ACCELERATION;
 		}
@@ -341,11 +1482,11 @@ static inline void updateSpaceShipUserInputs(OrbitalSim_t* sim)
 static inline void removeBody (OrbitalSim_t* sim)
 {
 	vector3D_t diff;
-	unsigned int i, j;
+	unsigned int i, kept;
 	double distance_squared;
 	double absorbRadius_squared = sim->BlackHole.absorbRadius * sim->BlackHole.absorbRadius;
 
-	for(i = 0; i < sim->bodyNum; i++)
+	for(i = 0, kept = 0; i < sim->bodyNum; i++)
 	{
 		diff.x = sim->PlanetarySystem[i].body.position.x - sim->BlackHole.body.position.x;
 		diff.y = sim->PlanetarySystem[i].body.position.y - sim->BlackHole.body.position.y;
@@ -354,33 +1495,40 @@ static inline void removeBody (OrbitalSim_t* sim)
 		distance_squared = DOT_PRODUCT(diff, diff);
 
 		if(distance_squared > absorbRadius_squared)
-			continue;
-
-		for(j = i; j < sim->bodyNum - 1; j++)
 		{
-			sim->PlanetarySystem[j] = sim->PlanetarySystem[j+1];
+			if (kept != i)
+				sim->PlanetarySystem[kept] = sim->PlanetarySystem[i];
+			kept++;
 		}
-		sim->bodyNum--;
-		i--;
 	}
+	if (kept != sim->bodyNum)
+		sim->accelerationsValid = 0;	// The others still feel the absorbed body
+	sim->bodyNum = kept;
 
-	for(i = 0; i < sim->asteroidsNum; i++)
-	{
-		diff.x = sim->Asteroids[i].position.x - sim->BlackHole.body.position.x;
-		diff.y = sim->Asteroids[i].position.y - sim->BlackHole.body.position.y;
-		diff.z = sim->Asteroids[i].position.z - sim->BlackHole.body.position.z;
+	if (!sim->absorbedAsteroids)
+		return;
 
-		distance_squared = DOT_PRODUCT(diff, diff);
+	// Only the chunks that flagged something are visited
+	unsigned int chunksNum = (sim->asteroidsNum + ASTEROIDS_CHUNK_SIZE - 1) / ASTEROIDS_CHUNK_SIZE;
+	unsigned int chunk = 0;
 
-		if(distance_squared > absorbRadius_squared)
-			continue;
+	while (chunk < chunksNum && !sim->chunksAbsorbed[chunk])
+		chunk++;
+	if (chunk == chunksNum)
+		return;
 
-		for(j = i; j < sim->asteroidsNum - 1; j++)
-		{
-			sim->Asteroids[j] = sim->Asteroids[j+1];
-		}
-		sim->asteroidsNum--;
-		i--;
+	unsigned int begin = chunk * ASTEROIDS_CHUNK_SIZE;
+	unsigned int asteroidsNum = compactBodyArrays(sim->Asteroids, sim->absorbedAsteroids, begin, sim->asteroidsNum);
+
+	for (i = begin, kept = begin; i < sim->asteroidsNum; i++)
+	{
+		if (!sim->absorbedAsteroids[i])
+			sim->asteroidsIds[kept++] = sim->asteroidsIds[i];
 	}
-	
+
+	memset(sim->absorbedAsteroids + begin, 0, sim->asteroidsNum - begin);
+	memset(sim->chunksAbsorbed, 0, sizeof(unsigned int) * chunksNum);
+	sim->asteroidsNum = asteroidsNum;
+	sim->asteroidsOrder++;
+	sim->accelerationsValid = 0;
 }
\ No newline at end of file
@@ -0,0 +1,259 @@
+/**
+ * @brief Physics thread, decoupled from the render loop
+ *
+ * The view reads snapshots through a triple buffer: the physics thread fills
+ * its back snapshot and swaps it with the middle one, the view swaps its front
+ * snapshot with the middle one when it holds a newer state. Neither side ever
+ * waits for the other. A new snapshot is only copied once the view took the
+ * previous one, so copying costs at most one snapshot per frame.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "physicsThread.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <math.h>
+#include <string.h>
+
+#define SNAPSHOTS_AMOUNT 3
+#define SNAPSHOT_INDEX_MASK 0x3U
+#define SNAPSHOT_FRESH 0x4U		// Set in middle while the view has not taken it
+
+// Real time the physics thread may owe before it drops it and runs in slow motion [s]
+#define PHYSICS_MAX_LAG 0.1
+
+// Sleep while the simulation is ahead of the real time
+#define PHYSICS_IDLE_SLEEP std::chrono::milliseconds(1)
+
+struct PhysicsThread
+{
+	OrbitalSim_t* sim;
+	int spawnBH;
+	FrameGovernor_t governor;
+	Recorder_t* recorder;
+	History_t* history;
+
+	Trails_t* trails;			// Recorded after every update, copied into each snapshot
+	SimSnapshot_t* snapshots[SNAPSHOTS_AMOUNT];
+	std::atomic<unsigned int> middle;	// Index of the shared snapshot (| SNAPSHOT_FRESH)
+	unsigned int back;			// Only used by the physics thread
+	unsigned int front;			// Only used by the view
+
+	std::atomic<int> rewind;
+	std::atomic<double> frametime;		// Of the last frame of the view [s]
+	std::atomic<bool> quit;
+	std::thread thread;
+};
+
+/**
+ * @brief Loop run by the physics thread.
+ *
+ * @param physics Pointer to the physics thread.
+ */
+static void physicsLoop(PhysicsThread_t* physics);
+
+/**
+ * @brief Publishes the current state of the simulation, if the view already
+ *		took the last one.
+ *
+ * @param physics Pointer to the physics thread.
+ */
+static void publishSnapshot(PhysicsThread_t* physics);
+
+SimSnapshot_t* constructSimSnapshot(const OrbitalSim_t* sim)
+{
+	SimSnapshot_t* snapshot = new SimSnapshot_t;
+	if (!snapshot)
+		return NULL;
+
+	snapshot->trails = NULL;
+	snapshot->PlanetarySystem = new EphemeridesBody_t[(sim->bodyNum) ? sim->bodyNum : 1];
+	snapshot->Asteroids = constructBodyArrays(sim->asteroidsNum);
+	if (!snapshot->PlanetarySystem || !snapshot->Asteroids)
+	{
+		destroySimSnapshot(snapshot);
+		return NULL;
+	}
+
+	copySimSnapshot(snapshot, sim);
+	return snapshot;
+}
+
+void destroySimSnapshot(SimSnapshot_t* snapshot)
+{
+	if (!snapshot)
+		return;
+	delete[] snapshot->PlanetarySystem;
+	destroyBodyArrays(snapshot->Asteroids);
+	destroyTrails(snapshot->trails);
+	delete snapshot;
+}
+
+void copySimSnapshot(SimSnapshot_t* snapshot, const OrbitalSim_t* sim)
+{
+	const BodyArrays_t* source = sim->Asteroids;
+	BodyArrays_t* destination = snapshot->Asteroids;
+	const double* sourceArrays[] = {source->x, source->y, source->z, source->vx, source->vy, source->vz,
+					source->ax, source->ay, source->az};
+	double* destinationArrays[] = {destination->x, destination->y, destination->z,
+					destination->vx, destination->vy, destination->vz,
+					destination->ax, destination->ay, destination->az};
+
+	snapshot->timeElapsed = sim->timeElapsed;
+	snapshot->bodyNum = sim->bodyNum;
+	snapshot->asteroidsNum = sim->asteroidsNum;
+	snapshot->interactionsNum = sim->interactionsNum;
+	snapshot->SpaceShip = sim->SpaceShip;
+	snapshot->BlackHole = sim->BlackHole;
+	memcpy(snapshot->PlanetarySystem, sim->PlanetarySystem, sizeof(EphemeridesBody_t) * sim->bodyNum);
+
+	for (unsigned int i = 0; i < sizeof(sourceArrays) / sizeof(sourceArrays[0]); i++)
+		memcpy(destinationArrays[i], sourceArrays[i], sizeof(double) * sim->asteroidsNum);
+}
+
+PhysicsThread_t* constructPhysicsThread(OrbitalSim_t* sim, int spawnBH, const FrameGovernor_t* governor,
+					Recorder_t* recorder, History_t* history)
+{
+	PhysicsThread_t* physics = new PhysicsThread_t;
+	if (!physics)
+		return NULL;
+
+	physics->sim = sim;
+	physics->spawnBH = spawnBH;
+	physics->governor = *governor;
+	physics->recorder = recorder;
+	physics->history = history;
+	physics->rewind = 0;
+	physics->frametime = 0.0;
+	physics->quit = false;
+
+	// Every snapshot starts with the current state, the view never sees an empty one
+	physics->trails = constructTrails(sim);
+	bool constructed = (physics->trails != NULL);
+	for (unsigned int i = 0; i < SNAPSHOTS_AMOUNT; i++)
+	{
+		physics->snapshots[i] = constructSimSnapshot(sim);
+		if (physics->snapshots[i])
+			physics->snapshots[i]->trails = constructTrails(sim);
+		constructed = constructed && physics->snapshots[i] && physics->snapshots[i]->trails;
+	}
+	if (!constructed)
+	{
+		for (unsigned int i = 0; i < SNAPSHOTS_AMOUNT; i++)
+			destroySimSnapshot(physics->snapshots[i]);
+		destroyTrails(physics->trails);
+		delete physics;
+		return NULL;
+	}
+	physics->front = 0;
+	physics->middle = 1;
+	physics->back = 2;
+
+	physics->thread = std::thread(physicsLoop, physics);
+	return physics;
+}
+
+void destroyPhysicsThread(PhysicsThread_t* physics)
+{
+	if (!physics)
+		return;
+
+	physics->quit = true;
+	physics->thread.join();
+
+	for (unsigned int i = 0; i < SNAPSHOTS_AMOUNT; i++)
+		destroySimSnapshot(physics->snapshots[i]);
+	destroyTrails(physics->trails);
+	delete physics;
+}
+
+const SimSnapshot_t* getPhysicsSnapshot(PhysicsThread_t* physics)
+{
+	if (physics->middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH)
+		physics->front = physics->middle.exchange(physics->front, std::memory_order_acq_rel) & SNAPSHOT_INDEX_MASK;
+
+	return physics->snapshots[physics->front];
+}
+
+void setPhysicsTimeDirection(PhysicsThread_t* physics, int rewind)
+{
+	physics->rewind.store(rewind, std::memory_order_relaxed);
+}
+
+void setPhysicsFrametime(PhysicsThread_t* physics, double frametime)
+{
+	physics->frametime.store(frametime, std::memory_order_relaxed);
+}
+
+static void physicsLoop(PhysicsThread_t* physics)
+{
+	OrbitalSim_t* sim = physics->sim;
+	FrameGovernor_t* governor = &physics->governor;
+	std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+	double owed = 0.0;		// Simulated seconds the simulation is behind the real time
+
+	while (!physics->quit.load(std::memory_order_relaxed))
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		owed += std::chrono::duration<double>(now - last).count() * governor->simulationSpeed;
+		owed = fmin(owed, PHYSICS_MAX_LAG * governor->simulationSpeed);
+		last = now;
+
+		double step = sim->dt;
+		if (step <= 0.0 || owed < step)
+		{
+			publishSnapshot(physics);
+			std::this_thread::sleep_for(PHYSICS_IDLE_SLEEP);
+			continue;
+		}
+
+		// Every rewind restores a keyframe and replays from it, so all the
+		// owed steps are undone at once
+		if (physics->rewind.load(std::memory_order_relaxed))
+		{
+			unsigned long long steps = (unsigned long long)(owed / step);
+			owed -= steps * step;
+			if (physics->history && rewindOrbitalSimHistory(physics->history, sim, physics->spawnBH, steps))
+				updateTrails(physics->trails, sim);
+			publishSnapshot(physics);
+			continue;
+		}
+
+		unsigned int updatesNum = 0;
+		while (owed >= step && !physics->quit.load(std::memory_order_relaxed))
+		{
+			readSpaceShipInputs(sim);
+			if (physics->history)
+				updateOrbitalSimHistory(physics->history, sim, physics->spawnBH);
+			else
+				updateOrbitalSim(sim, physics->spawnBH);
+			updateTrails(physics->trails, sim);
+			if (physics->recorder)
+				recordOrbitalSim(physics->recorder, sim);
+			owed -= step;
+			updatesNum++;
+			publishSnapshot(physics);
+		}
+
+		// The whole run is measured, trails and snapshots are part of the cost of an update
+		double updatesTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+		double dt = updateFrameGovernor(governor, updatesTime, updatesNum,
+						physics->frametime.load(std::memory_order_relaxed));
+		if (dt != sim->dt && (!physics->history || isHistoryAtKeyframe(physics->history)))
+			sim->dt = dt;
+	}
+}
+
+static void publishSnapshot(PhysicsThread_t* physics)
+{
+	if (physics->middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH)
+		return;
+
+	copySimSnapshot(physics->snapshots[physics->back], physics->sim);
+	copyTrails(physics->snapshots[physics->back]->trails, physics->trails);
+	physics->back = physics->middle.exchange(physics->back | SNAPSHOT_FRESH, std::memory_order_acq_rel) & SNAPSHOT_INDEX_MASK;
+}
@@ -0,0 +1,192 @@
+/**
+ * @brief Instrumentation of the hot paths
+ *
+ * Times come from std::chrono::steady_clock (clock_gettime(CLOCK_MONOTONIC)
+ * on Linux, QueryPerformanceCounter on Windows), which unlike the TSC needs
+ * no calibration and agrees across cores. Each thread writes its own ring
+ * without locking; the mutex is only taken the first time a thread records.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "profiler.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NANOSECONDS_PER_MICROSECOND 1E3
+
+/**
+ * @brief A stage timed on one thread.
+ */
+typedef struct
+{
+	ProfilerStage_t stage;
+	long long start;		// [ns]
+	long long duration;		// [ns]
+} ProfilerEvent_t;
+
+/**
+ * @brief Last events of one thread.
+ */
+typedef struct
+{
+	unsigned int threadId;		// Order in which the thread first recorded
+	unsigned long long eventsNum;	// Events recorded so far, the ring keeps the last ones
+	ProfilerEvent_t events[PROFILER_RING_SIZE];
+} ProfilerRing_t;
+
+static const char* const stageNames[PROFILER_STAGES_AMOUNT] =
+{
+	"updateOrbitalSim",
+	"initializeAccelerations",
+	"updateAccelerations",
+	"updateAsteroids",
+	"updateSpeedsAndPositions",
+	"removeBody",
+	"drawOrbitalSimuationEntities",
+	"EndDrawing"
+};
+
+static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+static std::atomic<int> profilerEnabled(0);
+static std::atomic<unsigned long long> stagesTime[PROFILER_STAGES_AMOUNT];
+static std::atomic<unsigned long long> stagesCalls[PROFILER_STAGES_AMOUNT];
+
+static std::mutex ringsMutex;
+static ProfilerRing_t* rings[PROFILER_THREADS_MAX];
+static unsigned int ringsNum;
+
+static thread_local ProfilerRing_t* threadRing;
+static thread_local int threadRingMissing;	// Set once no ring could be given to the thread
+
+/**
+ * @brief Gets the time since the program started.
+ *
+ * @return The time [ns].
+ */
+static inline long long getProfilerTime(void);
+
+/**
+ * @brief Gets the ring of the calling thread, giving it one the first time.
+ *
+ * @return The ring (NULL if there are no rings left or the memory could not be allocated).
+ */
+static ProfilerRing_t* getThreadRing(void);
+
+void setProfilerEnabled(int enabled)
+{
+	profilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+ProfilerMark_t beginProfilerStage(ProfilerStage_t stage)
+{
+	ProfilerMark_t mark;
+
+	mark.stage = stage;
+	mark.start = (profilerEnabled.load(std::memory_order_relaxed)) ? getProfilerTime() : -1;
+	return mark;
+}
+
+void endProfilerStage(ProfilerMark_t mark)
+{
+	if (mark.start < 0)
+		return;
+
+	long long duration = getProfilerTime() - mark.start;
+	stagesTime[mark.stage].fetch_add(duration, std::memory_order_relaxed);
+	stagesCalls[mark.stage].fetch_add(1, std::memory_order_relaxed);
+
+	ProfilerRing_t* ring = getThreadRing();
+	if (!ring)
+		return;
+
+	ProfilerEvent_t* event = &ring->events[ring->eventsNum % PROFILER_RING_SIZE];
+	event->stage = mark.stage;
+	event->start = mark.start;
+	event->duration = duration;
+	ring->eventsNum++;
+}
+
+void getProfilerTotals(ProfilerTotals_t* totals)
+{
+	for (unsigned int i = 0; i < PROFILER_STAGES_AMOUNT; i++)
+	{
+		totals->time[i] = stagesTime[i].load(std::memory_order_relaxed);
+		totals->calls[i] = stagesCalls[i].load(std::memory_order_relaxed);
+	}
+}
+
+const char* getProfilerStageName(ProfilerStage_t stage)
+{
+	return (stage < PROFILER_STAGES_AMOUNT) ? stageNames[stage] : "Unknown";
+}
+
+int writeProfilerTrace(const char* path, unsigned long long* eventsNum)
+{
+	unsigned long long written = 0;
+
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (unsigned int i = 0; i < ringsNum; i++)
+	{
+		const ProfilerRing_t* ring = rings[i];
+		unsigned long long first = (ring->eventsNum > PROFILER_RING_SIZE) ? ring->eventsNum - PROFILER_RING_SIZE : 0;
+
+		// Events are kept as they end, so nested stages come before the stage holding them
+		for (unsigned long long j = first; j < ring->eventsNum; j++)
+		{
+			const ProfilerEvent_t* event = &ring->events[j % PROFILER_RING_SIZE];
+			fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				(written) ? "," : "", stageNames[event->stage], ring->threadId,
+				event->start / NANOSECONDS_PER_MICROSECOND, event->duration / NANOSECONDS_PER_MICROSECOND);
+			written++;
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	if (eventsNum)
+		*eventsNum = written;
+	return !fclose(file);
+}
+
+void destroyProfiler(void)
+{
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	for (unsigned int i = 0; i < ringsNum; i++)
+		free(rings[i]);
+	ringsNum = 0;
+}
+
+static inline long long getProfilerTime(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+static ProfilerRing_t* getThreadRing(void)
+{
+	if (threadRing || threadRingMissing)
+		return threadRing;
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	if (ringsNum < PROFILER_THREADS_MAX)
+		threadRing = (ProfilerRing_t*) malloc(sizeof(ProfilerRing_t));
+	if (!threadRing)
+	{
+		threadRingMissing = 1;
+		return NULL;
+	}
+
+	threadRing->threadId = ringsNum;
+	threadRing->eventsNum = 0;
+	rings[ringsNum++] = threadRing;
+	return threadRing;
+}
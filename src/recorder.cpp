@@ -0,0 +1,372 @@
+/**
+ * @brief Trajectory recording for offline analysis
+ *
+ * The simulating thread converts the state into a free frame of a single
+ * producer, single consumer ring, and the writer thread encodes and writes
+ * the frames in order. The writer never holds the lock while it touches the
+ * disk, so the simulation only ever waits for a notification.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "recorder.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_BYTE_ORDER 0x01020304U
+
+// Values per body: position and velocity
+#define RECORD_BODY_WORDS 6
+
+// Longest runs of the packing, see recorder.h
+#define RECORD_LITERALS_MAX 128
+#define RECORD_ZEROS_MIN 2
+#define RECORD_ZEROS_MAX 129
+
+/**
+ * @brief State of the simulation after an update, as payload words.
+ */
+typedef struct
+{
+	unsigned long long step;
+	double timeElapsed;
+	unsigned int bodyNum;
+	unsigned int asteroidsNum;
+	unsigned int wordsNum;
+	unsigned int* words;
+} RecordFrame_t;
+
+struct Recorder
+{
+	FILE* file;
+	unsigned int interval;
+	int delta;
+	unsigned int wordsMax;
+
+	RecordFrame_t frames[RECORD_QUEUE_SIZE];
+	std::atomic<unsigned int> head;		// Frames queued so far, only written by the simulating thread
+	std::atomic<unsigned int> tail;		// Frames written so far, only written by the writer thread
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::atomic<bool> quit;
+	std::thread thread;
+
+	// Only used by the simulating thread (and read once the writer joined)
+	unsigned long long steps;
+	unsigned long long droppedNum;
+
+	// Only used by the writer thread (and read once it joined)
+	unsigned int* previous;			// Payload of the last frame, delta frames are XORed with it
+	unsigned int previousWordsNum;
+	unsigned int framesSinceKeyframe;
+	unsigned char* planes;
+	unsigned char* packed;
+	unsigned long long framesNum;
+	int failed;
+};
+
+/**
+ * @brief Loop run by the writer thread.
+ *
+ * @param recorder Pointer to the recorder.
+ */
+static void writerLoop(Recorder_t* recorder);
+
+/**
+ * @brief Encodes and writes a frame.
+ *
+ * @param recorder Pointer to the recorder.
+ * @param frame Pointer to the frame.
+ *
+ * @return 1 if it was written, 0 if not.
+ */
+static int writeFrame(Recorder_t* recorder, RecordFrame_t* frame);
+
+/**
+ * @brief Stores a body as payload words.
+ *
+ * @param words Where the words are stored.
+ * @param body Pointer to the body.
+ */
+static void putBody(unsigned int* words, const Body_t* body);
+
+/**
+ * @brief Stores an array of doubles as payload words.
+ *
+ * @param words Where the words are stored.
+ * @param values The array.
+ * @param valuesNum Length of the array.
+ */
+static void putArray(unsigned int* words, const double* values, unsigned int valuesNum);
+
+/**
+ * @brief Run length encodes the zeros of a buffer, see recorder.h.
+ *
+ * @param input The buffer.
+ * @param size Size of the buffer [bytes].
+ * @param output Where the encoded buffer is stored, at least
+ *		size + size / RECORD_LITERALS_MAX + 1 bytes.
+ *
+ * @return Size of the encoded buffer [bytes].
+ */
+static size_t packBytes(const unsigned char* input, size_t size, unsigned char* output);
+
+Recorder_t* constructRecorder(const char* path, const OrbitalSim_t* sim, unsigned int interval, int delta)
+{
+	Recorder_t* recorder = new Recorder_t;
+	if (!recorder)
+		return NULL;
+
+	recorder->interval = (interval) ? interval : 1;
+	recorder->delta = delta;
+	recorder->wordsMax = (sim->bodyNum + 2) * RECORD_BODY_WORDS + sim->asteroidsNum * (RECORD_BODY_WORDS + 1);
+	recorder->head = 0;
+	recorder->tail = 0;
+	recorder->quit = false;
+	recorder->steps = 0;
+	recorder->droppedNum = 0;
+	recorder->previousWordsNum = 0;
+	recorder->framesSinceKeyframe = 0;
+	recorder->framesNum = 0;
+	recorder->failed = 0;
+
+	size_t bytesMax = sizeof(unsigned int) * recorder->wordsMax;
+	int allocated = 1;
+	for (unsigned int i = 0; i < RECORD_QUEUE_SIZE; i++)
+	{
+		recorder->frames[i].words = (unsigned int*) malloc(bytesMax);
+		allocated = allocated && recorder->frames[i].words;
+	}
+	recorder->previous = (unsigned int*) ((delta) ? malloc(bytesMax) : NULL);
+	recorder->planes = (unsigned char*) ((delta) ? malloc(bytesMax) : NULL);
+	recorder->packed = (unsigned char*) ((delta) ? malloc(bytesMax + bytesMax / RECORD_LITERALS_MAX + 1) : NULL);
+	allocated = allocated && (!delta || (recorder->previous && recorder->planes && recorder->packed));
+
+	recorder->file = (allocated) ? fopen(path, "wb") : NULL;
+
+	RecordHeader_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+	header.version = RECORD_VERSION;
+	header.byteOrder = RECORD_BYTE_ORDER;
+	header.interval = recorder->interval;
+	header.delta = (delta != 0);
+	header.system = (sim->PlanetarySystem == alphaCentauriSystem);
+	header.dt = sim->dt;
+
+	if (!recorder->file || fwrite(&header, sizeof(header), 1, recorder->file) != 1)
+	{
+		if (recorder->file)
+			fclose(recorder->file);
+		for (unsigned int i = 0; i < RECORD_QUEUE_SIZE; i++)
+			free(recorder->frames[i].words);
+		free(recorder->previous);
+		free(recorder->planes);
+		free(recorder->packed);
+		delete recorder;
+		return NULL;
+	}
+
+	recorder->thread = std::thread(writerLoop, recorder);
+	return recorder;
+}
+
+int destroyRecorder(Recorder_t* recorder, unsigned long long* framesNum, unsigned long long* droppedNum)
+{
+	if (!recorder)
+		return 0;
+
+	{
+		std::lock_guard<std::mutex> lock(recorder->mutex);
+		recorder->quit = true;
+	}
+	recorder->queued.notify_one();
+	recorder->thread.join();
+
+	if (framesNum)
+		*framesNum = recorder->framesNum;
+	if (droppedNum)
+		*droppedNum = recorder->droppedNum;
+	int written = !recorder->failed && !fclose(recorder->file);
+	for (unsigned int i = 0; i < RECORD_QUEUE_SIZE; i++)
+		free(recorder->frames[i].words);
+	free(recorder->previous);
+	free(recorder->planes);
+	free(recorder->packed);
+	delete recorder;
+	return written;
+}
+
+void recordOrbitalSim(Recorder_t* recorder, const OrbitalSim_t* sim)
+{
+	if (recorder->steps++ % recorder->interval)
+		return;
+
+	unsigned int head = recorder->head.load(std::memory_order_relaxed);
+	if (head - recorder->tail.load(std::memory_order_acquire) == RECORD_QUEUE_SIZE)
+	{
+		recorder->droppedNum++;
+		return;
+	}
+
+	RecordFrame_t* frame = &recorder->frames[head % RECORD_QUEUE_SIZE];
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	unsigned int* words = frame->words;
+
+	frame->step = recorder->steps - 1;
+	frame->timeElapsed = sim->timeElapsed;
+	frame->bodyNum = sim->bodyNum;
+	frame->asteroidsNum = sim->asteroidsNum;
+
+	for (unsigned int i = 0; i < sim->bodyNum; i++, words += RECORD_BODY_WORDS)
+		putBody(words, &sim->PlanetarySystem[i].body);
+	putBody(words, &sim->SpaceShip.body);
+	words += RECORD_BODY_WORDS;
+	putBody(words, &sim->BlackHole.body);
+	words += RECORD_BODY_WORDS;
+
+	if (sim->asteroidsNum)
+		memcpy(words, sim->asteroidsIds, sizeof(unsigned int) * sim->asteroidsNum);
+	words += sim->asteroidsNum;
+
+	const double* arrays[RECORD_BODY_WORDS] = {asteroids->x, asteroids->y, asteroids->z,
+							asteroids->vx, asteroids->vy, asteroids->vz};
+	for (unsigned int i = 0; i < RECORD_BODY_WORDS; i++, words += sim->asteroidsNum)
+		putArray(words, arrays[i], sim->asteroidsNum);
+
+	frame->wordsNum = (unsigned int)(words - frame->words);
+
+	// The lock only orders the notification with the writer going to sleep
+	recorder->head.store(head + 1, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(recorder->mutex);
+	}
+	recorder->queued.notify_one();
+}
+
+static void writerLoop(Recorder_t* recorder)
+{
+	while (true)
+	{
+		unsigned int tail = recorder->tail.load(std::memory_order_relaxed);
+		{
+			std::unique_lock<std::mutex> lock(recorder->mutex);
+			while (recorder->head.load(std::memory_order_acquire) == tail && !recorder->quit)
+				recorder->queued.wait(lock);
+		}
+
+		// Quits once everything queued is written
+		if (recorder->head.load(std::memory_order_acquire) == tail)
+			break;
+
+		// After a failed write the frames are only taken off the queue
+		if (!recorder->failed)
+		{
+			if (writeFrame(recorder, &recorder->frames[tail % RECORD_QUEUE_SIZE]))
+				recorder->framesNum++;
+			else
+				recorder->failed = 1;
+		}
+		recorder->tail.store(tail + 1, std::memory_order_release);
+	}
+}
+
+static int writeFrame(Recorder_t* recorder, RecordFrame_t* frame)
+{
+	RecordFrameHeader_t header;
+	const void* payload = frame->words;
+	size_t size = sizeof(unsigned int) * frame->wordsNum;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORD_FRAME_MAGIC, sizeof(header.magic));
+	header.bodyNum = frame->bodyNum;
+	header.asteroidsNum = frame->asteroidsNum;
+	header.wordsNum = frame->wordsNum;
+	header.step = frame->step;
+	header.timeElapsed = frame->timeElapsed;
+
+	if (recorder->delta)
+	{
+		unsigned int* words = frame->words;
+		unsigned int wordsNum = frame->wordsNum;
+
+		// Keyframes, and frames after a body or an asteroid was absorbed, decode on their own
+		int keyframe = (recorder->framesSinceKeyframe == RECORD_KEYFRAME_INTERVAL || recorder->previousWordsNum != wordsNum);
+		recorder->framesSinceKeyframe = (keyframe) ? 0 : recorder->framesSinceKeyframe + 1;
+		header.flags = RECORD_FRAME_PACKED | ((keyframe) ? 0 : RECORD_FRAME_DELTA);
+
+		for (unsigned int i = 0; i < wordsNum; i++)
+		{
+			unsigned int word = words[i];
+			unsigned int delta = (keyframe) ? word : word ^ recorder->previous[i];
+
+			recorder->previous[i] = word;
+			recorder->planes[i] = (unsigned char)delta;
+			recorder->planes[wordsNum + i] = (unsigned char)(delta >> 8);
+			recorder->planes[2 * wordsNum + i] = (unsigned char)(delta >> 16);
+			recorder->planes[3 * wordsNum + i] = (unsigned char)(delta >> 24);
+		}
+		recorder->previousWordsNum = wordsNum;
+
+		size = packBytes(recorder->planes, size, recorder->packed);
+		payload = recorder->packed;
+	}
+
+	header.size = (unsigned int)size;
+	return fwrite(&header, sizeof(header), 1, recorder->file) == 1 &&
+		(!size || fwrite(payload, size, 1, recorder->file) == 1);
+}
+
+static void putBody(unsigned int* words, const Body_t* body)
+{
+	const double values[RECORD_BODY_WORDS] = {body->position.x, body->position.y, body->position.z,
+							body->velocity.x, body->velocity.y, body->velocity.z};
+
+	putArray(words, values, RECORD_BODY_WORDS);
+}
+
+static void putArray(unsigned int* words, const double* values, unsigned int valuesNum)
+{
+	for (unsigned int i = 0; i < valuesNum; i++)
+	{
+		float value = (float)values[i];
+		memcpy(&words[i], &value, sizeof(value));
+	}
+}
+
+static size_t packBytes(const unsigned char* input, size_t size, unsigned char* output)
+{
+	size_t i = 0, packedSize = 0;
+
+	while (i < size)
+	{
+		size_t run = 0;
+		while (i + run < size && !input[i + run] && run < RECORD_ZEROS_MAX)
+			run++;
+		if (run >= RECORD_ZEROS_MIN)
+		{
+			output[packedSize++] = (unsigned char)(RECORD_LITERALS_MAX + run - RECORD_ZEROS_MIN);
+			i += run;
+			continue;
+		}
+
+		// Literals up to the next pair of zeros
+		size_t begin = i;
+		while (i < size && i - begin < RECORD_LITERALS_MAX && (input[i] || (i + 1 < size && input[i + 1])))
+			i++;
+		if (i == begin)
+			i++;	// A single zero at the end
+		output[packedSize++] = (unsigned char)(i - begin - 1);
+		memcpy(output + packedSize, input + begin, i - begin);
+		packedSize += i - begin;
+	}
+
+	return packedSize;
+}
@@ -0,0 +1,150 @@
+/**
+ * @brief Fixed size pool of worker threads
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "threadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeUp;		// Signals a new batch of tasks (or quit)
+	std::condition_variable finished;	// Signals that every worker left the batch
+
+	threadPoolTask_t task;
+	void* data;
+	unsigned int tasksNum;
+	std::atomic<unsigned int> nextTask;
+
+	unsigned int busyWorkers;
+	unsigned long batch;
+	bool quit;
+};
+
+/**
+ * @brief Loop run by every worker thread.
+ *
+ * @param pool Pointer to the thread pool.
+ */
+static void workerLoop(ThreadPool_t* pool);
+
+/**
+ * @brief Claims and runs tasks until there are none left.
+ *
+ * @param pool Pointer to the thread pool.
+ */
+static void runTasks(ThreadPool_t* pool);
+
+ThreadPool_t* constructThreadPool(unsigned int threadsNum)
+{
+	ThreadPool_t* pool = new ThreadPool_t;
+	if (!pool)
+		return NULL;
+
+	if (!threadsNum)
+		threadsNum = std::thread::hardware_concurrency();
+	threadsNum = (threadsNum) ? threadsNum : 1;
+
+	pool->task = NULL;
+	pool->data = NULL;
+	pool->tasksNum = 0;
+	pool->nextTask = 0;
+	pool->busyWorkers = 0;
+	pool->batch = 0;
+	pool->quit = false;
+
+	// The thread calling runThreadPool is the remaining one
+	for (unsigned int i = 1; i < threadsNum; i++)
+	{
+		pool->workers.push_back(std::thread(workerLoop, pool));
+	}
+
+	return pool;
+}
+
+void destroyThreadPool(ThreadPool_t* pool)
+{
+	if (!pool)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->quit = true;
+	}
+	pool->wakeUp.notify_all();
+
+	for (unsigned int i = 0; i < pool->workers.size(); i++)
+	{
+		pool->workers[i].join();
+	}
+	delete pool;
+}
+
+void runThreadPool(ThreadPool_t* pool, threadPoolTask_t task, void* data, unsigned int tasksNum)
+{
+	if (pool->workers.empty() || tasksNum < 2)
+	{
+		for (unsigned int i = 0; i < tasksNum; i++)
+			task(data, i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->task = task;
+		pool->data = data;
+		pool->tasksNum = tasksNum;
+		pool->nextTask = 0;
+		pool->busyWorkers = (unsigned int)pool->workers.size();
+		pool->batch++;
+	}
+	pool->wakeUp.notify_all();
+
+	runTasks(pool);
+
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	pool->finished.wait(lock, [pool] { return !pool->busyWorkers; });
+}
+
+unsigned int getThreadPoolSize(const ThreadPool_t* pool)
+{
+	return (unsigned int)pool->workers.size() + 1;
+}
+
+static void workerLoop(ThreadPool_t* pool)
+{
+	unsigned long lastBatch = 0;
+
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(pool->mutex);
+		pool->wakeUp.wait(lock, [pool, lastBatch] { return pool->quit || pool->batch != lastBatch; });
+		if (pool->quit)
+			return;
+		lastBatch = pool->batch;
+		lock.unlock();
+
+		runTasks(pool);
+
+		lock.lock();
+		if (!--pool->busyWorkers)
+			pool->finished.notify_one();
+	}
+}
+
+static void runTasks(ThreadPool_t* pool)
+{
+	for (unsigned int i = pool->nextTask++; i < pool->tasksNum; i = pool->nextTask++)
+	{
+		pool->task(pool->data, i);
+	}
+}
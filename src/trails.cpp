@@ -0,0 +1,221 @@
+/**
+ * @brief Orbit trails, recorded by the physics side
+ *
+ * Every trail writes its sample of the same slot, so a sample is one
+ * contiguous run of trailsNum positions. Readers copy (or upload) only the
+ * slots written since they last looked.
+ *
+ * @author Sofia Capiel
+ * @author Agustin Tomas Valenzuela
+ * @author Francisco Alonso Paredes
+ */
+
+#include "trails.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Index of the asteroid of a trail while it is being found again
+#define TRAILS_ASTEROID_PENDING (TRAILS_ASTEROID_GONE - 1)
+
+/**
+ * @brief Gets the position of the body a trail follows.
+ *
+ * @param trails Pointer to the trails.
+ * @param sim Pointer to the simulation.
+ * @param trail Index of the trail.
+ * @param position Where the position is stored.
+ *
+ * @return 0 if the body is gone (absorbed), position is left untouched.
+ */
+static int getTrailPosition(const Trails_t* trails, const OrbitalSim_t* sim, unsigned int trail, vector3D_t* position);
+
+/**
+ * @brief Finds the index of the asteroid of each asteroid trail, from the ids
+ *		of the asteroids.
+ *
+ * @param trails Pointer to the trails.
+ * @param sim Pointer to the simulation.
+ * @param collapse Collapses the trails whose asteroid appeared or disappeared.
+ */
+static void findTrailsAsteroids(Trails_t* trails, const OrbitalSim_t* sim, int collapse);
+
+/**
+ * @brief Collapses a range of trails on the current position of their bodies.
+ *
+ * @param trails Pointer to the trails.
+ * @param sim Pointer to the simulation.
+ * @param begin Index of the first trail.
+ * @param end Index past the last trail.
+ */
+static void collapseTrails(Trails_t* trails, const OrbitalSim_t* sim, unsigned int begin, unsigned int end);
+
+Trails_t* constructTrails(const OrbitalSim_t* sim)
+{
+	Trails_t* trails = new Trails_t;
+	if (!trails)
+		return NULL;
+
+	trails->asteroidsStride = (sim->asteroidsNum + TRAILS_ASTEROIDS_MAX - 1) / TRAILS_ASTEROIDS_MAX;
+	trails->asteroidsStride = (trails->asteroidsStride) ? trails->asteroidsStride : 1;
+	trails->bodiesTrailsNum = sim->bodyNum;
+	trails->trailsNum = sim->bodyNum + 1 + (sim->asteroidsNum + trails->asteroidsStride - 1) / trails->asteroidsStride;
+	trails->length = TRAILS_LENGTH;
+	trails->samplesNum = 0;
+	trails->resetsNum = 0;
+	trails->lastSampleTime = sim->timeElapsed;
+	trails->bodyNum = sim->bodyNum;
+	trails->asteroidsOrder = sim->asteroidsOrder;
+
+	unsigned int asteroidsTrailsNum = trails->trailsNum - (trails->bodiesTrailsNum + 1);
+	trails->positions = (vector3D_t*) malloc(sizeof(vector3D_t) * trails->length * trails->trailsNum);
+	trails->asteroidsIndices = (unsigned int*) ((asteroidsTrailsNum) ? malloc(sizeof(unsigned int) * asteroidsTrailsNum) : NULL);
+	if (!trails->positions || (asteroidsTrailsNum && !trails->asteroidsIndices))
+	{
+		destroyTrails(trails);
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < asteroidsTrailsNum; i++)
+		trails->asteroidsIndices[i] = TRAILS_ASTEROID_GONE;
+	findTrailsAsteroids(trails, sim, 0);
+	collapseTrails(trails, sim, 0, trails->trailsNum);
+	return trails;
+}
+
+void destroyTrails(Trails_t* trails)
+{
+	if (!trails)
+		return;
+	if (trails->positions)
+		free(trails->positions);
+	if (trails->asteroidsIndices)
+		free(trails->asteroidsIndices);
+	delete trails;
+}
+
+void updateTrails(Trails_t* trails, const OrbitalSim_t* sim)
+{
+	if (fabs(sim->timeElapsed - trails->lastSampleTime) < TRAILS_SAMPLE_INTERVAL)
+		return;
+	trails->lastSampleTime = sim->timeElapsed;
+
+	// The bodies after an absorbed one moved down, the asteroids are found again by id
+	if (sim->bodyNum != trails->bodyNum)
+		collapseTrails(trails, sim, 0, trails->bodiesTrailsNum);
+	if (sim->asteroidsOrder != trails->asteroidsOrder)
+		findTrailsAsteroids(trails, sim, 1);
+	trails->bodyNum = sim->bodyNum;
+	trails->asteroidsOrder = sim->asteroidsOrder;
+
+	unsigned int slot = trails->samplesNum % trails->length;
+	unsigned int previousSlot = (slot) ? slot - 1 : trails->length - 1;
+	vector3D_t* sample = trails->positions + slot * trails->trailsNum;
+	const vector3D_t* previousSample = trails->positions + previousSlot * trails->trailsNum;
+
+	// Trails of absorbed bodies stay where they ended
+	for (unsigned int i = 0; i < trails->trailsNum; i++)
+	{
+		if (!getTrailPosition(trails, sim, i, &sample[i]))
+			sample[i] = previousSample[i];
+	}
+
+	trails->samplesNum++;
+}
+
+void copyTrails(Trails_t* destination, const Trails_t* source)
+{
+	size_t sampleSize = sizeof(vector3D_t) * source->trailsNum;
+
+	if (destination->resetsNum != source->resetsNum || source->samplesNum - destination->samplesNum >= source->length)
+		memcpy(destination->positions, source->positions, sampleSize * source->length);
+	else
+	{
+		for (unsigned long long sample = destination->samplesNum; sample < source->samplesNum; sample++)
+		{
+			unsigned int slot = sample % source->length;
+			memcpy(destination->positions + slot * source->trailsNum, source->positions + slot * source->trailsNum, sampleSize);
+		}
+	}
+
+	destination->samplesNum = source->samplesNum;
+	destination->resetsNum = source->resetsNum;
+}
+
+static int getTrailPosition(const Trails_t* trails, const OrbitalSim_t* sim, unsigned int trail, vector3D_t* position)
+{
+	unsigned int asteroidsTrails = trails->bodiesTrailsNum + 1;
+
+	if (trail < trails->bodiesTrailsNum)
+	{
+		if (trail >= sim->bodyNum)
+			return 0;
+		*position = sim->PlanetarySystem[trail].body.position;
+		return 1;
+	}
+	if (trail < asteroidsTrails)
+	{
+		*position = sim->SpaceShip.body.position;
+		return 1;
+	}
+
+	unsigned int asteroid = trails->asteroidsIndices[trail - asteroidsTrails];
+	if (asteroid == TRAILS_ASTEROID_GONE || asteroid >= sim->asteroidsNum)
+		return 0;
+	position->x = sim->Asteroids->x[asteroid];
+	position->y = sim->Asteroids->y[asteroid];
+	position->z = sim->Asteroids->z[asteroid];
+	return 1;
+}
+
+static void findTrailsAsteroids(Trails_t* trails, const OrbitalSim_t* sim, int collapse)
+{
+	unsigned int asteroidsTrails = trails->bodiesTrailsNum + 1;
+	unsigned int asteroidsTrailsNum = trails->trailsNum - asteroidsTrails;
+	unsigned int* indices = trails->asteroidsIndices;
+	unsigned int i;
+
+	for (i = 0; i < asteroidsTrailsNum; i++)
+		indices[i] = (indices[i] == TRAILS_ASTEROID_GONE) ? TRAILS_ASTEROID_GONE : TRAILS_ASTEROID_PENDING;
+
+	for (i = 0; i < sim->asteroidsNum; i++)
+	{
+		unsigned int id = sim->asteroidsIds[i];
+		unsigned int trail = id / trails->asteroidsStride;
+
+		if (id % trails->asteroidsStride || trail >= asteroidsTrailsNum)
+			continue;
+
+		int appeared = (indices[trail] == TRAILS_ASTEROID_GONE);
+		indices[trail] = i;
+		if (collapse && appeared)
+			collapseTrails(trails, sim, asteroidsTrails + trail, asteroidsTrails + trail + 1);
+	}
+
+	// Absorbed since the last time, the trail collapses where the asteroid was last seen
+	for (i = 0; i < asteroidsTrailsNum; i++)
+	{
+		if (indices[i] != TRAILS_ASTEROID_PENDING)
+			continue;
+		indices[i] = TRAILS_ASTEROID_GONE;
+		if (collapse)
+			collapseTrails(trails, sim, asteroidsTrails + i, asteroidsTrails + i + 1);
+	}
+}
+
+static void collapseTrails(Trails_t* trails, const OrbitalSim_t* sim, unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		vector3D_t position;
+
+		// A gone body keeps the last position it left
+		if (!getTrailPosition(trails, sim, i, &position))
+			position = trails->positions[((trails->samplesNum + trails->length - 1) % trails->length) * trails->trailsNum + i];
+
+		for (unsigned int slot = 0; slot < trails->length; slot++)
+			trails->positions[slot * trails->trailsNum + i] = position;
+	}
+
+	trails->resetsNum++;
+}
@@ -14,8 +14,10 @@
 #include "keyBinds.h"
 #include <math.h>
 #include <raymath.h>
+#include <rlgl.h>
 #include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define SECONDS_PER_DAY (time_t)(24 * 60 * 60)
 #define SECONDS_PER_YEAR (time_t)(365 * SECONDS_PER_DAY)
@@ -38,12 +40,39 @@ enum
 // Asteroids constants
 #define ASTEROIDS_COLOR GRAY
 #define ASTEROIDS_RADIUS 2E3F
+#define ASTEROIDS_RINGS 5
+#define ASTEROIDS_SLICES 7
+#define POINT_LENGTH 0.1F
+#define LINES_BATCH_SIZE 4096		// Lines pushed between checks of the render batch
+
+// Level of detail, by radius on screen [pixels]
+#define LOD_DETAILED_PIXELS 16.0F	// Above it, spheres get more rings and slices
+#define LOD_POINT_PIXELS 1.0F		// Below it, spheres are drawn as points
+#define LOD_SKIP_PIXELS 0.25F		// Below it, asteroids are not drawn
+#define DETAILED_RINGS 16
+#define DETAILED_SLICES 16
+
+// Trails constants
+#define TRAILS_ALPHA 160
+
+// Clipping planes used by rlgl
+#define FRUSTUM_NEAR 0.01F
+#define FRUSTUM_FAR 1000.0F
 
 // Scale factors for display purposes
 #define POSITION_SCALE_FACTOR 1E-11
 #define VELOCITY_SCALE_FACTOR 1E-4
 #define ACCELERATION_SCALE_FACTOR 1E3
 
+// Profiler overlay
+#define PROFILER_OVERLAY_X 10
+#define PROFILER_OVERLAY_Y 80
+#define PROFILER_OVERLAY_LINE_HEIGHT 20
+#define PROFILER_OVERLAY_FONT_SIZE 20
+#define PROFILER_OVERLAY_REFRESH 0.5		// Seconds between samples
+#define PROFILER_OVERLAY_COLOR CLITERAL(Color){255, 203, 0, 200}
+#define MILLISECONDS_PER_NANOSECOND 1E-6
+
 // Controls
 #define CONTROLS_X_MARGIN 370
 #define CONTROLS_Y_MARGIN 20
@@ -54,10 +83,64 @@ enum
  * Private variables
 */
 
+/**
+ * The camera frustum, for the visibility stage
+ */
+typedef struct
+{
+	Vector3 position;
+	Vector3 forward, right, up;		// Unit vectors
+	float tanHalfFovX, tanHalfFovY;
+	float pixelsPerUnit;			// Pixels covered by a unit length at unit depth
+} frustum_t;
+
 static Vector3 last_camera_position, last_camera_target;
+static frustum_t frustum;
 static int camera_mode = CAMERA_FREE;
 static char buffer[128];
 
+// Moves the asteroid sphere by the transform of each instance
+static const char* const asteroidsVertexShader =
+	"#version 330\n"
+	"in vec3 vertexPosition;\n"
+	"in mat4 instanceTransform;\n"
+	"uniform mat4 mvp;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = mvp * instanceTransform * vec4(vertexPosition, 1.0);\n"
+	"}\n";
+
+static const char* const asteroidsFragmentShader =
+	"#version 330\n"
+	"uniform vec4 colDiffuse;\n"
+	"out vec4 finalColor;\n"
+	"void main()\n"
+	"{\n"
+	"	finalColor = colDiffuse;\n"
+	"}\n";
+
+// Trails carry the color of their body in every vertex
+static const char* const trailsVertexShader =
+	"#version 330\n"
+	"in vec3 vertexPosition;\n"
+	"in vec4 vertexColor;\n"
+	"uniform mat4 mvp;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColor = vertexColor;\n"
+	"	gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+	"}\n";
+
+static const char* const trailsFragmentShader =
+	"#version 330\n"
+	"in vec4 fragColor;\n"
+	"out vec4 finalColor;\n"
+	"void main()\n"
+	"{\n"
+	"	finalColor = fragColor;\n"
+	"}\n";
+
 /**
  * Private function declarations
  */
@@ -95,26 +178,176 @@ static const char* getElapsedSimTime(time_t timestamp, char buffer[]);
  * @brief Updates the settings of the camera.
  * 
  * @param view Pointer to the view object containing the camera.
- * @param sim Pointer to the simulation.
+ * @param sim Pointer to the snapshot of the simulation.
  */
-static void updateCameraSettings(view_t* view, OrbitalSim_t* sim);
+static void updateCameraSettings(view_t* view, const SimSnapshot_t* sim);
 
 /**
- * @brief Draws a body in the simulation.
+ * @brief Updates the frustum with the camera of the view.
+ * 
+ * @param view Pointer to the view object containing the camera.
+ */
+static void updateFrustum(const view_t* view);
+
+/**
+ * @brief Gets the radius of a sphere on screen.
+ * 
+ * @param position The center of the sphere, scaled for display.
+ * @param radius The radius of the sphere, scaled for display.
+ * 
+ * @return The radius in pixels, or a negative value if the sphere is out of view.
+ */
+static float getPixelRadius(Vector3 position, float radius);
+
+/**
+ * @brief Draws a body in the simulation, unless it is out of view. In quality
+ *		mode the sphere gets simpler as it gets smaller on screen, down to a point.
  * 
  * @param body The body wishing to draw.
  * @param radius The radius of the body.
  * @param color The color of the body.
  * @param render_mode The mode of the rendering (QUALITY or PERFORMANCE).
  */
-static void drawBody(Body_t* body, float radius, Color color, unsigned int render_mode);
+static void drawBody(const Body_t* body, float radius, Color color, unsigned int render_mode);
+
+/**
+ * @brief Writes a line from the position of each body to the tip of one of its vectors.
+ *		Every array is walked once, in order, so the loop vectorizes.
+ * 
+ * @param lines Where the two ends of each line are stored.
+ * @param x The x coordinate of each position (y and z as well) [m].
+ * @param vx The x component of each vector (vy and vz as well).
+ * @param count The amount of bodies.
+ * @param scale The scale factor of the vectors.
+ * 
+ * @return Pointer past the last line written.
+ */
+static Vector3* transformVectors(Vector3* lines, const double* x, const double* y, const double* z,
+				const double* vx, const double* vy, const double* vz, unsigned int count, double scale);
+
+/**
+ * @brief Writes the lines of every body in the snapshot.
+ * 
+ * @param lines Where the lines are stored.
+ * @param sim Pointer to the snapshot of the simulation.
+ * @param velocities Set for the velocity vectors, clear for the acceleration vectors.
+ * 
+ * @return Pointer past the last line written.
+ */
+static Vector3* transformBodiesVectors(Vector3* lines, const SimSnapshot_t* sim, int velocities);
+
+/**
+ * @brief Pushes a buffer of lines into the render batch.
+ * 
+ * @param lines The two ends of each line.
+ * @param linesNum The amount of lines.
+ * @param color The color of the lines.
+ */
+static void drawLines(const Vector3* lines, unsigned int linesNum, Color color);
+
+/**
+ * @brief Draws the velocity and acceleration vectors of every body, if enabled.
+ *		Both overlays are built into one buffer per frame and pushed together.
+ * 
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void drawVectorsOverlay(view_t* view, const SimSnapshot_t* sim);
+
+/**
+ * @brief Gets the color of a trail, the color of its body a bit transparent.
+ * 
+ * @param sim Pointer to the snapshot of the simulation.
+ * @param trail Index of the trail.
+ * 
+ * @return The color.
+ */
+static Color getTrailColor(const SimSnapshot_t* sim, unsigned int trail);
+
+/**
+ * @brief Loads the shader and the buffers of the trails ring on the GPU. Without
+ *		them (no OpenGL 3.3) the trails are drawn from the snapshot.
+ * 
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation, holding the trails.
+ */
+static void loadTrails(view_t* view, const SimSnapshot_t* sim);
+
+/**
+ * @brief Unloads whatever loadTrails loaded.
+ * 
+ * @param view Pointer to the view object.
+ */
+static void unloadTrails(view_t* view);
+
+/**
+ * @brief Uploads the color of every trail vertex.
+ * 
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void uploadTrailsColors(view_t* view, const SimSnapshot_t* sim);
+
+/**
+ * @brief Uploads the segments ending in one slot, from the previous sample of each trail.
+ * 
+ * @param view Pointer to the view object.
+ * @param trails Pointer to the trails.
+ * @param slot The slot.
+ * @param degenerate Set for the oldest slot, whose previous sample was overwritten.
+ */
+static void uploadTrailsSlot(view_t* view, const Trails_t* trails, unsigned int slot, int degenerate);
+
+/**
+ * @brief Draws the trails walking the snapshot, when they cannot be kept on the GPU.
+ * 
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void drawTrailsFromSnapshot(const SimSnapshot_t* sim);
+
+/**
+ * @brief Draws the orbit trails, if enabled. Only the samples taken since the
+ *		last frame are uploaded, and the whole ring is drawn in one call.
+ * 
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void drawTrails(view_t* view, const SimSnapshot_t* sim);
+
+/**
+ * @brief Loads the mesh and shader that draw every asteroid in one instanced call.
+ *		Without them (no OpenGL 3.3) the asteroids are drawn one by one.
+ * 
+ * @param view Pointer to the view object.
+ */
+static void loadAsteroidsInstancing(view_t* view);
+
+/**
+ * @brief Draws every asteroid in view. In quality mode the ones big enough on
+ *		screen are drawn as spheres by a single instanced call, the rest
+ *		are pushed as points into one batch. The smallest ones are skipped.
+ * 
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void drawAsteroids(view_t* view, const SimSnapshot_t* sim);
 
 /**
  * @brief Draws all the entities of the simulation.
  * 
- * @param sim Pointer to the simulation.
+ * @param view Pointer to the view object.
+ * @param sim Pointer to the snapshot of the simulation.
  */
-static void drawOrbitalSimuationEntities(OrbitalSim_t* sim);
+static void drawOrbitalSimuationEntities(view_t* view, const SimSnapshot_t* sim);
+
+/**
+ * @brief Samples the profiler every PROFILER_OVERLAY_REFRESH seconds, and draws the
+ *		time each stage took per frame and the interactions per second.
+ *
+ * @param view Pointer to the view.
+ * @param sim Pointer to the snapshot of the simulation.
+ */
+static void drawProfilerOverlay(view_t* view, const SimSnapshot_t* sim);
 
 /**
  * @brief Prints the keybinds to show the features available.
@@ -127,7 +360,8 @@ static void printKeybinds(view_t* view);
  * Public function definitions.
  */
 
-view_t* constructView(int fps, int fullscreen, int width, int height, int show_velocity_vectors, int show_acceleration_vectors)
+view_t* constructView(int fps, int fullscreen, int width, int height, int show_velocity_vectors, int show_acceleration_vectors,
+			int show_trails)
 {
 	if (width < MIN_WIDTH)
 		width = DEFAULT_WINDOW_WIDTH;
@@ -144,6 +378,7 @@ view_t* constructView(int fps, int fullscreen, int width, int height, int show_v
 
 	keybindsValues[TOGGLE_SHOW_VELOCITY_VECTORS] = show_velocity_vectors;
 	keybindsValues[TOGGLE_SHOW_ACCELERATION_VECTORS] = show_acceleration_vectors;
+	keybindsValues[TOGGLE_SHOW_TRAILS] = show_trails;
 	SetTargetFPS(fps);
 
 	DisableCursor();
@@ -159,11 +394,34 @@ view_t* constructView(int fps, int fullscreen, int width, int height, int show_v
 	last_camera_target = view->camera.target;
 	keybindsValues[ASTEROIDS_RENDER_MODE] = PERFORMANCE;
 
+	view->asteroidsTransforms = NULL;
+	view->asteroidsPoints = NULL;
+	view->asteroidsCapacity = 0;
+	view->vectorsLines = NULL;
+	view->vectorsCapacity = 0;
+	view->trails.state = 0;
+	view->trails.segments = NULL;
+	view->trails.colors = NULL;
+	view->profiler.shown = 0;
+	loadAsteroidsInstancing(view);
+
 	return view;
 }
 
 void destroyView(view_t* view)
 {
+	if (view->asteroidsInstancing)
+	{
+		UnloadMaterial(view->asteroidsMaterial);
+		UnloadMesh(view->asteroidsMesh);
+	}
+	if (view->asteroidsTransforms)
+		free(view->asteroidsTransforms);
+	if (view->asteroidsPoints)
+		free(view->asteroidsPoints);
+	if (view->vectorsLines)
+		free(view->vectorsLines);
+	unloadTrails(view);
 	CloseWindow();
 
 	delete view;
@@ -174,7 +432,7 @@ bool isViewRendering(view_t* view)
 	return !WindowShouldClose();
 }
 
-void renderView(view_t* view, OrbitalSim_t* sim)
+void renderView(view_t* view, const SimSnapshot_t* sim)
 {
 	if (keybindsValues[TOGGLE_FULLSCREEN])
 	{
@@ -184,6 +442,7 @@ void renderView(view_t* view, OrbitalSim_t* sim)
 
 	updateCameraSettings(view, sim);
 	UpdateCamera(&view->camera, camera_mode);
+	updateFrustum(view);
 
 	BeginDrawing();
 
@@ -191,14 +450,20 @@ void renderView(view_t* view, OrbitalSim_t* sim)
 
 	BeginMode3D(view->camera);
 	DrawGrid(10, 10.0f);
-	drawOrbitalSimuationEntities(sim);
+	ProfilerMark_t mark = beginProfilerStage(PROFILER_DRAW_ENTITIES);
+	drawOrbitalSimuationEntities(view, sim);
+	endProfilerStage(mark);
 	EndMode3D();
 
 	DrawFPS(10,10);
 	DrawText(getISODate((time_t)sim->timeElapsed),10, 30, 20, RAYWHITE);
 	DrawText(getElapsedSimTime((time_t)sim->timeElapsed, buffer), 10, 50, 20, RAYWHITE);
+	drawProfilerOverlay(view, sim);
 	printKeybinds(view);
+
+	mark = beginProfilerStage(PROFILER_END_DRAWING);
 	EndDrawing();
+	endProfilerStage(mark);
 }
 
 /**
@@ -239,7 +504,7 @@ static const char* getElapsedSimTime(time_t timestamp, char buffer[])
 	return buffer;
 }
 
-static void updateCameraSettings(view_t* view, OrbitalSim_t* sim)
+static void updateCameraSettings(view_t* view, const SimSnapshot_t* sim)
 {
 	if (!keybindsValues[CAMERA_MODE])
 	{
@@ -280,58 +545,495 @@ static void updateCameraSettings(view_t* view, OrbitalSim_t* sim)
 	view->camera.target = position;
 }
 
-static void drawBody(Body_t* body, float radius, Color color, unsigned int render_mode)
+static void updateFrustum(const view_t* view)
+{
+	Vector3 forward = Vector3Normalize(Vector3Subtract(view->camera.target, view->camera.position));
+	Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, view->camera.up));
+
+	frustum.position = view->camera.position;
+	frustum.forward = forward;
+	frustum.right = right;
+	frustum.up = Vector3CrossProduct(right, forward);
+	frustum.tanHalfFovY = tanf(view->camera.fovy * 0.5F * DEG2RAD);
+	frustum.tanHalfFovX = frustum.tanHalfFovY * GetScreenWidth() / (float) GetScreenHeight();
+	frustum.pixelsPerUnit = 0.5F * GetScreenHeight() / frustum.tanHalfFovY;
+}
+
+static float getPixelRadius(Vector3 position, float radius)
+{
+	Vector3 distance = Vector3Subtract(position, frustum.position);
+	float depth = Vector3DotProduct(distance, frustum.forward);
+
+	// Behind the near plane or past the far plane
+	if (depth + radius < FRUSTUM_NEAR || depth - radius > FRUSTUM_FAR)
+		return -1.0F;
+
+	// Outside the side planes, a little conservative near the corners
+	float limit = (depth > 0.0F) ? depth : 0.0F;
+	if (fabsf(Vector3DotProduct(distance, frustum.right)) > limit * frustum.tanHalfFovX + radius ||
+		fabsf(Vector3DotProduct(distance, frustum.up)) > limit * frustum.tanHalfFovY + radius)
+		return -1.0F;
+
+	return (depth > radius) ? radius / depth * frustum.pixelsPerUnit : INFINITY;
+}
+
+static void drawBody(const Body_t* body, float radius, Color color, unsigned int render_mode)
 {
 	Vector3 position;
+	float sphereRadius = 0.005F * logf(radius);
 
 	position.x = body->position.x * POSITION_SCALE_FACTOR;
 	position.y = body->position.y * POSITION_SCALE_FACTOR;
 	position.z = body->position.z * POSITION_SCALE_FACTOR;
 
+	float pixelRadius = getPixelRadius(position, sphereRadius);
+	if (pixelRadius < 0.0F)
+		return;
+
 	switch (render_mode)
 	{
 	default:
 	case QUALITY:
-		DrawSphereEx(position, 0.005F * logf(radius), 5, 7, color);
+		if (pixelRadius >= LOD_DETAILED_PIXELS)
+			DrawSphereEx(position, sphereRadius, DETAILED_RINGS, DETAILED_SLICES, color);
+		else if (pixelRadius >= LOD_POINT_PIXELS)
+			DrawSphereEx(position, sphereRadius, 5, 7, color);
+		else
+			DrawPoint3D(position, color);
 		break;
 	case PERFORMANCE:
 		DrawPoint3D(position, color);
 		break;
 	}
+}
+
+static void loadAsteroidsInstancing(view_t* view)
+{
+	view->asteroidsInstancing = 0;
+
+	// A shader that fails to compile is replaced by the default one, which has no instance transform
+	Shader shader = LoadShaderFromMemory(asteroidsVertexShader, asteroidsFragmentShader);
+	shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(shader, "instanceTransform");
+	if (shader.locs[SHADER_LOC_MATRIX_MODEL] == -1)
+	{
+		UnloadShader(shader);
+		return;
+	}
+
+	view->asteroidsMesh = GenMeshSphere(0.005F * logf(ASTEROIDS_RADIUS), ASTEROIDS_RINGS, ASTEROIDS_SLICES);
+	view->asteroidsMaterial = LoadMaterialDefault();
+	view->asteroidsMaterial.shader = shader;
+	view->asteroidsMaterial.maps[MATERIAL_MAP_DIFFUSE].color = ASTEROIDS_COLOR;
+	view->asteroidsInstancing = 1;
+}
+
+static void drawAsteroids(view_t* view, const SimSnapshot_t* sim)
+{
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	float sphereRadius = 0.005F * logf(ASTEROIDS_RADIUS);
+	int quality = (keybindsValues[ASTEROIDS_RENDER_MODE] == QUALITY);
+	unsigned int spheresNum = 0, pointsNum = 0;
+
+	if (!sim->asteroidsNum)
+		return;
+
+	if (sim->asteroidsNum > view->asteroidsCapacity)
+	{
+		Matrix* transforms = (Matrix*) realloc(view->asteroidsTransforms, sizeof(Matrix) * sim->asteroidsNum);
+		if (transforms)
+			view->asteroidsTransforms = transforms;
+		Vector3* points = (Vector3*) realloc(view->asteroidsPoints, sizeof(Vector3) * 2 * sim->asteroidsNum);
+		if (points)
+			view->asteroidsPoints = points;
+		if (!transforms || !points)
+			return;
+		view->asteroidsCapacity = sim->asteroidsNum;
+	}
 
-	if (keybindsValues[TOGGLE_SHOW_VELOCITY_VECTORS])
+	// Visibility stage: asteroids big enough on screen become spheres, the rest points, the tiniest nothing
+	for (unsigned int i = 0; i < sim->asteroidsNum; i++)
 	{
-		Vector3 velocity;
-		velocity.x = body->velocity.x * VELOCITY_SCALE_FACTOR + position.x;
-		velocity.y = body->velocity.y * VELOCITY_SCALE_FACTOR + position.y;
-		velocity.z = body->velocity.z * VELOCITY_SCALE_FACTOR + position.z;
+		Vector3 position = {	(float) (asteroids->x[i] * POSITION_SCALE_FACTOR),
+					(float) (asteroids->y[i] * POSITION_SCALE_FACTOR),
+					(float) (asteroids->z[i] * POSITION_SCALE_FACTOR)};
+		float pixelRadius = getPixelRadius(position, sphereRadius);
 
-		DrawLine3D(position, velocity, BLUE);
+		if (pixelRadius < LOD_SKIP_PIXELS)
+			continue;
+
+		if (quality && pixelRadius >= LOD_POINT_PIXELS)
+		{
+			view->asteroidsTransforms[spheresNum++] = MatrixTranslate(position.x, position.y, position.z);
+			continue;
+		}
+
+		// Same short line DrawPoint3D draws, without moving the matrix for each one
+		view->asteroidsPoints[2 * pointsNum] = position;
+		position.z += POINT_LENGTH;
+		view->asteroidsPoints[2 * pointsNum + 1] = position;
+		pointsNum++;
 	}
-	if (keybindsValues[TOGGLE_SHOW_ACCELERATION_VECTORS])
+
+	drawLines(view->asteroidsPoints, pointsNum, ASTEROIDS_COLOR);
+
+	if (view->asteroidsInstancing)
 	{
-		Vector3 acceleration;
-		acceleration.x = body->acceleration.x * ACCELERATION_SCALE_FACTOR + position.x;
-		acceleration.y = body->acceleration.y * ACCELERATION_SCALE_FACTOR + position.y;
-		acceleration.z = body->acceleration.z * ACCELERATION_SCALE_FACTOR + position.z;
+		if (spheresNum)
+			DrawMeshInstanced(view->asteroidsMesh, view->asteroidsMaterial, view->asteroidsTransforms, spheresNum);
+		return;
+	}
 
-		DrawLine3D(position, acceleration, RED);
+	for (unsigned int i = 0; i < spheresNum; i++)
+	{
+		const Matrix* transform = &view->asteroidsTransforms[i];
+		DrawSphereEx(Vector3{transform->m12, transform->m13, transform->m14}, sphereRadius,
+				ASTEROIDS_RINGS, ASTEROIDS_SLICES, ASTEROIDS_COLOR);
 	}
 }
 
-static void drawOrbitalSimuationEntities(OrbitalSim_t* sim)
+static Vector3* transformVectors(Vector3* lines, const double* x, const double* y, const double* z,
+				const double* vx, const double* vy, const double* vz, unsigned int count, double scale)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		double px = x[i] * POSITION_SCALE_FACTOR;
+		double py = y[i] * POSITION_SCALE_FACTOR;
+		double pz = z[i] * POSITION_SCALE_FACTOR;
+
+		lines[2 * i].x = (float) px;
+		lines[2 * i].y = (float) py;
+		lines[2 * i].z = (float) pz;
+		lines[2 * i + 1].x = (float) (vx[i] * scale + px);
+		lines[2 * i + 1].y = (float) (vy[i] * scale + py);
+		lines[2 * i + 1].z = (float) (vz[i] * scale + pz);
+	}
+
+	return lines + 2 * count;
+}
+
+static Vector3* transformBodiesVectors(Vector3* lines, const SimSnapshot_t* sim, int velocities)
+{
+	const Body_t* bodies[] = {&sim->SpaceShip.body, &sim->BlackHole.body};
+	const BodyArrays_t* asteroids = sim->Asteroids;
+	double scale = (velocities) ? VELOCITY_SCALE_FACTOR : ACCELERATION_SCALE_FACTOR;
+
+	// The few massive bodies are stored one by one, each is a transform of length 1
+	for (unsigned int i = 0; i < sim->bodyNum + 2; i++)
+	{
+		const Body_t* body = (i < sim->bodyNum) ? &sim->PlanetarySystem[i].body : bodies[i - sim->bodyNum];
+		const vector3D_t* vector = (velocities) ? &body->velocity : &body->acceleration;
+
+		lines = transformVectors(lines, &body->position.x, &body->position.y, &body->position.z,
+					&vector->x, &vector->y, &vector->z, 1, scale);
+	}
+
+	if (velocities)
+		return transformVectors(lines, asteroids->x, asteroids->y, asteroids->z,
+					asteroids->vx, asteroids->vy, asteroids->vz, sim->asteroidsNum, scale);
+	return transformVectors(lines, asteroids->x, asteroids->y, asteroids->z,
+				asteroids->ax, asteroids->ay, asteroids->az, sim->asteroidsNum, scale);
+}
+
+static void drawLines(const Vector3* lines, unsigned int linesNum, Color color)
+{
+	for (unsigned int begin = 0; begin < linesNum; begin += LINES_BATCH_SIZE)
+	{
+		unsigned int end = (begin + LINES_BATCH_SIZE < linesNum) ? begin + LINES_BATCH_SIZE : linesNum;
+
+		rlCheckRenderBatchLimit(2 * (end - begin));
+		rlBegin(RL_LINES);
+		rlColor4ub(color.r, color.g, color.b, color.a);
+		for (unsigned int i = 2 * begin; i < 2 * end; i++)
+		{
+			rlVertex3f(lines[i].x, lines[i].y, lines[i].z);
+		}
+		rlEnd();
+	}
+}
+
+static void drawVectorsOverlay(view_t* view, const SimSnapshot_t* sim)
+{
+	int velocities = keybindsValues[TOGGLE_SHOW_VELOCITY_VECTORS];
+	int accelerations = keybindsValues[TOGGLE_SHOW_ACCELERATION_VECTORS];
+	unsigned int linesNum = sim->bodyNum + 2 + sim->asteroidsNum;
+
+	if (!velocities && !accelerations)
+		return;
+
+	if (2 * 2 * linesNum > view->vectorsCapacity)
+	{
+		Vector3* lines = (Vector3*) realloc(view->vectorsLines, sizeof(Vector3) * 2 * 2 * linesNum);
+		if (!lines)
+			return;
+		view->vectorsLines = lines;
+		view->vectorsCapacity = 2 * 2 * linesNum;
+	}
+
+	Vector3* accelerationLines = view->vectorsLines;
+	if (velocities)
+		accelerationLines = transformBodiesVectors(view->vectorsLines, sim, 1);
+	if (accelerations)
+		transformBodiesVectors(accelerationLines, sim, 0);
+
+	if (velocities)
+		drawLines(view->vectorsLines, linesNum, BLUE);
+	if (accelerations)
+		drawLines(accelerationLines, linesNum, RED);
+}
+
+static Color getTrailColor(const SimSnapshot_t* sim, unsigned int trail)
+{
+	const Trails_t* trails = sim->trails;
+	Color color = ASTEROIDS_COLOR;
+
+	if (trail < trails->bodiesTrailsNum && trail < sim->bodyNum)
+		color = sim->PlanetarySystem[trail].color;
+	else if (trail == trails->bodiesTrailsNum)
+		color = sim->SpaceShip.color;
+
+	color.a = TRAILS_ALPHA;
+	return color;
+}
+
+static void loadTrails(view_t* view, const SimSnapshot_t* sim)
+{
+	trailsView_t* trails = &view->trails;
+	unsigned int trailsNum = sim->trails->trailsNum;
+	unsigned int verticesNum = 3 * sim->trails->length * trailsNum;
+
+	trails->state = -1;
+	trails->segments = (Vector3*) malloc(sizeof(Vector3) * 3 * trailsNum);
+	trails->colors = (Color*) malloc(sizeof(Color) * verticesNum);
+	if (!trails->segments || !trails->colors)
+		return;
+
+	// A shader that fails to compile is replaced by the default one
+	Shader shader = LoadShaderFromMemory(trailsVertexShader, trailsFragmentShader);
+	if (shader.id == rlGetShaderIdDefault())
+		return;
+
+	trails->vao = rlLoadVertexArray();
+	if (!trails->vao)
+	{
+		UnloadShader(shader);
+		return;
+	}
+	trails->shader = shader;
+
+	rlEnableVertexArray(trails->vao);
+	trails->positionsVbo = rlLoadVertexBuffer(NULL, sizeof(Vector3) * verticesNum, true);
+	rlSetVertexAttribute(shader.locs[SHADER_LOC_VERTEX_POSITION], 3, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(shader.locs[SHADER_LOC_VERTEX_POSITION]);
+	trails->colorsVbo = rlLoadVertexBuffer(NULL, sizeof(Color) * verticesNum, true);
+	rlSetVertexAttribute(shader.locs[SHADER_LOC_VERTEX_COLOR], 4, RL_UNSIGNED_BYTE, true, 0, 0);
+	rlEnableVertexAttribute(shader.locs[SHADER_LOC_VERTEX_COLOR]);
+	rlDisableVertexArray();
+
+	trails->state = 1;
+}
+
+static void unloadTrails(view_t* view)
+{
+	trailsView_t* trails = &view->trails;
+
+	if (trails->state == 1)
+	{
+		rlUnloadVertexBuffer(trails->positionsVbo);
+		rlUnloadVertexBuffer(trails->colorsVbo);
+		rlUnloadVertexArray(trails->vao);
+		UnloadShader(trails->shader);
+	}
+	if (trails->segments)
+		free(trails->segments);
+	if (trails->colors)
+		free(trails->colors);
+}
+
+static void uploadTrailsColors(view_t* view, const SimSnapshot_t* sim)
+{
+	trailsView_t* trails = &view->trails;
+	unsigned int trailsNum = sim->trails->trailsNum;
+	Color* color = trails->colors;
+
+	for (unsigned int slot = 0; slot < sim->trails->length; slot++)
+	{
+		for (unsigned int i = 0; i < trailsNum; i++, color += 3)
+			color[0] = color[1] = color[2] = getTrailColor(sim, i);
+	}
+
+	rlUpdateVertexBuffer(trails->colorsVbo, trails->colors, sizeof(Color) * 3 * trailsNum * sim->trails->length, 0);
+	trails->bodyNum = sim->bodyNum;
+}
+
+static void uploadTrailsSlot(view_t* view, const Trails_t* trails, unsigned int slot, int degenerate)
+{
+	unsigned int previousSlot = (slot) ? slot - 1 : trails->length - 1;
+	const vector3D_t* sample = trails->positions + slot * trails->trailsNum;
+	const vector3D_t* previousSample = trails->positions + previousSlot * trails->trailsNum;
+	Vector3* segment = view->trails.segments;
+
+	for (unsigned int i = 0; i < trails->trailsNum; i++, segment += 3)
+	{
+		segment[1] = Vector3Scale(toVector3(sample[i]), POSITION_SCALE_FACTOR);
+		segment[2] = segment[1];
+		segment[0] = (degenerate) ? segment[1] : Vector3Scale(toVector3(previousSample[i]), POSITION_SCALE_FACTOR);
+	}
+
+	rlUpdateVertexBuffer(view->trails.positionsVbo, view->trails.segments, sizeof(Vector3) * 3 * trails->trailsNum,
+				sizeof(Vector3) * 3 * trails->trailsNum * slot);
+}
+
+static void drawTrailsFromSnapshot(const SimSnapshot_t* sim)
+{
+	const Trails_t* trails = sim->trails;
+	unsigned int next = trails->samplesNum % trails->length;
+
+	for (unsigned int slot = 0; slot < trails->length; slot++)
+	{
+		const vector3D_t* sample = trails->positions + slot * trails->trailsNum;
+		const vector3D_t* previousSample = trails->positions + ((slot) ? slot - 1 : trails->length - 1) * trails->trailsNum;
+
+		if (slot == next)
+			continue;
+
+		rlCheckRenderBatchLimit(2 * trails->trailsNum);
+		rlBegin(RL_LINES);
+		for (unsigned int i = 0; i < trails->trailsNum; i++)
+		{
+			Color color = getTrailColor(sim, i);
+
+			rlColor4ub(color.r, color.g, color.b, color.a);
+			rlVertex3f(previousSample[i].x * POSITION_SCALE_FACTOR, previousSample[i].y * POSITION_SCALE_FACTOR,
+					previousSample[i].z * POSITION_SCALE_FACTOR);
+			rlVertex3f(sample[i].x * POSITION_SCALE_FACTOR, sample[i].y * POSITION_SCALE_FACTOR,
+					sample[i].z * POSITION_SCALE_FACTOR);
+		}
+		rlEnd();
+	}
+}
+
+static void drawTrails(view_t* view, const SimSnapshot_t* sim)
+{
+	trailsView_t* trails = &view->trails;
+	const Trails_t* source = sim->trails;
+	int loaded = 0;
+
+	if (!source || !keybindsValues[TOGGLE_SHOW_TRAILS])
+		return;
+
+	if (!trails->state)
+	{
+		loadTrails(view, sim);
+		loaded = 1;
+	}
+	if (trails->state < 0)
+	{
+		drawTrailsFromSnapshot(sim);
+		return;
+	}
+
+	if (loaded || trails->bodyNum != sim->bodyNum)
+		uploadTrailsColors(view, sim);
+
+	// Only the slots written since the last frame, unless the whole ring changed
+	if (loaded || trails->resetsNum != source->resetsNum || source->samplesNum - trails->samplesNum >= source->length)
+	{
+		for (unsigned int slot = 0; slot < source->length; slot++)
+			uploadTrailsSlot(view, source, slot, slot == source->samplesNum % source->length);
+	}
+	else
+	{
+		for (unsigned long long sample = trails->samplesNum; sample < source->samplesNum; sample++)
+			uploadTrailsSlot(view, source, sample % source->length, 0);
+	}
+	trails->samplesNum = source->samplesNum;
+	trails->resetsNum = source->resetsNum;
+
+	// Whatever is batched goes first, then the whole ring in one call. Each degenerate
+	// triangle is drawn as its edges, the segment plus a zero length one.
+	rlDrawRenderBatchActive();
+	rlEnableShader(trails->shader.id);
+	rlSetUniformMatrix(trails->shader.locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+	rlDisableBackfaceCulling();
+	rlEnableWireMode();
+	rlEnableVertexArray(trails->vao);
+	rlDrawVertexArray(0, 3 * source->length * source->trailsNum);
+	rlDisableVertexArray();
+	rlDisableWireMode();
+	rlEnableBackfaceCulling();
+	rlDisableShader();
+}
+
+static void drawOrbitalSimuationEntities(view_t* view, const SimSnapshot_t* sim)
 {
 	for (unsigned int i = 0; i < sim->bodyNum; i++) 
 	{
 		drawBody(	&sim->PlanetarySystem[i].body, sim->PlanetarySystem[i].radius,
 				sim->PlanetarySystem[i].color, keybindsValues[EBODIES_RENDER_MODE]);
 	}
-	for (unsigned int i = 0; i < sim->asteroidsNum; i++) 
-	{
-		drawBody(sim->Asteroids + i, ASTEROIDS_RADIUS, ASTEROIDS_COLOR, keybindsValues[ASTEROIDS_RENDER_MODE]);
-	}
+	drawAsteroids(view, sim);
 	drawBody(&sim->SpaceShip.body, sim->SpaceShip.radius, sim->SpaceShip.color, keybindsValues[SPACESHIP_RENDER_MODE]);
 	drawBody(&sim->BlackHole.body, sim->BlackHole.absorbRadius, PINK, QUALITY);
+	drawVectorsOverlay(view, sim);
+	drawTrails(view, sim);
+}
+
+static void drawProfilerOverlay(view_t* view, const SimSnapshot_t* sim)
+{
+	profilerView_t* profiler = &view->profiler;
+	ProfilerTotals_t totals;
+
+	if (!keybindsValues[TOGGLE_PROFILER])
+	{
+		profiler->shown = 0;
+		return;
+	}
+
+	// While hidden the totals may not have been counting, a new sample starts
+	double now = GetTime();
+	if (!profiler->shown)
+	{
+		getProfilerTotals(&profiler->totals);
+		profiler->time = now;
+		profiler->framesNum = 0;
+		profiler->interactionsNum = sim->interactionsNum;
+		for (unsigned int i = 0; i < PROFILER_STAGES_AMOUNT; i++)
+			profiler->stagesTime[i] = profiler->stagesCalls[i] = 0.0;
+		profiler->interactionsPerSecond = 0.0;
+		profiler->shown = 1;
+	}
+
+	profiler->framesNum++;
+	if (now - profiler->time >= PROFILER_OVERLAY_REFRESH)
+	{
+		getProfilerTotals(&totals);
+		for (unsigned int i = 0; i < PROFILER_STAGES_AMOUNT; i++)
+		{
+			profiler->stagesTime[i] = (totals.time[i] - profiler->totals.time[i]) * MILLISECONDS_PER_NANOSECOND /
+							profiler->framesNum;
+			profiler->stagesCalls[i] = (double)(totals.calls[i] - profiler->totals.calls[i]) / profiler->framesNum;
+		}
+		// A rewind takes interactionsNum back
+		profiler->interactionsPerSecond = (sim->interactionsNum > profiler->interactionsNum) ?
+							(sim->interactionsNum - profiler->interactionsNum) / (now - profiler->time) : 0.0;
+
+		profiler->totals = totals;
+		profiler->time = now;
+		profiler->framesNum = 0;
+		profiler->interactionsNum = sim->interactionsNum;
+	}
+
+	int yCoord = PROFILER_OVERLAY_Y;
+	DrawText("Stage: ms per frame (calls per frame)", PROFILER_OVERLAY_X, yCoord, PROFILER_OVERLAY_FONT_SIZE, PROFILER_OVERLAY_COLOR);
+	for (unsigned int i = 0; i < PROFILER_STAGES_AMOUNT; i++)
+	{
+		yCoord += PROFILER_OVERLAY_LINE_HEIGHT;
+		DrawText(TextFormat("%s: %.3f (%.1f)", getProfilerStageName((ProfilerStage_t)i), profiler->stagesTime[i],
+				profiler->stagesCalls[i]), PROFILER_OVERLAY_X, yCoord, PROFILER_OVERLAY_FONT_SIZE, PROFILER_OVERLAY_COLOR);
+	}
+	yCoord += PROFILER_OVERLAY_LINE_HEIGHT;
+	DrawText(TextFormat("Interactions per second: %.3g", profiler->interactionsPerSecond), PROFILER_OVERLAY_X, yCoord,
+			PROFILER_OVERLAY_FONT_SIZE, PROFILER_OVERLAY_COLOR);
 }
 
 static void printKeybinds(view_t* view)